@@ -6,9 +6,9 @@ setlocal enabledelayedexpansion
 
 REM Configuration
 set CXX=g++
-set CXXFLAGS=-std=c++17 -Wall -Wextra -pedantic
+set CXXFLAGS=-std=c++17 -Wall -Wextra -pedantic -pthread
 set INCLUDES=-Iinclude
-set SOURCES=src\main.cpp src\order_manager.cpp
+set SOURCES=src\main.cpp src\order_manager.cpp src\order_pool_resource.cpp src\snapshot_writer.cpp src\fork_snapshot.cpp src\command_pipe.cpp src\checkpoint_index.cpp
 set TARGET=limit_order_manager.exe
 
 REM Check if g++ is available
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "flat_hash_map.hpp"
+#include "order_storage.hpp"
+#include "try_allocate.hpp"
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * @brief Owner of an order; kNoAccount for orders added without one
+ */
+using AccountId = uint32_t;
+constexpr AccountId kNoAccount = 0;
+
+/**
+ * @brief Account -> resting orders, as an intrusive list per account
+ *
+ * The account and its list links live in a cold column indexed by order
+ * handle, so the hot Order record and the level FIFOs are unchanged and
+ * books that never use accounts pay one bounds check per removal.
+ * Walking an account costs the number of its orders, whatever the book
+ * size.
+ */
+class AccountIndex {
+private:
+    struct Link {
+        AccountId account = kNoAccount;
+        OrderHandle prev = kNullHandle;
+        OrderHandle next = kNullHandle;
+    };
+
+    struct List {
+        OrderHandle head = kNullHandle;
+        uint32_t count = 0;
+    };
+
+    std::pmr::vector<Link> links_;  // By handle
+    FlatHashMap<List> lists_;       // By account
+
+public:
+    explicit AccountIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : links_(resource), lists_(resource) {}
+
+    /**
+     * @brief Put handle at the front of account's list
+     * @return false if the account table could not grow
+     */
+    bool link(OrderHandle handle, AccountId account) {
+        if (handle >= links_.size() &&
+            !try_allocate([&] { links_.resize(std::max<size_t>(handle + 1, links_.size() * 2)); })) {
+            return false;
+        }
+        auto [list, inserted] = lists_.insert(account, List{});
+        if (!list) return false;
+        (void)inserted;
+        Link& link = links_[handle];
+        link = Link{account, kNullHandle, list->head};
+        if (list->head != kNullHandle) links_[list->head].prev = handle;
+        list->head = handle;
+        list->count++;
+        return true;
+    }
+
+    // Called for every order leaving the book; a no-op without an account
+    void unlink(OrderHandle handle) {
+        if (handle >= links_.size() || links_[handle].account == kNoAccount) return;
+        Link& link = links_[handle];
+        List* list = lists_.find(link.account);
+        if (link.prev != kNullHandle) {
+            links_[link.prev].next = link.next;
+        } else {
+            list->head = link.next;
+        }
+        if (link.next != kNullHandle) links_[link.next].prev = link.prev;
+        if (--list->count == 0) lists_.erase(link.account);
+        link = Link{};
+    }
+
+    AccountId account_of(OrderHandle handle) const {
+        return handle < links_.size() ? links_[handle].account : kNoAccount;
+    }
+
+    size_t order_count(AccountId account) const {
+        const List* list = lists_.find(account);
+        return list ? list->count : 0;
+    }
+
+    // Visit the handles of account's orders, newest first; fn may unlink
+    // the handle it is given
+    template <typename Fn>
+    void for_each(AccountId account, Fn&& fn) const {
+        const List* list = lists_.find(account);
+        if (!list) return;
+        for (OrderHandle h = list->head; h != kNullHandle;) {
+            const OrderHandle next = links_[h].next;
+            fn(h);
+            h = next;
+        }
+    }
+
+    size_t account_count() const { return lists_.size(); }
+
+    void clear() {
+        links_.clear();
+        lists_.clear();
+    }
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "order.hpp"
+#include <cstdint>
+#include <limits>
+
+/**
+ * @brief Aggregate of one price level, as returned by the book analytics
+ * An empty side reports orders == 0 and a NaN price.
+ */
+struct LevelQuote {
+    double price = std::numeric_limits<double>::quiet_NaN();
+    uint64_t quantity = 0;
+    uint32_t orders = 0;
+
+    bool empty() const { return orders == 0; }
+};
+
+/**
+ * @brief Cost of sweeping a quantity from the touch of one side
+ * filled is below the requested quantity when the side holds less.
+ */
+struct SweepEstimate {
+    uint64_t filled = 0;
+    double notional = 0.0;  // Sum of price * quantity over the swept orders
+    double worst_price = std::numeric_limits<double>::quiet_NaN();
+
+    double vwap() const {
+        return filled ? notional / static_cast<double>(filled)
+                      : std::numeric_limits<double>::quiet_NaN();
+    }
+};
+
+/**
+ * @brief Running quantity and order count per side
+ *
+ * Updated on every add, cancel and fill, so whole-side depth is a read
+ * rather than a walk of the book.
+ */
+class DepthTotals {
+private:
+    uint64_t quantity_[2] = {0, 0};
+    uint64_t orders_[2] = {0, 0};
+
+public:
+    template <Side S>
+    void on_add(uint64_t quantity) {
+        quantity_[static_cast<size_t>(S)] += quantity;
+        orders_[static_cast<size_t>(S)]++;
+    }
+
+    // The order left the book with quantity still open
+    template <Side S>
+    void on_remove(uint64_t quantity) {
+        quantity_[static_cast<size_t>(S)] -= quantity;
+        orders_[static_cast<size_t>(S)]--;
+    }
+
+    // Partial fill: the order stays on the book
+    template <Side S>
+    void on_fill(uint64_t quantity) { quantity_[static_cast<size_t>(S)] -= quantity; }
+
+    uint64_t quantity(Side side) const { return quantity_[static_cast<size_t>(side)]; }
+    uint64_t orders(Side side) const { return orders_[static_cast<size_t>(side)]; }
+
+    void reset() { *this = DepthTotals(); }
+};
+
+/**
+ * @brief Size-weighted mid of the touch
+ *
+ * Each price is weighted by the quantity on the opposite side, so the
+ * result leans toward the side that is about to be depleted. NaN unless
+ * both sides are quoted.
+ */
+inline double microprice(const LevelQuote& bid, const LevelQuote& ask) {
+    if (bid.empty() || ask.empty()) return std::numeric_limits<double>::quiet_NaN();
+    const double bid_quantity = static_cast<double>(bid.quantity);
+    const double ask_quantity = static_cast<double>(ask.quantity);
+    return (bid.price * ask_quantity + ask.price * bid_quantity) / (bid_quantity + ask_quantity);
+}
+
+/**
+ * @brief (bid - ask) / (bid + ask), in [-1, 1]; 0 when both are empty
+ */
+inline double imbalance(uint64_t bid_quantity, uint64_t ask_quantity) {
+    const uint64_t total = bid_quantity + ask_quantity;
+    if (total == 0) return 0.0;
+    return (static_cast<double>(bid_quantity) - static_cast<double>(ask_quantity)) / total;
+}
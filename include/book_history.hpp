@@ -0,0 +1,638 @@
+#pragma once
+
+#include "command_pipe.hpp"
+#include "order_status.hpp"
+#include "price_levels.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+/**
+ * @brief Node memory for persistent book versions
+ *
+ * Nodes come from one monotonic arena and all go back when the pool is
+ * destroyed. Nodes an editor replaces before anyone else can see them are
+ * kept on a free list per size class and handed out again.
+ */
+class VersionNodePool {
+public:
+    static constexpr size_t kClasses = 8;
+
+    explicit VersionNodePool(std::pmr::memory_resource* upstream) : arena_(upstream) {}
+
+    void* allocate(size_t size_class, size_t bytes) {
+        if (FreeNode* node = free_[size_class]) {
+            free_[size_class] = node->next;
+            return node;
+        }
+        bytes_ += bytes;
+        return arena_.allocate(bytes, alignof(std::max_align_t));
+    }
+
+    void recycle(size_t size_class, void* node) {
+        free_[size_class] = new (node) FreeNode{free_[size_class]};
+    }
+
+    // Bytes taken from the arena (recycled nodes are counted once)
+    size_t bytes() const { return bytes_; }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    std::pmr::monotonic_buffer_resource arena_;
+    FreeNode* free_[kClasses] = {};
+    size_t bytes_ = 0;
+};
+
+/**
+ * @brief Who is changing a persistent structure, and where new nodes go
+ *
+ * Every node is stamped with the epoch of the editor that made it. A node
+ * carrying the editor's own epoch was made since the last version was
+ * frozen, so no version can reach it and it is changed in place; any
+ * other node belongs to a frozen version and is copied first (path
+ * copying). Between two versions a node is therefore copied at most once,
+ * however often it changes.
+ */
+struct VersionEditor {
+    VersionNodePool* pool = nullptr;              // Live edits: recycles what it replaces
+    std::pmr::memory_resource* scratch = nullptr; // Query replays: allocate here, recycle nothing
+    uint32_t epoch = 0;
+
+    void* allocate(size_t size_class, size_t bytes) {
+        return scratch ? scratch->allocate(bytes, alignof(std::max_align_t))
+                       : pool->allocate(size_class, bytes);
+    }
+
+    // Give back a node that is being replaced, if it was this editor's own
+    void release(size_t size_class, void* node, uint32_t node_epoch) {
+        if (!scratch && node_epoch == epoch) pool->recycle(size_class, node);
+    }
+};
+
+/**
+ * @brief Persistent map of order ID -> Order: a hash array mapped trie
+ *
+ * 32-way nodes with two bitmaps (slots holding an order, slots holding a
+ * child) over a compact array of 8-byte pointers, so a node is only as
+ * large as its occupied slots and copying one for a path copy is cheap.
+ * Orders sit in their own small leaf records, shared between versions
+ * until they change. Keys are hashed by a bijective 64-bit mix, so two
+ * IDs always part within 13 levels and there are no collision buckets.
+ * Lookups are O(log32 n); updates copy the path they change.
+ */
+class OrderTrie {
+public:
+    struct Node;
+
+    static const Order* find(const Node* node, uint64_t id) {
+        const uint64_t h = mix(id);
+        for (unsigned depth = 0; node; ++depth) {
+            const uint32_t bit = 1u << slot(h, depth);
+            const Entry& entry = node->entries()[node->position(bit)];
+            if (node->children & bit) {
+                node = entry.child;
+            } else {
+                return (node->leaves & bit) && entry.leaf->order.id == id ? &entry.leaf->order : nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    // order.id must be absent
+    static Node* insert(Node* root, const Order& order, VersionEditor& editor) {
+        return insert(root, make_leaf(order, editor), mix(order.id), 0, editor);
+    }
+
+    // order.id must be present; its record is replaced by order
+    static Node* assign(Node* root, const Order& order, VersionEditor& editor) {
+        return assign(root, order, mix(order.id), 0, editor);
+    }
+
+    // id must be present; returns nullptr once the map is empty
+    static Node* erase(Node* root, uint64_t id, VersionEditor& editor) {
+        return erase(root, mix(id), 0, editor);
+    }
+
+    // Every order, in no particular order
+    template <typename Fn>
+    static void for_each(const Node* node, Fn& fn) {
+        if (!node) return;
+        const Entry* entries = node->entries();
+        uint32_t i = 0;
+        for (uint32_t bits = node->leaves | node->children; bits; bits &= bits - 1, ++i) {
+            const uint32_t bit = bits & (~bits + 1);
+            if (node->children & bit) for_each(entries[i].child, fn); else fn(entries[i].leaf->order);
+        }
+    }
+
+private:
+    static constexpr size_t kLeafClass = 7;  // Node classes are 0..5
+
+    struct Leaf {
+        Order order;
+        uint32_t epoch;
+    };
+
+    union Entry {
+        Leaf* leaf;
+        Node* child;
+    };
+
+public:
+    struct Node {
+        uint32_t epoch;
+        uint32_t leaves;      // Slots holding an order
+        uint32_t children;    // Slots holding a child node
+        uint32_t size_class;  // Room for 1 << size_class entries
+
+        Entry* entries() { return reinterpret_cast<Entry*>(this + 1); }
+        const Entry* entries() const { return reinterpret_cast<const Entry*>(this + 1); }
+        uint32_t count() const { return static_cast<uint32_t>(__builtin_popcount(leaves | children)); }
+        uint32_t position(uint32_t bit) const {
+            return static_cast<uint32_t>(__builtin_popcount((leaves | children) & (bit - 1)));
+        }
+    };
+    static_assert(sizeof(Node) == 16 && sizeof(Entry) == 8, "trie nodes are a header and one pointer per slot");
+
+private:
+    static uint64_t mix(uint64_t id) {
+        id ^= id >> 33;
+        id *= 0xff51afd7ed558ccdull;
+        id ^= id >> 33;
+        id *= 0xc4ceb9fe1a85ec53ull;
+        return id ^ (id >> 33);
+    }
+    static unsigned slot(uint64_t h, unsigned depth) { return (h >> (5 * depth)) & 31; }
+
+    static Leaf* make_leaf(const Order& order, VersionEditor& editor) {
+        return new (editor.allocate(kLeafClass, sizeof(Leaf))) Leaf{order, editor.epoch};
+    }
+
+    // node itself if this editor may change it in place with room for
+    // need entries, else a copy that may be (releasing node if it was ours)
+    static Node* own(Node* node, uint32_t need, VersionEditor& editor) {
+        if (node && node->epoch == editor.epoch && (1u << node->size_class) >= need) return node;
+        uint32_t size_class = 0;
+        while ((1u << size_class) < need) ++size_class;
+        void* memory = editor.allocate(size_class, sizeof(Node) + (sizeof(Entry) << size_class));
+        Node* copy = new (memory) Node{editor.epoch, 0, 0, size_class};
+        if (node) {
+            copy->leaves = node->leaves;
+            copy->children = node->children;
+            std::memcpy(static_cast<void*>(copy->entries()), node->entries(), node->count() * sizeof(Entry));
+            editor.release(node->size_class, node, node->epoch);
+        }
+        return copy;
+    }
+
+    // A node at depth holding leaves a and b, nested until their slots part
+    static Node* pair(Leaf* a, uint64_t ha, Leaf* b, uint64_t hb, unsigned depth, VersionEditor& editor) {
+        const unsigned sa = slot(ha, depth);
+        const unsigned sb = slot(hb, depth);
+        if (sa == sb) {
+            Node* node = own(nullptr, 1, editor);
+            node->children = 1u << sa;
+            node->entries()[0].child = pair(a, ha, b, hb, depth + 1, editor);
+            return node;
+        }
+        Node* node = own(nullptr, 2, editor);
+        node->leaves = (1u << sa) | (1u << sb);
+        node->entries()[sa < sb ? 0 : 1].leaf = a;
+        node->entries()[sa < sb ? 1 : 0].leaf = b;
+        return node;
+    }
+
+    static Node* insert(Node* node, Leaf* leaf, uint64_t h, unsigned depth, VersionEditor& editor) {
+        const uint32_t bit = 1u << slot(h, depth);
+        if (!node) {
+            node = own(nullptr, 1, editor);
+            node->leaves = bit;
+            node->entries()[0].leaf = leaf;
+            return node;
+        }
+        const uint32_t pos = node->position(bit);
+        const uint32_t count = node->count();
+        if (node->children & bit) {
+            Node* child = node->entries()[pos].child;
+            Node* updated = insert(child, leaf, h, depth + 1, editor);
+            if (updated != child) {
+                node = own(node, count, editor);
+                node->entries()[pos].child = updated;
+            }
+            return node;
+        }
+        if (node->leaves & bit) {
+            // Occupied by another order: both move one level down
+            Leaf* existing = node->entries()[pos].leaf;
+            Node* child = pair(existing, mix(existing->order.id), leaf, h, depth + 1, editor);
+            node = own(node, count, editor);
+            node->entries()[pos].child = child;
+            node->leaves &= ~bit;
+            node->children |= bit;
+            return node;
+        }
+        node = own(node, count + 1, editor);
+        Entry* entries = node->entries();
+        std::memmove(static_cast<void*>(entries + pos + 1), entries + pos, (count - pos) * sizeof(Entry));
+        entries[pos].leaf = leaf;
+        node->leaves |= bit;
+        return node;
+    }
+
+    static Node* assign(Node* node, const Order& order, uint64_t h, unsigned depth, VersionEditor& editor) {
+        const uint32_t bit = 1u << slot(h, depth);
+        const uint32_t pos = node->position(bit);
+        if (node->children & bit) {
+            Node* child = node->entries()[pos].child;
+            Node* updated = assign(child, order, h, depth + 1, editor);
+            if (updated == child) return node;
+            node = own(node, node->count(), editor);
+            node->entries()[pos].child = updated;
+            return node;
+        }
+        Leaf* leaf = node->entries()[pos].leaf;
+        if (leaf->epoch == editor.epoch) {
+            leaf->order = order;
+            return node;
+        }
+        node = own(node, node->count(), editor);
+        node->entries()[pos].leaf = make_leaf(order, editor);
+        return node;
+    }
+
+    static Node* erase(Node* node, uint64_t h, unsigned depth, VersionEditor& editor) {
+        const uint32_t bit = 1u << slot(h, depth);
+        const uint32_t pos = node->position(bit);
+        const uint32_t count = node->count();
+        if (node->children & bit) {
+            Node* child = node->entries()[pos].child;
+            Node* updated = erase(child, h, depth + 1, editor);
+            if (updated == child) return node;
+            if (updated) {
+                node = own(node, count, editor);
+                node->entries()[pos].child = updated;
+                return node;
+            }
+        } else {
+            Leaf* leaf = node->entries()[pos].leaf;
+            editor.release(kLeafClass, leaf, leaf->epoch);
+        }
+        if (count == 1) {
+            editor.release(node->size_class, node, node->epoch);
+            return nullptr;
+        }
+        node = own(node, count, editor);
+        Entry* entries = node->entries();
+        std::memmove(static_cast<void*>(entries + pos), entries + pos + 1, (count - pos - 1) * sizeof(Entry));
+        node->leaves &= ~bit;
+        node->children &= ~bit;
+        return node;
+    }
+};
+
+/**
+ * @brief Persistent price levels of one side: a path-copying treap
+ *
+ * Keyed so that in-order is best price first, with priorities hashed from
+ * the key: the shape depends only on the set of prices, never on the
+ * order they arrived in, and an update copies an expected O(log L) nodes.
+ */
+class LevelTreap {
+public:
+    static constexpr size_t kSizeClass = 6;
+
+    struct Node {
+        int64_t key;
+        uint64_t quantity;
+        Node* left;
+        Node* right;
+        uint32_t count;
+        uint32_t priority;
+        uint32_t epoch;
+    };
+
+    /**
+     * @brief Add quantity and count to the level at key
+     * A missing level is created; one whose count drops to 0 is removed.
+     */
+    static Node* adjust(Node* node, int64_t key, int64_t quantity, int32_t count, VersionEditor& editor) {
+        if (!node) {
+            Node* level = new (editor.allocate(kSizeClass, sizeof(Node))) Node{
+                key, static_cast<uint64_t>(quantity), nullptr, nullptr,
+                static_cast<uint32_t>(count), priority(key), editor.epoch};
+            return level;
+        }
+        node = own(node, editor);
+        if (key < node->key) {
+            node->left = adjust(node->left, key, quantity, count, editor);
+            if (node->left && node->left->priority > node->priority) node = rotate_right(node);
+        } else if (key > node->key) {
+            node->right = adjust(node->right, key, quantity, count, editor);
+            if (node->right && node->right->priority > node->priority) node = rotate_left(node);
+        } else {
+            node->quantity += static_cast<uint64_t>(quantity);
+            node->count += static_cast<uint32_t>(count);
+            if (node->count == 0) {
+                Node* rest = merge(node->left, node->right, editor);
+                editor.release(kSizeClass, node, node->epoch);
+                return rest;
+            }
+        }
+        return node;
+    }
+
+    // Best to worst until fn(node) returns false; false if it did
+    template <typename Fn>
+    static bool visit(const Node* node, Fn& fn) {
+        if (!node) return true;
+        return visit(node->left, fn) && fn(*node) && visit(node->right, fn);
+    }
+
+private:
+    static uint32_t priority(int64_t key) {
+        uint64_t h = static_cast<uint64_t>(key) * 0x9e3779b97f4a7c15ull;
+        return static_cast<uint32_t>(h >> 32);
+    }
+
+    static Node* own(Node* node, VersionEditor& editor) {
+        if (node->epoch == editor.epoch) return node;
+        Node* copy = new (editor.allocate(kSizeClass, sizeof(Node))) Node(*node);
+        copy->epoch = editor.epoch;
+        return copy;
+    }
+
+    // Both rotations run on nodes the editor already owns
+    static Node* rotate_right(Node* node) {
+        Node* left = node->left;
+        node->left = left->right;
+        left->right = node;
+        return left;
+    }
+    static Node* rotate_left(Node* node) {
+        Node* right = node->right;
+        node->right = right->left;
+        right->left = node;
+        return right;
+    }
+
+    static Node* merge(Node* a, Node* b, VersionEditor& editor) {
+        if (!a) return b;
+        if (!b) return a;
+        if (a->priority > b->priority) {
+            a = own(a, editor);
+            a->right = merge(a->right, b, editor);
+            return a;
+        }
+        b = own(b, editor);
+        b->left = merge(a, b->left, editor);
+        return b;
+    }
+};
+
+/**
+ * @brief Roots of one book version: orders by ID, and both sides' levels
+ */
+struct BookState {
+    OrderTrie::Node* orders = nullptr;
+    LevelTreap::Node* bids = nullptr;  // Keyed by -ticks: best (highest) first
+    LevelTreap::Node* asks = nullptr;  // Keyed by ticks: best (lowest) first
+    size_t size = 0;
+};
+
+/**
+ * @brief The book as it stood after some number of commands
+ *
+ * Cheap to copy: a version shares every node with its neighbours. Reads
+ * may run on any thread. A version must not outlive its BookHistory.
+ */
+class BookVersion {
+public:
+    uint64_t sequence() const { return sequence_; }
+    size_t size() const { return state_.size; }
+
+    const Order* get_order(uint64_t order_id) const { return OrderTrie::find(state_.orders, order_id); }
+
+    // Price levels of side, best to worst, until fn(LevelQuote) returns false
+    template <typename Fn>
+    void visit_levels(Side side, Fn&& fn) const {
+        const bool buy = side == Side::Buy;
+        auto at_price = [&](const LevelTreap::Node& level) {
+            const int64_t ticks = buy ? -level.key : level.key;
+            return fn(LevelQuote{grid_.to_price(ticks), level.quantity, level.count});
+        };
+        LevelTreap::visit(buy ? state_.bids : state_.asks, at_price);
+    }
+
+    LevelQuote best_quote(Side side) const {
+        LevelQuote quote;
+        visit_levels(side, [&quote](const LevelQuote& level) {
+            quote = level;
+            return false;
+        });
+        return quote;
+    }
+
+    // Every resting order, in no particular order
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        OrderTrie::for_each(state_.orders, fn);
+    }
+
+private:
+    friend class BookHistory;
+
+    BookVersion(const BookState& state, uint64_t sequence, const TickGrid& grid,
+                std::shared_ptr<std::pmr::memory_resource> scratch)
+        : state_(state), sequence_(sequence), grid_(grid), scratch_(std::move(scratch)) {}
+
+    BookState state_;
+    uint64_t sequence_;
+    TickGrid grid_;
+    std::shared_ptr<std::pmr::memory_resource> scratch_;  // Nodes of a replayed gap, if any
+};
+
+/**
+ * @brief A day's command stream, queryable at any sequence number
+ *
+ * Commands are applied to a persistent book (OrderTrie for the orders, a
+ * LevelTreap per side) and logged. Every interval commands the current
+ * roots are frozen as a version: a few roots, sharing every node the
+ * following commands do not change. at(n) starts from the last version
+ * at or before n and replays at most interval - 1 logged commands on
+ * private copies, so a point-in-time query costs O(log n) per step of a
+ * short replay instead of a replay from the open.
+ *
+ * Commands behave as on a TreeOrderManager with the same tick size (plain
+ * limit orders: no accounts, expiry or risk checks), and apply() returns
+ * the same OrderStatus. Sequence n means "after the first n commands",
+ * rejected ones included.
+ */
+class BookHistory {
+public:
+    explicit BookHistory(double tick_size = 0.01, uint64_t interval = 4096,
+                         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : grid_(tick_size),
+          interval_(std::max<uint64_t>(interval, 1)),
+          resource_(resource),
+          pool_(resource),
+          log_(resource),
+          versions_(resource) {
+        editor_.pool = &pool_;
+        editor_.epoch = kFirstEpoch;
+        versions_.push_back(Version{0, BookState{}});
+    }
+
+    BookHistory(const BookHistory&) = delete;
+    BookHistory& operator=(const BookHistory&) = delete;
+
+    // Apply and log one command; snapshot, stats and time commands change nothing
+    OrderStatus apply(const Command& command) {
+        const OrderStatus status = apply_to(head_, command, grid_, editor_);
+        log_.push_back(command);
+        if (log_.size() % interval_ == 0) {
+            versions_.push_back(Version{log_.size(), head_});
+            editor_.epoch++;  // Freeze: from now on the head copies before it writes
+        }
+        return status;
+    }
+
+    // Commands applied so far
+    uint64_t sequence() const { return log_.size(); }
+
+    /**
+     * @brief The book after the first sequence commands (clamped to sequence())
+     * Replays the gap from the nearest version into memory the returned
+     * version owns; the history itself is not changed.
+     */
+    BookVersion at(uint64_t sequence) const {
+        sequence = std::min<uint64_t>(sequence, log_.size());
+        auto it = std::upper_bound(versions_.begin(), versions_.end(), sequence,
+                                   [](uint64_t seq, const Version& v) { return seq < v.sequence; });
+        const Version& base = *(it - 1);
+        if (base.sequence == sequence) return BookVersion(base.state, sequence, grid_, nullptr);
+
+        auto scratch = std::make_shared<std::pmr::monotonic_buffer_resource>(resource_);
+        VersionEditor editor;
+        editor.scratch = scratch.get();
+        editor.epoch = kScratchEpoch;
+        BookState state = base.state;
+        for (uint64_t i = base.sequence; i < sequence; ++i) apply_to(state, log_[i], grid_, editor);
+        return BookVersion(state, sequence, grid_, std::move(scratch));
+    }
+
+    size_t version_count() const { return versions_.size(); }
+    uint64_t interval() const { return interval_; }
+    // Node memory shared by all versions and the head, excluding the command log
+    size_t node_bytes() const { return pool_.bytes(); }
+
+private:
+    struct Version {
+        uint64_t sequence;
+        BookState state;
+    };
+
+    static constexpr uint32_t kScratchEpoch = 0;
+    static constexpr uint32_t kFirstEpoch = 1;
+
+    TickGrid grid_;
+    uint64_t interval_;
+    std::pmr::memory_resource* resource_;
+    VersionNodePool pool_;
+    VersionEditor editor_;
+    BookState head_;
+    std::pmr::vector<Command> log_;
+    std::pmr::vector<Version> versions_;
+
+    static LevelTreap::Node*& side_levels(BookState& state, const Order& order) {
+        return order.is_buy() ? state.bids : state.asks;
+    }
+    static int64_t level_key(const TickGrid& grid, const Order& order) {
+        const int64_t ticks = grid.to_ticks(order.price);
+        return order.is_buy() ? -ticks : ticks;
+    }
+
+    static void add(BookState& state, const Order& order, const TickGrid& grid, VersionEditor& editor) {
+        state.orders = OrderTrie::insert(state.orders, order, editor);
+        LevelTreap::Node*& levels = side_levels(state, order);
+        levels = LevelTreap::adjust(levels, level_key(grid, order), order.quantity, 1, editor);
+        state.size++;
+    }
+
+    // order by value: it may live in a trie node the erase rewrites
+    static void remove(BookState& state, const Order order, const TickGrid& grid, VersionEditor& editor) {
+        state.orders = OrderTrie::erase(state.orders, order.id, editor);
+        LevelTreap::Node*& levels = side_levels(state, order);
+        levels = LevelTreap::adjust(levels, level_key(grid, order), -static_cast<int64_t>(order.quantity), -1,
+                                    editor);
+        state.size--;
+    }
+
+    // Take quantity off a resting order that stays on the book
+    static void reduce(BookState& state, Order order, uint32_t quantity, const TickGrid& grid,
+                       VersionEditor& editor) {
+        LevelTreap::Node*& levels = side_levels(state, order);
+        levels = LevelTreap::adjust(levels, level_key(grid, order), -static_cast<int64_t>(quantity), 0, editor);
+        order.quantity -= quantity;
+        state.orders = OrderTrie::assign(state.orders, order, editor);
+    }
+
+    static OrderStatus apply_to(BookState& state, const Command& command, const TickGrid& grid,
+                                VersionEditor& editor) {
+        const Order* resting = command.kind == CommandKind::Add ? nullptr
+                                                                : OrderTrie::find(state.orders, command.id);
+        switch (command.kind) {
+            case CommandKind::Add: {
+                const Order order(command.id, command.price, command.quantity, command.side);
+                if (!grid.on_grid(order.price)) return OrderStatus::InvalidPrice;
+                if (OrderTrie::find(state.orders, order.id)) return OrderStatus::Duplicate;
+                add(state, order, grid, editor);
+                return OrderStatus::Ok;
+            }
+            case CommandKind::Cancel:
+                if (!resting) return OrderStatus::UnknownId;
+                remove(state, *resting, grid, editor);
+                return OrderStatus::Ok;
+            case CommandKind::Execute:
+                if (!resting) return OrderStatus::UnknownId;
+                if (command.quantity >= resting->quantity) {
+                    remove(state, *resting, grid, editor);
+                } else {
+                    reduce(state, *resting, command.quantity, grid, editor);
+                }
+                return OrderStatus::Ok;
+            case CommandKind::Modify: {
+                if (!resting) return OrderStatus::UnknownId;
+                const Order before = *resting;
+                if (command.quantity == 0) {
+                    remove(state, before, grid, editor);
+                } else if (command.price == before.price && command.quantity <= before.quantity) {
+                    reduce(state, before, before.quantity - command.quantity, grid, editor);
+                } else {
+                    Order after = before;
+                    after.price = command.price;
+                    after.quantity = command.quantity;
+                    if (!grid.on_grid(after.price)) return OrderStatus::InvalidPrice;
+                    remove(state, before, grid, editor);
+                    add(state, after, grid, editor);
+                }
+                return OrderStatus::Ok;
+            }
+            case CommandKind::Clear:
+                state = BookState{};
+                return OrderStatus::Ok;
+            case CommandKind::Snapshot:
+            case CommandKind::Stats:
+            case CommandKind::Time:
+                return OrderStatus::Ok;
+        }
+        return OrderStatus::ParseError;
+    }
+};
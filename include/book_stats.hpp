@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+/**
+ * @brief Instrumentation policy: running totals of book activity
+ *
+ * The counters OrderManager has always reported. Every hook is inline, so
+ * the cost is one increment per event.
+ *
+ * The counters fill a cache line of their own: a monitoring thread polling
+ * them never pulls in the line holding the book's index or levels, and the
+ * book's writes to those never invalidate the poller's copy.
+ */
+class alignas(64) CountingStats {
+private:
+    uint64_t total_orders_added_ = 0;
+    uint64_t total_orders_cancelled_ = 0;
+    uint64_t total_executions_ = 0;
+    uint64_t total_orders_expired_ = 0;
+    uint64_t total_orders_modified_ = 0;
+
+public:
+    void on_add() { total_orders_added_++; }
+    void on_cancel() { total_orders_cancelled_++; }
+    void on_execute() { total_executions_++; }
+    void on_expire() { total_orders_expired_++; }
+    void on_modify() { total_orders_modified_++; }
+
+    void reset() {
+        total_orders_added_ = 0;
+        total_orders_cancelled_ = 0;
+        total_executions_ = 0;
+        total_orders_expired_ = 0;
+        total_orders_modified_ = 0;
+    }
+
+    uint64_t orders_added() const { return total_orders_added_; }
+    uint64_t orders_cancelled() const { return total_orders_cancelled_; }
+    uint64_t executions() const { return total_executions_; }
+    uint64_t orders_expired() const { return total_orders_expired_; }
+    uint64_t orders_modified() const { return total_orders_modified_; }
+
+    void print(std::ostream& os) const {
+        os << "Total Orders Added: " << total_orders_added_ << std::endl;
+        os << "Total Orders Cancelled: " << total_orders_cancelled_ << std::endl;
+        os << "Total Executions: " << total_executions_ << std::endl;
+        os << "Total Orders Expired: " << total_orders_expired_ << std::endl;
+        os << "Total Orders Modified: " << total_orders_modified_ << std::endl;
+    }
+};
+static_assert(sizeof(CountingStats) == 64, "CountingStats should fill exactly one cache line");
+static_assert(alignof(CountingStats) == 64, "CountingStats should share no cache line with book data");
+
+/**
+ * @brief Instrumentation policy: no instrumentation at all
+ *
+ * Every hook compiles away, for engines that collect metrics elsewhere.
+ */
+class NullStats {
+public:
+    void on_add() {}
+    void on_cancel() {}
+    void on_execute() {}
+    void on_expire() {}
+    void on_modify() {}
+    void reset() {}
+
+    uint64_t orders_added() const { return 0; }
+    uint64_t orders_cancelled() const { return 0; }
+    uint64_t executions() const { return 0; }
+    uint64_t orders_expired() const { return 0; }
+    uint64_t orders_modified() const { return 0; }
+
+    void print(std::ostream&) const {}
+};
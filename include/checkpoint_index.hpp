@@ -0,0 +1,195 @@
+#pragma once
+
+#include "order_manager.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Random access into a day's command replay
+ *
+ * While a command stream is replayed, CheckpointWriter periodically
+ * appends the whole book to <prefix>.ckpt, as back-to-back LOBSNAP1
+ * binary snapshots, and one CheckpointEntry per snapshot to <prefix>.ckix:
+ * a 16-byte header ("LOBCKIX1", uint32 version, uint32 flags) followed by
+ * 32-byte entries in native byte order. Each entry ties a snapshot to the
+ * number of commands applied before it, the book clock, and the byte
+ * offset of the next command in the replayed stream.
+ *
+ * A seek looks up the last checkpoint at or before the target, maps the
+ * checkpoint file, rebuilds the book from that snapshot and replays only
+ * the commands after it. Any number of readers can map the same files, so
+ * many backtests can start mid-day at once.
+ *
+ * A checkpoint holds the order records and the clock, nothing else: no
+ * accounts, expiries, risk usage or reference price. Books using any of
+ * those are refused at both ends (Unsupported) rather than checkpointed
+ * into something a seek could not rebuild.
+ */
+struct CheckpointEntry {
+    uint64_t sequence = 0;      // Commands applied before the checkpoint
+    Timestamp timestamp = 0;    // Book clock at the checkpoint
+    uint64_t offset = 0;        // Of its snapshot in the checkpoint file
+    uint64_t input_offset = 0;  // Of the next command in the replayed stream
+};
+static_assert(sizeof(CheckpointEntry) == 32, "checkpoint index entries are 32 bytes on disk");
+
+/**
+ * @brief Appends checkpoints to <prefix>.ckpt and <prefix>.ckix
+ *
+ * Each snapshot is flushed before its index entry is written, so an index
+ * cut short by a crash never points past the data. A failed snapshot write
+ * is rewound and can be retried; a failed index write may leave part of an
+ * entry behind, so the writer then refuses every later checkpoint until it
+ * is reopened.
+ */
+class CheckpointWriter {
+public:
+    CheckpointWriter() = default;
+    ~CheckpointWriter() { close(); }
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    /**
+     * @brief Create (truncate) both files
+     * @param binary_input Whether the replayed stream is binary LOBCMDS1,
+     *        so a seek can resume it without its header
+     * @return Ok or IoError
+     */
+    OrderStatus open(const std::string& prefix, bool binary_input);
+
+    /**
+     * @brief Checkpoint book after sequence commands
+     * @param input_offset Byte offset of the next command in the stream
+     * @return Ok, Unsupported if book has accounts, expiries or risk
+     *         checks, or IoError
+     */
+    template <typename Book>
+    OrderStatus write(const Book& book, uint64_t sequence, uint64_t input_offset) {
+        if (book.active_accounts() != 0 || book.pending_expiries() != 0 || book.risk_enabled()) {
+            return OrderStatus::Unsupported;
+        }
+        book.capture_snapshot(orders_);
+        CheckpointEntry entry;
+        entry.sequence = sequence;
+        entry.timestamp = book.current_time();
+        entry.input_offset = input_offset;
+        return append(orders_, entry);
+    }
+
+    // As write(), from already captured orders; entry.offset is filled in
+    OrderStatus append(const std::vector<Order>& orders, CheckpointEntry entry);
+
+    // Ok, or IoError if either file failed to close cleanly
+    OrderStatus close();
+
+    bool is_open() const { return data_ != nullptr; }
+    // An index write failed: every append returns IoError until reopened
+    bool failed() const { return failed_; }
+    size_t count() const { return count_; }
+
+private:
+    std::FILE* data_ = nullptr;
+    std::FILE* index_ = nullptr;
+    uint64_t offset_ = 0;  // Size of the checkpoint file so far
+    size_t count_ = 0;
+    bool failed_ = false;
+    std::vector<Order> orders_;  // Capture buffer, reused across checkpoints
+};
+
+/**
+ * @brief The entries of <prefix>.ckix, searchable by sequence and time
+ */
+class CheckpointIndex {
+public:
+    /**
+     * @brief Read the index; a trailing partial entry is ignored
+     * @return Ok, IoError, or ParseError for a bad header or unordered entries
+     */
+    OrderStatus load(const std::string& prefix);
+
+    // Last checkpoint with sequence <= sequence, or nullptr if none
+    const CheckpointEntry* at_sequence(uint64_t sequence) const;
+    // Last checkpoint with timestamp <= time, or nullptr if none
+    const CheckpointEntry* at_time(Timestamp time) const;
+
+    bool binary_input() const { return binary_input_; }
+    const std::vector<CheckpointEntry>& entries() const { return entries_; }
+    size_t size() const { return entries_.size(); }
+
+private:
+    std::vector<CheckpointEntry> entries_;
+    bool binary_input_ = false;
+};
+
+/**
+ * @brief Read-only view of <prefix>.ckpt
+ *
+ * Memory-mapped where the platform has mmap, so opening costs nothing and
+ * a seek touches only the pages of the one snapshot it loads; elsewhere
+ * the file is read whole.
+ */
+class CheckpointFile {
+public:
+    CheckpointFile() = default;
+    ~CheckpointFile() { close(); }
+
+    CheckpointFile(const CheckpointFile&) = delete;
+    CheckpointFile& operator=(const CheckpointFile&) = delete;
+
+    // Ok or IoError
+    OrderStatus open(const std::string& prefix);
+    void close();
+
+    /**
+     * @brief The records of the snapshot entry points at, inside the mapping
+     * @return Ok, or ParseError if entry does not point at a whole snapshot
+     */
+    OrderStatus orders_at(const CheckpointEntry& entry, const Order*& orders, size_t& count) const;
+
+    size_t size() const { return size_; }
+    bool mapped() const { return mapped_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<char> buffer_;  // Without mmap: the whole file
+};
+
+/**
+ * @brief Replace book's contents with the checkpoint entry points at
+ *
+ * Records go back in capture order, which keeps each level's time
+ * priority, and the book clock is moved up to the checkpoint's. A book
+ * with risk checks is refused untouched, since the restore adds would be
+ * checked against limits the checkpoint has no usage for. Any later
+ * failure leaves the book empty, never half restored.
+ * @return Ok, Unsupported for a risk-checked book, ParseError for a bad
+ *         entry or duplicate records, or whatever the book rejected a
+ *         reservation or record with
+ */
+template <typename Book>
+OrderStatus restore_checkpoint(const CheckpointFile& file, const CheckpointEntry& entry, Book& book) {
+    if (book.risk_enabled()) return OrderStatus::Unsupported;
+    const Order* orders = nullptr;
+    size_t count = 0;
+    const OrderStatus status = file.orders_at(entry, orders, count);
+    if (status != OrderStatus::Ok) return status;
+    book.clear();
+    // Sized up front: an unsorted book's records come in its hash table's
+    // slot order, which piles into long probe runs in a table still growing
+    const OrderStatus reserved = book.reserve(count);
+    if (reserved != OrderStatus::Ok) return reserved;
+    for (size_t i = 0; i < count; ++i) {
+        const OrderStatus added = book.try_add_order(orders[i]);
+        if (added != OrderStatus::Ok) {
+            book.clear();
+            return added == OrderStatus::Duplicate ? OrderStatus::ParseError : added;
+        }
+    }
+    book.advance_time(entry.timestamp);
+    return OrderStatus::Ok;
+}
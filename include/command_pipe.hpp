@@ -0,0 +1,165 @@
+#pragma once
+
+#include "order.hpp"
+#include "order_status.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief One scripted book command
+ *
+ * Text form, one per line, fields separated by blanks:
+ *   add <id> <price> <qty> <side>   cancel <id>
+ *   modify <id> <price> <qty>       execute <id> <qty>
+ *   snapshot   stats   clear
+ *   time <t>                        (advance the book clock to t; t is
+ *                                    carried in the id field)
+ * Blank lines and lines starting with '#' are skipped.
+ *
+ * Binary form: a 16-byte header ("LOBCMDS1", uint32 version, uint32
+ * record size) followed by raw 24-byte Command records in native byte
+ * order, as for LOBSNAP1 snapshots.
+ */
+enum class CommandKind : uint8_t { Add = 1, Cancel, Modify, Execute, Snapshot, Stats, Clear, Time };
+
+struct Command {
+    CommandKind kind = CommandKind::Add;
+    uint8_t side = 0;
+    uint16_t reserved = 0;
+    uint32_t quantity = 0;
+    uint64_t id = 0;
+    double price = 0.0;
+};
+static_assert(sizeof(Command) == 24, "binary command records are 24 bytes");
+
+/**
+ * @brief Parse one text command (no trailing newline)
+ * @return Ok, or ParseError for an unknown command or bad arguments
+ */
+OrderStatus parse_command_line(std::string_view line, Command& out) noexcept;
+
+/**
+ * @brief Reads commands, text or binary, from a stream in large blocks
+ *
+ * The format is detected from the first bytes. Input is consumed in
+ * 1 MiB reads and parsed straight out of the buffer: no per-line string,
+ * stream or allocation. Malformed text lines are counted and skipped.
+ *
+ * position() is the byte offset of the next undecoded command, so a
+ * caller can note where it stands and later resume there by seeking the
+ * stream and constructing a reader with the format already known.
+ */
+class CommandReader {
+public:
+    static constexpr size_t kBlockSize = size_t{1} << 20;
+
+    explicit CommandReader(std::FILE* in);
+    // For a stream positioned mid-way, past the header: no detection
+    CommandReader(std::FILE* in, bool binary);
+
+    /**
+     * @brief Decode up to max commands into out
+     * @return Number decoded; 0 once the input is exhausted
+     */
+    size_t read(Command* out, size_t max);
+
+    bool binary() const { return binary_; }
+    // Bytes consumed since construction, up to the next undecoded command
+    uint64_t position() const { return base_ + begin_; }
+    size_t malformed() const { return malformed_; }
+
+private:
+    bool refill();
+    bool detect();
+
+    std::FILE* in_;
+    std::vector<char> buffer_;
+    size_t begin_ = 0;  // Unconsumed input is buffer_[begin_, end_)
+    size_t end_ = 0;
+    uint64_t base_ = 0;  // Stream bytes before buffer_[0]
+    bool eof_ = false;
+    bool detected_ = false;
+    bool binary_ = false;
+    size_t malformed_ = 0;
+};
+
+/**
+ * @brief Write the binary stream header, then records, to out
+ * @return Ok or IoError
+ */
+OrderStatus write_command_header(std::FILE* out);
+OrderStatus write_commands(std::FILE* out, const Command* commands, size_t count);
+
+/**
+ * @brief Apply commands to book in order
+ *
+ * Runs of adds and runs of cancels go through the book's batched
+ * add_orders / cancel_orders, which prefetch a whole burst before
+ * applying it and still report every command's own OrderStatus.
+ * @param os Receives the output of snapshot and stats commands
+ * @param statuses Optional output array of count statuses
+ * @return Number of commands rejected by the book
+ */
+template <typename Book>
+size_t apply_commands(Book& book, const Command* commands, size_t count, std::ostream& os,
+                      OrderStatus* statuses = nullptr) {
+    constexpr size_t kRun = 256;
+    Order orders[kRun];
+    uint64_t ids[kRun];
+    size_t rejected = 0;
+
+    for (size_t i = 0; i < count;) {
+        const Command& command = commands[i];
+        if (command.kind == CommandKind::Add) {
+            const size_t first = i;
+            size_t n = 0;
+            for (; i < count && n < kRun && commands[i].kind == CommandKind::Add; ++i, ++n) {
+                orders[n] = Order(commands[i].id, commands[i].price, commands[i].quantity, commands[i].side);
+            }
+            rejected += n - book.add_orders(orders, n, statuses ? statuses + first : nullptr);
+            continue;
+        }
+        if (command.kind == CommandKind::Cancel) {
+            const size_t first = i;
+            size_t n = 0;
+            for (; i < count && n < kRun && commands[i].kind == CommandKind::Cancel; ++i, ++n) {
+                ids[n] = commands[i].id;
+            }
+            rejected += n - book.cancel_orders(ids, n, statuses ? statuses + first : nullptr);
+            continue;
+        }
+
+        OrderStatus status = OrderStatus::Ok;
+        switch (command.kind) {
+            case CommandKind::Add:
+            case CommandKind::Cancel:
+                break;  // Batched above
+            case CommandKind::Modify:
+                status = book.try_modify_order(command.id, command.price, command.quantity);
+                break;
+            case CommandKind::Execute:
+                status = book.try_execute_order(command.id, command.quantity);
+                break;
+            case CommandKind::Snapshot:
+                book.print_snapshot(os);
+                break;
+            case CommandKind::Stats:
+                book.print_stats(os);
+                break;
+            case CommandKind::Clear:
+                book.clear();
+                break;
+            case CommandKind::Time:
+                book.advance_time(command.id);
+                break;
+        }
+        rejected += status != OrderStatus::Ok;
+        if (statuses) statuses[i] = status;
+        ++i;
+    }
+    return rejected;
+}
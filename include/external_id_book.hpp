@@ -0,0 +1,109 @@
+#pragma once
+
+#include "id_interner.hpp"
+#include "order_manager.hpp"
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+
+/**
+ * @brief A book addressed by external string order IDs
+ *
+ * Each message's string ID is resolved once, at entry, through an
+ * IdInterner; the wrapped book only ever sees the dense InternalId as its
+ * Order::id. Over a DirectIndex book (LadderOrderManager) that makes the
+ * string lookup the only hash probe per message: the book's own ID lookup
+ * is an array load. The interned ID is released as soon as its order
+ * leaves the book, so the ID range tracks the peak number of live orders.
+ *
+ * The book is only reachable const: every removal must come through here
+ * so the interner stays in step (no expiry or account mass cancel).
+ */
+template <typename Book>
+class ExternalIdBook {
+private:
+    Book book_;
+    IdInterner ids_;
+
+    // After an execute or modify: forget id if the order has left the book
+    void release_if_gone(InternalId id) {
+        if (!book_.get_order(id)) ids_.release(id);
+    }
+
+public:
+    explicit ExternalIdBook(Book book,
+                            std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : book_(std::move(book)), ids_(resource) {}
+
+    /**
+     * @brief Add an order under external_id
+     *
+     * options may carry an account, but not an expiry: an order the book
+     * expired would leave its ID interned, and no clock is exposed here.
+     * @return Ok, Unsupported for an expiring order, ParseError for an
+     *         empty or over-long ID, Duplicate if the ID is live, BookFull
+     *         if the interner cannot grow, or any rejection of the wrapped
+     *         book
+     */
+    OrderStatus try_add_order(std::string_view external_id, double price, uint32_t quantity,
+                              uint8_t side, const OrderOptions& options = OrderOptions()) noexcept {
+        if (options.expires_at != kNoExpiry) return OrderStatus::Unsupported;
+        InternalId id;
+        OrderStatus status = ids_.intern(external_id, id);
+        if (status != OrderStatus::Ok) return status;
+        status = book_.try_add_order(Order(id, price, quantity, side), options);
+        if (status != OrderStatus::Ok) ids_.release(id);
+        return status;
+    }
+
+    OrderStatus try_cancel_order(std::string_view external_id) noexcept {
+        const InternalId id = ids_.find(external_id);
+        if (id == kNoInternalId) return OrderStatus::UnknownId;
+        const OrderStatus status = book_.try_cancel_order(id);
+        if (status == OrderStatus::Ok) ids_.release(id);
+        return status;
+    }
+
+    OrderStatus try_execute_order(std::string_view external_id, uint32_t quantity) noexcept {
+        const InternalId id = ids_.find(external_id);
+        if (id == kNoInternalId) return OrderStatus::UnknownId;
+        const OrderStatus status = book_.try_execute_order(id, quantity);
+        if (status == OrderStatus::Ok) release_if_gone(id);
+        return status;
+    }
+
+    OrderStatus try_modify_order(std::string_view external_id, double price, uint32_t quantity) noexcept {
+        const InternalId id = ids_.find(external_id);
+        if (id == kNoInternalId) return OrderStatus::UnknownId;
+        const OrderStatus status = book_.try_modify_order(id, price, quantity);
+        if (status == OrderStatus::Ok) release_if_gone(id);
+        return status;
+    }
+
+    // Resting order under external_id, or nullptr; its id is the internal one
+    const Order* get_order(std::string_view external_id) const noexcept {
+        const InternalId id = ids_.find(external_id);
+        return id == kNoInternalId ? nullptr : book_.get_order(id);
+    }
+
+    InternalId internal_id(std::string_view external_id) const { return ids_.find(external_id); }
+    // For reporting fills and snapshots of the book in the venue's IDs
+    std::string_view external_id(uint64_t internal_id) const {
+        return ids_.external_id(static_cast<InternalId>(internal_id));
+    }
+
+    const Book& book() const { return book_; }
+    const IdInterner& ids() const { return ids_; }
+    size_t size() const { return book_.size(); }
+
+    // Ok, or BookFull if the interner or the book's index could not be allocated
+    OrderStatus reserve(size_t expected_orders) {
+        if (!ids_.reserve(expected_orders)) return OrderStatus::BookFull;
+        return book_.reserve(expected_orders);
+    }
+
+    void clear() {
+        book_.clear();
+        ids_.clear();
+    }
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * @brief Binary indexed tree of non-negative counts
+ *
+ * Point updates, prefix sums and "first position whose prefix sum reaches
+ * a target" all run in O(log n) over a flat array, with no per-node
+ * pointers. Used for cumulative depth over a price ladder.
+ */
+class FenwickTree {
+private:
+    std::pmr::vector<int64_t> tree_;  // 1-based; tree_[0] is unused
+    size_t top_bit_ = 0;              // Highest power of two <= size()
+
+public:
+    explicit FenwickTree(size_t n = 0,
+                         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : tree_(n + 1, 0, resource),
+          top_bit_(n ? size_t{1} << (63 - __builtin_clzll(n)) : 0) {}
+
+    size_t size() const { return tree_.size() - 1; }
+
+    // values[i] += delta
+    void add(size_t i, int64_t delta) {
+        for (++i; i < tree_.size(); i += i & (~i + 1)) tree_[i] += delta;
+    }
+
+    // Sum of values[0..i]; 0 when i is past the front (use prefix(i - 1) freely)
+    int64_t prefix(ptrdiff_t i) const {
+        int64_t sum = 0;
+        if (i >= static_cast<ptrdiff_t>(size())) i = static_cast<ptrdiff_t>(size()) - 1;
+        for (size_t j = static_cast<size_t>(i + 1); j > 0; j &= j - 1) sum += tree_[j];
+        return sum;
+    }
+
+    /**
+     * @brief First position whose prefix sum reaches target (target > 0)
+     * @return size() if the total is below target
+     */
+    size_t lower_bound(int64_t target) const {
+        size_t pos = 0;
+        for (size_t step = top_bit_; step > 0; step >>= 1) {
+            if (pos + step < tree_.size() && tree_[pos + step] < target) {
+                pos += step;
+                target -= tree_[pos];
+            }
+        }
+        return pos;
+    }
+
+    void clear() { std::fill(tree_.begin(), tree_.end(), 0); }
+};
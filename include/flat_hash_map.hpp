@@ -0,0 +1,431 @@
+#pragma once
+
+#include "prefetch.hpp"
+#include "try_allocate.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief When a FlatHashMap moves its entries into a larger table
+ */
+enum class RehashPolicy : uint8_t {
+    Immediate,   // Whole table migrates inside the insert that crosses the threshold
+    Incremental  // A few slots migrate per mutation until the old table drains
+};
+
+/**
+ * @brief Open-addressing hash map keyed by 64-bit order IDs
+ *
+ * Performance considerations:
+ * - Linear probing over a flat slot array: one cache miss per lookup
+ * - Separate control bytes so probes do not drag whole slots into cache
+ * - Incremental rehash: growing allocates the new table and then migrates
+ *   a fixed number of old slots per mutation, so no single insert pays for
+ *   the whole table (the same scheme Redis uses for its dict)
+ * - Every key bit is mixed into the home slot (see home_slot), so runs of
+ *   sequential IDs scatter instead of filling one long probe run
+ * - Migration empties each run of old slots once all of it has moved, so
+ *   lookups still checking the old table stop at once for keys whose run
+ *   is done, and never walk further than the run the key was in
+ * - Control bytes come from calloc, so large tables get zero pages lazily
+ *   instead of a memset inside the growing insert
+ * - Tables can instead come from a caller-supplied memory resource (an
+ *   arena, say); the global heap resource keeps the calloc path
+ *
+ * Pointers returned by find()/insert() are invalidated by the next insert
+ * or erase. Values must be trivially copyable. The map never throws: a
+ * table that cannot be allocated, from the heap or from the memory
+ * resource, makes insert() fail and reserve() return false.
+ */
+template <typename V>
+class FlatHashMap {
+    static_assert(std::is_trivially_copyable<V>::value,
+                  "FlatHashMap values are relocated with plain copies");
+
+public:
+    struct Slot {
+        uint64_t key;
+        V value;
+    };
+
+private:
+    static constexpr uint8_t kEmpty = 0;
+    static constexpr uint8_t kTombstone = 1;
+    static constexpr uint8_t kFull = 2;
+
+    static constexpr size_t kMinCapacity = 16;
+
+    // Old slots migrated per mutation. Must exceed 1/max_load_factor so the
+    // old table drains before the new one reaches its own threshold.
+    static constexpr size_t kMigrateSlots = 16;
+
+    struct Table {
+        uint8_t* ctrl = nullptr;
+        Slot* slots = nullptr;
+        size_t capacity = 0;  // Power of two (or zero)
+        unsigned shift = 0;   // log2(capacity)
+        size_t size = 0;      // Live entries
+        size_t used = 0;      // Live entries + tombstones
+    };
+
+    std::pmr::memory_resource* resource_;  // nullptr: calloc/free
+    Table cur_;
+    Table old_;                 // Non-empty only while a rehash is in progress
+    size_t migrate_pos_ = 0;    // old_ slots migrated so far
+    size_t migrate_start_ = 0;  // First old_ slot to migrate: an empty one
+    size_t run_start_ = 0;      // old_ slots migrated before the current run
+    float max_load_ = 0.75f;
+    RehashPolicy policy_ = RehashPolicy::Incremental;
+
+public:
+    explicit FlatHashMap(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource_(resource == std::pmr::new_delete_resource() ? nullptr : resource) {}
+    ~FlatHashMap() {
+        release(cur_);
+        release(old_);
+    }
+
+    FlatHashMap(const FlatHashMap&) = delete;
+    FlatHashMap& operator=(const FlatHashMap&) = delete;
+
+    FlatHashMap(FlatHashMap&& other) noexcept : resource_(nullptr) { swap(other); }
+    FlatHashMap& operator=(FlatHashMap&& other) noexcept {
+        if (this != &other) {
+            release(cur_);
+            release(old_);
+            migrate_pos_ = 0;
+            swap(other);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Home slot of key in a table of 2^shift slots
+     *
+     * Every bit is mixed (murmur3 finalizer) and the low bits kept.
+     * Sequential IDs, the common exchange scheme, lose their locality, but
+     * cannot line up into one run of full slots and tombstones as long as
+     * the book, where every lookup that starts inside it walks to its end.
+     */
+    static size_t home_slot(uint64_t key, unsigned shift) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return static_cast<size_t>(key) & ((size_t{1} << shift) - 1);
+    }
+
+    V* find(uint64_t key) {
+        Slot* slot = find_slot(key);
+        return slot ? &slot->value : nullptr;
+    }
+
+    const V* find(uint64_t key) const {
+        return const_cast<FlatHashMap*>(this)->find(key);
+    }
+
+    /**
+     * @brief Insert key if absent
+     * @return Pointer to the stored value and whether it was inserted; the
+     *         pointer is null if the table needed to grow and could not
+     */
+    std::pair<V*, bool> insert(uint64_t key, const V& value) {
+        Slot* existing = find_slot(key);
+        if (existing) {
+            return {&existing->value, false};
+        }
+        if (cur_.used + 1 > limit(cur_.capacity) && !grow()) {
+            return {nullptr, false};
+        }
+        Slot* slot = place(cur_, key, value);
+        step_migration();
+        return {&slot->value, true};
+    }
+
+    bool erase(uint64_t key) {
+        V discarded;
+        return take(key, discarded);
+    }
+
+    /**
+     * @brief Erase key and hand back its value, with a single probe
+     */
+    bool take(uint64_t key, V& out) {
+        if (!take_from(cur_, key, out) && !take_from(old_, key, out)) {
+            return false;
+        }
+        step_migration();
+        return true;
+    }
+
+    /**
+     * @brief Pull the home slot of key into cache ahead of a lookup
+     */
+    void prefetch(uint64_t key) const {
+        if (cur_.capacity) {
+            const size_t i = home(cur_, key);
+            LOB_PREFETCH_READ(cur_.ctrl + i);
+            LOB_PREFETCH_READ(cur_.slots + i);
+        }
+        if (old_.capacity) {
+            const size_t i = home(old_, key);
+            LOB_PREFETCH_READ(old_.ctrl + i);
+            LOB_PREFETCH_READ(old_.slots + i);
+        }
+    }
+
+    /**
+     * @brief Size the table for n entries up front (rehashes immediately)
+     * @return false if the table could not be allocated (contents unchanged)
+     */
+    bool reserve(size_t n) {
+        const size_t needed = capacity_for(n);
+        if (needed > cur_.capacity) {
+            finish_migration();
+            if (!rehash_into(needed)) return false;
+            finish_migration();
+        }
+        return true;
+    }
+
+    void clear() {
+        release(old_);
+        migrate_pos_ = 0;
+        if (cur_.capacity) {
+            std::memset(cur_.ctrl, kEmpty, cur_.capacity);
+        }
+        cur_.size = 0;
+        cur_.used = 0;
+    }
+
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        visit(old_, fn);
+        visit(cur_, fn);
+    }
+
+    void set_max_load_factor(float load) { max_load_ = std::clamp(load, 0.25f, 0.95f); }
+    float max_load_factor() const { return max_load_; }
+
+    void set_rehash_policy(RehashPolicy policy) {
+        policy_ = policy;
+        if (policy_ == RehashPolicy::Immediate) finish_migration();
+    }
+    RehashPolicy rehash_policy() const { return policy_; }
+
+    size_t size() const { return cur_.size + old_.size; }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return cur_.capacity; }
+    bool rehashing() const { return old_.capacity != 0; }
+
+    /**
+     * @brief Slots a lookup of key examines, in both tables while rehashing
+     *
+     * For tests and diagnostics: the cost a find, or the duplicate check of
+     * an insert, pays for key.
+     */
+    size_t probe_count(uint64_t key) const {
+        size_t cur = 0;
+        size_t old = 0;
+        if (find_in(cur_, key, &cur)) return cur;
+        find_in(old_, key, &old);
+        return cur + old;
+    }
+    float load_factor() const {
+        return cur_.capacity ? static_cast<float>(cur_.used) / cur_.capacity : 0.0f;
+    }
+
+private:
+    size_t limit(size_t capacity) const {
+        return static_cast<size_t>(capacity * max_load_);
+    }
+
+    size_t capacity_for(size_t n) const {
+        size_t capacity = kMinCapacity;
+        while (limit(capacity) < n) capacity *= 2;
+        return capacity;
+    }
+
+    // Empty table (capacity 0) on failure. Resource tables put the slots and
+    // control bytes in one block; the global heap path keeps calloc.
+    Table allocate(size_t capacity) {
+        Table table;
+        if (resource_) {
+            void* block = nullptr;
+            if (!try_allocate([&] { block = resource_->allocate(block_bytes(capacity), alignof(Slot)); })) {
+                return Table{};
+            }
+            table.slots = static_cast<Slot*>(block);
+            table.ctrl = reinterpret_cast<uint8_t*>(table.slots + capacity);
+            std::memset(table.ctrl, kEmpty, capacity);
+        } else {
+            table.ctrl = static_cast<uint8_t*>(std::calloc(capacity, 1));
+            table.slots = static_cast<Slot*>(std::malloc(capacity * sizeof(Slot)));
+            if (!table.ctrl || !table.slots) {
+                std::free(table.ctrl);
+                std::free(table.slots);
+                return Table{};
+            }
+        }
+        table.capacity = capacity;
+        while ((size_t{1} << table.shift) < capacity) table.shift++;
+        return table;
+    }
+
+    void release(Table& table) {
+        if (resource_) {
+            if (table.capacity) {
+                resource_->deallocate(table.slots, block_bytes(table.capacity), alignof(Slot));
+            }
+        } else {
+            std::free(table.ctrl);
+            std::free(table.slots);
+        }
+        table = Table{};
+    }
+
+    static size_t block_bytes(size_t capacity) { return capacity * (sizeof(Slot) + 1); }
+
+    void swap(FlatHashMap& other) noexcept {
+        std::swap(resource_, other.resource_);
+        std::swap(cur_, other.cur_);
+        std::swap(old_, other.old_);
+        std::swap(migrate_pos_, other.migrate_pos_);
+        std::swap(migrate_start_, other.migrate_start_);
+        std::swap(run_start_, other.run_start_);
+        std::swap(max_load_, other.max_load_);
+        std::swap(policy_, other.policy_);
+    }
+
+    static size_t home(const Table& table, uint64_t key) {
+        return home_slot(key, table.shift);
+    }
+
+    // probes, if given, receives the number of slots examined
+    static Slot* find_in(const Table& table, uint64_t key, size_t* probes = nullptr) {
+        if (probes) *probes = 0;
+        if (table.size == 0) return nullptr;
+        const size_t mask = table.capacity - 1;
+        const size_t start = home(table, key);
+        for (size_t i = start;; i = (i + 1) & mask) {
+            const uint8_t c = table.ctrl[i];
+            if (c == kEmpty || (c == kFull && table.slots[i].key == key)) {
+                if (probes) *probes = ((i - start) & mask) + 1;
+                return c == kEmpty ? nullptr : &table.slots[i];
+            }
+        }
+    }
+
+    Slot* find_slot(uint64_t key) const {
+        Slot* slot = find_in(cur_, key);
+        return slot ? slot : find_in(old_, key);
+    }
+
+    // Caller guarantees key is absent and the table has a free slot
+    static Slot* place(Table& table, uint64_t key, const V& value) {
+        const size_t mask = table.capacity - 1;
+        size_t i = home(table, key);
+        while (table.ctrl[i] == kFull) i = (i + 1) & mask;
+
+        if (table.ctrl[i] == kEmpty) table.used++;
+        table.ctrl[i] = kFull;
+        table.slots[i].key = key;
+        table.slots[i].value = value;
+        table.size++;
+        return &table.slots[i];
+    }
+
+    static bool take_from(Table& table, uint64_t key, V& out) {
+        Slot* slot = find_in(table, key);
+        if (!slot) return false;
+        out = slot->value;
+        // Tombstone keeps later entries of the probe chain reachable
+        table.ctrl[slot - table.slots] = kTombstone;
+        table.size--;
+        return true;
+    }
+
+    bool grow() {
+        // Only reachable mid-rehash if inserts outran migration; drain first
+        finish_migration();
+        // Doubles when the table is full of live entries; stays the same size
+        // (and just drops tombstones) when most of the load is tombstones
+        size_t capacity = std::max(cur_.capacity, kMinCapacity);
+        if (cur_.size + 1 > limit(capacity) / 2) capacity *= 2;
+        if (!rehash_into(capacity)) return false;
+        if (policy_ == RehashPolicy::Immediate) {
+            finish_migration();
+        }
+        return true;
+    }
+
+    bool rehash_into(size_t capacity) {
+        Table table = allocate(capacity);
+        if (!table.capacity) return false;
+        old_ = cur_;
+        cur_ = table;
+        migrate_pos_ = 0;
+        run_start_ = 0;
+        if (old_.size == 0) {
+            release(old_);
+            return true;
+        }
+        // Start on an empty slot (the load limit leaves some), so no run
+        // wraps around the point where migration begins and ends
+        migrate_start_ = 0;
+        while (old_.ctrl[migrate_start_] != kEmpty) migrate_start_++;
+        return true;
+    }
+
+    // Migrate old_ slots, in order from migrate_start_, until end have moved
+    void migrate(size_t end) {
+        const size_t mask = old_.capacity - 1;
+        for (; migrate_pos_ < end; ++migrate_pos_) {
+            const size_t i = (migrate_start_ + migrate_pos_) & mask;
+            const uint8_t c = old_.ctrl[i];
+            if (c == kFull) {
+                const Slot& slot = old_.slots[i];
+                place(cur_, slot.key, slot.value);
+                old_.ctrl[i] = kTombstone;
+                old_.size--;
+            } else if (c == kEmpty) {
+                // The run before this slot has fully moved and no old key
+                // probes through it any more: empty it, so old_ lookups
+                // homed there stop at once rather than walk its tombstones
+                for (size_t j = run_start_; j < migrate_pos_; ++j) {
+                    old_.ctrl[(migrate_start_ + j) & mask] = kEmpty;
+                }
+                run_start_ = migrate_pos_ + 1;
+            }
+        }
+        if (migrate_pos_ == old_.capacity || old_.size == 0) {
+            release(old_);
+            migrate_pos_ = 0;
+        }
+    }
+
+    void step_migration() {
+        if (old_.capacity) {
+            migrate(std::min(migrate_pos_ + kMigrateSlots, old_.capacity));
+        }
+    }
+
+    void finish_migration() {
+        if (old_.capacity) {
+            migrate(old_.capacity);
+        }
+    }
+
+    template <typename Fn>
+    static void visit(const Table& table, Fn& fn) {
+        for (size_t i = 0; i < table.capacity; ++i) {
+            if (table.ctrl[i] == kFull) {
+                fn(table.slots[i].key, table.slots[i].value);
+            }
+        }
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "order_manager.hpp"
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Full-book dumps from a forked child, in the style of Redis BGSAVE
+ *
+ * start() forks; the child inherits the book through copy-on-write pages,
+ * captures and writes it at leisure, and exits. The parent returns as soon
+ * as fork() does and keeps trading. Its remaining cost is the minor page
+ * faults it takes when it writes to a page still shared with the child;
+ * both the fork time and those faults are measured and reported.
+ *
+ * POSIX only: on other platforms start() reports IoError. Call poll() from
+ * the engine loop (or wait()) to reap the child and collect its result.
+ */
+class ForkSnapshotter {
+public:
+    struct Stats {
+        uint64_t dumps = 0;             // Children that wrote their file
+        uint64_t failures = 0;          // Fork failures, failed or unreapable children
+        int64_t last_fork_us = 0;       // Wall time of the last fork() in the parent
+        int64_t total_fork_us = 0;
+        int64_t max_fork_us = 0;
+        int64_t last_fork_faults = 0;   // Parent minor faults inside fork() itself
+        int64_t last_cow_faults = 0;    // Parent minor faults while the child ran
+        int64_t total_cow_faults = 0;
+    };
+
+    ForkSnapshotter() = default;
+
+    /**
+     * @brief Reaps a still-running child, so no zombie outlives the dumper
+     */
+    ~ForkSnapshotter();
+
+    ForkSnapshotter(const ForkSnapshotter&) = delete;
+    ForkSnapshotter& operator=(const ForkSnapshotter&) = delete;
+
+    /**
+     * @brief Fork a child that dumps book to filename
+     * @return Ok once the child is running, Busy if the previous dump has not
+     *         been reaped yet, IoError if fork() failed
+     */
+    template <typename Book>
+    OrderStatus start(const Book& book, const std::string& filename,
+                      SnapshotFormat format = SnapshotFormat::Text) {
+        return launch([&book, &filename, format] {
+            std::vector<Order> orders;
+            book.capture_snapshot(orders);
+            return save_snapshot(filename, orders, Book::kSortedSnapshot, format);
+        });
+    }
+
+    /**
+     * @brief Reap the child if it has exited (never blocks)
+     * @return true if no dump is running any more
+     */
+    bool poll();
+
+    /**
+     * @brief Block until the running dump, if any, has exited
+     */
+    void wait();
+
+    bool busy() const { return child_ > 0; }
+    const Stats& stats() const { return stats_; }
+    void print_stats(std::ostream& os = std::cout) const;
+
+private:
+    // Runs dump in the child and exits with its result
+    OrderStatus launch(const std::function<OrderStatus()>& dump);
+    // Records the outcome of the child that just finished (or was lost)
+    void reaped(bool succeeded);
+
+    long child_ = 0;  // pid_t of the running child, 0 if none
+    int64_t faults_at_fork_ = 0;
+    Stats stats_;
+};
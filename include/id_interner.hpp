@@ -0,0 +1,245 @@
+#pragma once
+
+#include "order_status.hpp"
+#include "try_allocate.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Dense internal order ID handed out for an external string ID
+ */
+using InternalId = uint32_t;
+constexpr InternalId kNoInternalId = UINT32_MAX;
+
+/**
+ * @brief External (client) order ID stored inline: up to 23 bytes
+ *
+ * Zero-padded to 23 bytes with the length in the last byte, so two keys
+ * compare as three 64-bit words and hashing needs no loop over characters.
+ */
+struct ExternalKey {
+    static constexpr size_t kMaxLength = 23;
+
+    char bytes[kMaxLength + 1] = {};
+
+    // false for an empty or over-long ID
+    static bool make(std::string_view text, ExternalKey& out) {
+        if (text.empty() || text.size() > kMaxLength) return false;
+        out = ExternalKey{};
+        std::memcpy(out.bytes, text.data(), text.size());
+        out.bytes[kMaxLength] = static_cast<char>(text.size());
+        return true;
+    }
+
+    std::string_view view() const {
+        return std::string_view(bytes, static_cast<uint8_t>(bytes[kMaxLength]));
+    }
+
+    uint64_t hash() const {
+        uint64_t words[3];
+        std::memcpy(words, bytes, sizeof(words));
+        uint64_t h = words[2] * 0x9e3779b97f4a7c15ull;
+        h = (h ^ words[0]) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 31) ^ words[1]) * 0x94d049bb133111ebull;
+        return h ^ (h >> 29);
+    }
+
+    bool operator==(const ExternalKey& other) const {
+        return std::memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+    }
+};
+static_assert(sizeof(ExternalKey) == 24, "external keys are three words");
+
+/**
+ * @brief External string order ID -> dense InternalId, and back
+ *
+ * Open addressing with linear probing over 32-byte slots (inline key,
+ * ID, cached hash), two to a cache line, and a separate control byte per
+ * slot holding 7 bits of the hash: a probe rejects most non-matching
+ * slots without touching them. No string is ever allocated.
+ *
+ * IDs are handed out densely from 0 and recycled newest-first once
+ * released, so they can index a DirectIndex and the book's hot slots stay
+ * warm. The table rehashes inside the insert that crosses the load limit
+ * (no incremental mode: the slots are small and the table is sized by
+ * live orders, not by history). Nothing throws: an allocation failure
+ * leaves the table as it was and intern reports BookFull.
+ */
+class IdInterner {
+private:
+    static constexpr uint8_t kEmpty = 0;
+    static constexpr uint8_t kTombstone = 1;
+    static constexpr uint8_t kFullBit = 0x80;  // | 7 hash bits
+    static constexpr size_t kMinCapacity = 16;
+
+    struct Slot {
+        ExternalKey key;
+        InternalId id;
+        uint32_t hash;  // Low half of the key's hash, kept so rehashing reads no keys
+    };
+    static_assert(sizeof(Slot) == 32, "two slots per cache line");
+
+    std::pmr::vector<uint8_t> ctrl_;
+    std::pmr::vector<Slot> slots_;
+    std::pmr::vector<ExternalKey> keys_;  // By InternalId, for the way back
+    std::pmr::vector<InternalId> free_;   // Released IDs, newest last; capacity >= keys_
+    size_t size_ = 0;
+    size_t used_ = 0;  // Live slots + tombstones
+    InternalId max_ids_;
+
+    // Control byte of a full slot: the top 7 bits of the low hash half (the
+    // probe start uses the bottom bits)
+    static uint8_t tag(uint32_t hash) { return static_cast<uint8_t>(kFullBit | (hash >> 25)); }
+
+    size_t limit() const { return ctrl_.size() - ctrl_.size() / 4; }
+
+    // Slot of key, or the capacity if absent
+    size_t find_slot(const ExternalKey& key, uint32_t hash) const {
+        if (size_ == 0) return ctrl_.size();
+        const size_t mask = ctrl_.size() - 1;
+        const uint8_t want = tag(hash);
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const uint8_t c = ctrl_[i];
+            if (c == kEmpty) return ctrl_.size();
+            if (c == want && slots_[i].key == key) return i;
+        }
+    }
+
+    void place(const Slot& slot) {
+        const size_t mask = ctrl_.size() - 1;
+        size_t i = slot.hash & mask;
+        while (ctrl_[i] & kFullBit) i = (i + 1) & mask;
+        if (ctrl_[i] == kEmpty) used_++;
+        ctrl_[i] = tag(slot.hash);
+        slots_[i] = slot;
+    }
+
+    // Rebuild at capacity, dropping tombstones; false (table unchanged) if
+    // the new arrays could not be allocated
+    bool rehash(size_t capacity) {
+        std::pmr::vector<uint8_t> ctrl(ctrl_.get_allocator());
+        std::pmr::vector<Slot> slots(slots_.get_allocator());
+        if (!try_allocate([&] {
+                ctrl.assign(capacity, kEmpty);
+                slots.resize(capacity);
+            })) {
+            return false;
+        }
+        ctrl.swap(ctrl_);
+        slots.swap(slots_);
+        used_ = 0;
+        for (size_t i = 0; i < ctrl.size(); ++i) {
+            if (ctrl[i] & kFullBit) place(slots[i]);
+        }
+        return true;
+    }
+
+    // Append key under a brand-new ID, keeping room in free_ for every ID
+    // so release never allocates
+    bool push_key(const ExternalKey& key) {
+        if (free_.capacity() <= keys_.size() &&
+            !try_allocate([&] { free_.reserve(std::max(keys_.size() + 1, 2 * free_.capacity())); })) {
+            return false;
+        }
+        return try_allocate([&] { keys_.push_back(key); });
+    }
+
+public:
+    explicit IdInterner(InternalId max_ids = kNoInternalId,
+                        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : ctrl_(resource), slots_(resource), keys_(resource), free_(resource), max_ids_(max_ids) {}
+    explicit IdInterner(std::pmr::memory_resource* resource)
+        : IdInterner(kNoInternalId, resource) {}
+
+    /**
+     * @brief Map text to a fresh dense ID
+     * @param id Receives the new ID, or the existing one on Duplicate
+     * @return Ok, Duplicate, ParseError for an empty or over-long ID, or
+     *         BookFull once max_ids IDs are live or the table cannot grow
+     */
+    OrderStatus intern(std::string_view text, InternalId& id) noexcept {
+        ExternalKey key;
+        if (!ExternalKey::make(text, key)) return OrderStatus::ParseError;
+        const uint32_t hash = static_cast<uint32_t>(key.hash());
+        const size_t found = find_slot(key, hash);
+        if (found != ctrl_.size()) {
+            id = slots_[found].id;
+            return OrderStatus::Duplicate;
+        }
+        if (free_.empty() && keys_.size() >= max_ids_) return OrderStatus::BookFull;
+
+        if (used_ + 1 > limit()) {
+            // Doubles when live keys fill the table, else just drops tombstones
+            size_t capacity = std::max(ctrl_.size(), kMinCapacity);
+            if (size_ + 1 > capacity / 2) capacity *= 2;
+            if (!rehash(capacity)) return OrderStatus::BookFull;
+        }
+        if (free_.empty()) {
+            if (!push_key(key)) return OrderStatus::BookFull;
+            id = static_cast<InternalId>(keys_.size() - 1);
+        } else {
+            id = free_.back();
+            free_.pop_back();
+            keys_[id] = key;
+        }
+        place(Slot{key, id, hash});
+        size_++;
+        return OrderStatus::Ok;
+    }
+
+    // ID of text, or kNoInternalId
+    InternalId find(std::string_view text) const noexcept {
+        ExternalKey key;
+        if (!ExternalKey::make(text, key)) return kNoInternalId;
+        const size_t found = find_slot(key, static_cast<uint32_t>(key.hash()));
+        return found != ctrl_.size() ? slots_[found].id : kNoInternalId;
+    }
+
+    /**
+     * @brief Forget a live ID; it is handed out again by a later intern
+     * @return false if id is not live
+     */
+    bool release(InternalId id) noexcept {
+        if (id >= keys_.size()) return false;
+        const ExternalKey& key = keys_[id];
+        const size_t found = find_slot(key, static_cast<uint32_t>(key.hash()));
+        if (found == ctrl_.size() || slots_[found].id != id) return false;
+        ctrl_[found] = kTombstone;
+        size_--;
+        free_.push_back(id);
+        return true;
+    }
+
+    // The external ID a live id was interned from
+    std::string_view external_id(InternalId id) const {
+        return id < keys_.size() ? keys_[id].view() : std::string_view();
+    }
+
+    // false if the table or the ID arrays could not be allocated
+    bool reserve(size_t n) {
+        size_t capacity = kMinCapacity;
+        while (capacity - capacity / 4 < n) capacity *= 2;
+        if (capacity > ctrl_.size() && !rehash(capacity)) return false;
+        return try_allocate([&] {
+            keys_.reserve(n);
+            free_.reserve(n);
+        });
+    }
+
+    void clear() {
+        std::fill(ctrl_.begin(), ctrl_.end(), kEmpty);
+        keys_.clear();
+        free_.clear();
+        size_ = 0;
+        used_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return ctrl_.size(); }
+    // One past the largest ID handed out: the range a DirectIndex must cover
+    size_t id_range() const { return keys_.size(); }
+};
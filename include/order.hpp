@@ -4,6 +4,44 @@
 #include <string>
 #include <iostream>
 
+/**
+ * @brief Order side as a compile-time tag
+ * 
+ * Order::side stays a plain uint32_t (0=buy, 1=sell) to keep the record
+ * layout; book internals dispatch on it once at entry and are then
+ * instantiated per side, so no inner loop re-tests the side.
+ */
+enum class Side : uint32_t {
+    Buy = 0,
+    Sell = 1
+};
+
+/**
+ * @brief Per-side price ordering, resolved at compile time
+ */
+template <Side S>
+struct SideTraits;
+
+template <>
+struct SideTraits<Side::Buy> {
+    static constexpr Side opposite = Side::Sell;
+    static constexpr const char* name = "BUY";
+    
+    // Higher bids are better
+    template <typename Price>
+    static constexpr bool better(Price a, Price b) { return a > b; }
+};
+
+template <>
+struct SideTraits<Side::Sell> {
+    static constexpr Side opposite = Side::Buy;
+    static constexpr const char* name = "SELL";
+    
+    // Lower asks are better
+    template <typename Price>
+    static constexpr bool better(Price a, Price b) { return a < b; }
+};
+
 /**
  * @brief Represents a limit order in the order book
  * 
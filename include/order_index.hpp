@@ -0,0 +1,159 @@
+#pragma once
+
+#include "flat_hash_map.hpp"
+#include "order_status.hpp"
+#include "order_storage.hpp"
+#include "try_allocate.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * @brief Index policy: order ID -> handle through an open-addressing hash map
+ *
+ * The general-purpose choice: any 64-bit ID scheme, memory proportional to
+ * the number of live orders, rehash behaviour tunable at runtime.
+ */
+class HashIndex {
+private:
+    FlatHashMap<OrderHandle> map_;
+
+public:
+    explicit HashIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : map_(resource) {}
+
+    OrderHandle find(uint64_t id) const {
+        const OrderHandle* handle = map_.find(id);
+        return handle ? *handle : kNullHandle;
+    }
+
+    /**
+     * @brief Claim the slot for id
+     * @param slot Set to the slot to write the handle into, valid until the
+     *        next insert or erase
+     * @return Ok, Duplicate, or BookFull if the table could not grow
+     */
+    OrderStatus insert(uint64_t id, OrderHandle*& slot) {
+        auto [stored, inserted] = map_.insert(id, kNullHandle);
+        if (!inserted) return stored ? OrderStatus::Duplicate : OrderStatus::BookFull;
+        slot = stored;
+        return OrderStatus::Ok;
+    }
+
+    /**
+     * @brief Remove id
+     * @return The handle it mapped to, or kNullHandle if absent
+     */
+    OrderHandle erase(uint64_t id) {
+        OrderHandle handle = kNullHandle;
+        map_.take(id, handle);
+        return handle;
+    }
+
+    void prefetch(uint64_t id) const { map_.prefetch(id); }
+
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        map_.for_each([&fn](uint64_t id, OrderHandle handle) { fn(id, handle); });
+    }
+
+    bool reserve(size_t n) { return map_.reserve(n); }
+    void clear() { map_.clear(); }
+    size_t size() const { return map_.size(); }
+
+    void set_max_load_factor(float load) { map_.set_max_load_factor(load); }
+    float max_load_factor() const { return map_.max_load_factor(); }
+    void set_rehash_policy(RehashPolicy policy) { map_.set_rehash_policy(policy); }
+    RehashPolicy rehash_policy() const { return map_.rehash_policy(); }
+
+    void print_stats(std::ostream& os) const {
+        os << "Index Capacity: " << map_.capacity() << " slots" << std::endl;
+        os << "Index Load Factor: " << map_.load_factor()
+           << " (max " << map_.max_load_factor() << ")" << std::endl;
+        os << "Rehash Policy: "
+           << (map_.rehash_policy() == RehashPolicy::Incremental ? "incremental" : "immediate")
+           << (map_.rehashing() ? " (in progress)" : "") << std::endl;
+    }
+};
+
+/**
+ * @brief Index policy: order ID used directly as an array subscript
+ *
+ * For venues that assign small dense IDs (e.g. per-session sequence
+ * numbers): lookup is a single load with no hashing or probing. IDs at or
+ * above max_id are rejected as BookFull rather than growing the array
+ * without bound.
+ * The table never rehashes, so the load-factor controls are no-ops.
+ */
+class DirectIndex {
+private:
+    std::pmr::vector<OrderHandle> slots_;
+    size_t size_ = 0;
+    uint64_t max_id_;
+
+public:
+    static constexpr uint64_t kDefaultMaxId = uint64_t{1} << 24;
+
+    explicit DirectIndex(uint64_t max_id = kDefaultMaxId,
+                         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : slots_(resource), max_id_(max_id) {}
+    explicit DirectIndex(std::pmr::memory_resource* resource)
+        : DirectIndex(kDefaultMaxId, resource) {}
+
+    OrderHandle find(uint64_t id) const {
+        return id < slots_.size() ? slots_[id] : kNullHandle;
+    }
+
+    OrderStatus insert(uint64_t id, OrderHandle*& slot) {
+        if (id >= max_id_) return OrderStatus::BookFull;
+        if (id >= slots_.size()) {
+            // Geometric growth, but never past the configured ID range
+            const size_t grown = std::min<uint64_t>(std::max<size_t>(id + 1, slots_.size() * 2), max_id_);
+            if (!try_allocate([&] { slots_.resize(grown, kNullHandle); })) return OrderStatus::BookFull;
+        }
+        if (slots_[id] != kNullHandle) return OrderStatus::Duplicate;
+        size_++;
+        slots_[id] = 0;  // Claimed: erase() works even before the handle is written
+        slot = &slots_[id];
+        return OrderStatus::Ok;
+    }
+
+    OrderHandle erase(uint64_t id) {
+        if (id >= slots_.size() || slots_[id] == kNullHandle) return kNullHandle;
+        OrderHandle handle = slots_[id];
+        slots_[id] = kNullHandle;
+        size_--;
+        return handle;
+    }
+
+    void prefetch(uint64_t id) const {
+        if (id < slots_.size()) LOB_PREFETCH_READ(&slots_[id]);
+    }
+
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (size_t id = 0; id < slots_.size(); ++id) {
+            if (slots_[id] != kNullHandle) fn(uint64_t{id}, slots_[id]);
+        }
+    }
+
+    bool reserve(size_t n) {
+        return try_allocate([&] { slots_.reserve(std::min<uint64_t>(n, max_id_)); });
+    }
+    void clear() {
+        std::fill(slots_.begin(), slots_.end(), kNullHandle);
+        size_ = 0;
+    }
+    size_t size() const { return size_; }
+
+    void set_max_load_factor(float) {}
+    float max_load_factor() const { return 1.0f; }
+    void set_rehash_policy(RehashPolicy) {}
+    RehashPolicy rehash_policy() const { return RehashPolicy::Immediate; }
+
+    void print_stats(std::ostream& os) const {
+        os << "Index: direct, " << slots_.size() << " of " << max_id_ << " IDs mapped" << std::endl;
+    }
+};
@@ -1,121 +1,680 @@
 #pragma once
 
 #include "order.hpp"
-#include <unordered_map>
+#include "account_index.hpp"
+#include "book_analytics.hpp"
+#include "book_stats.hpp"
+#include "order_index.hpp"
+#include "order_status.hpp"
+#include "order_storage.hpp"
+#include "price_levels.hpp"
+#include "prefetch.hpp"
+#include "pre_trade_risk.hpp"
+#include "state_hash.hpp"
+#include "timing_wheel.hpp"
+#include "try_allocate.hpp"
+#include <cstdio>
 #include <vector>
 #include <memory>
+#include <memory_resource>
 #include <iostream>
+#include <limits>
 #include <fstream>
 #include <sstream>
 #include <chrono>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief Per-order attributes that stay off the 24-byte Order record
+ */
+struct OrderOptions {
+    AccountId account = kNoAccount;
+    Timestamp expires_at = kNoExpiry;  // Good-till-date; the session close for day orders
+};
+
+/**
+ * @brief Enables a BasicOrderManager member on price-sorted level policies only
+ */
+template <typename Levels>
+using IfSortedLevels = std::enable_if_t<Levels::kSorted, int>;
 
 /**
  * @brief Manages a collection of active orders
- * 
+ *
+ * The backend is chosen at compile time through four policies, so every
+ * hot-path call is resolved statically and can be inlined:
+ * - Storage: where order records live (PooledStorage)
+ * - Index: order ID -> handle lookup (HashIndex, DirectIndex)
+ * - Levels: price structure (UnsortedLevels, TreeLevels, LadderLevels)
+ * - Stats: instrumentation hooks (CountingStats, NullStats)
+ *
  * Performance considerations:
- * - unordered_map for O(1) order lookup by ID
- * - vector for snapshot printing (cache-friendly iteration)
- * - Reserve capacity to avoid reallocations
- * - Use move semantics to avoid copies
+ * - Side is dispatched once per call; level code is instantiated per side
+ *   with its own comparator and best-price tracking
+ * - Orders are addressed by 32-bit handles into stable storage, so the
+ *   index and the level FIFOs stay small and survive index rehashes
+ * - Hot path (add/cancel) touches index, record and one level only
+ * - Cold path (snapshot) walks the level structure, or sorts on demand
+ *   when the policy keeps no price structure; price-ordered queries exist
+ *   only on the policies that keep one (kPriceQueries)
+ * - Every container allocates from a std::pmr::memory_resource, so short-lived
+ *   books can run on a monotonic arena or an OrderPoolResource instead of
+ *   the global heap
+ * - The hot path is noexcept and reports rejections as OrderStatus codes;
+ *   the library builds with -fno-exceptions (make no-exceptions)
  */
-class OrderManager {
+template <typename Storage, typename Index, typename Levels, typename Stats>
+class BasicOrderManager {
 private:
-    // Primary storage: O(1) lookup by order ID
+    // Order records, addressed by handle
+    Storage storage_;
+
+    // Primary lookup: O(1) by order ID
     // This is the "hot path" - accessed on every add/cancel
-    std::unordered_map<uint64_t, Order> orders_;
-    
-    // Secondary storage: cache-friendly for snapshot printing
-    // This is the "cold path" - only accessed when printing
-    mutable std::vector<const Order*> order_ptrs_;
-    mutable bool snapshot_dirty_ = true;
-    
+    Index index_;
+
+    // Price structure, also serves snapshot printing
+    Levels levels_;
+
     // Performance tracking
-    uint64_t total_orders_added_ = 0;
-    uint64_t total_orders_cancelled_ = 0;
-    
+    Stats stats_;
+
+    // Per-side quantity and order count, kept current on every update
+    DepthTotals totals_;
+
+    // Account -> orders, plus the scratch list of a mass cancel: handles
+    // keyed by side and price, so sorting never touches the records
+    AccountIndex accounts_;
+    std::pmr::vector<KeyedItem<OrderHandle>> batch_;
+
+    // Expiry timers of good-till-date orders, and the book's clock
+    TimingWheel timers_;
+
+    // Per-account limits and exposure, plus the price the bands centre on
+    PreTradeRisk risk_;
+    double reference_price_ = std::numeric_limits<double>::quiet_NaN();
+
+    // Order-independent hash of the resting orders, for replay checks
+    BookHash hash_;
+
 public:
-    OrderManager() = default;
-    ~OrderManager() = default;
-    
+    /**
+     * @brief Book with default-configured policies, all allocating from resource
+     * @param resource Must outlive the book. With a monotonic arena, destroying
+     *        the book frees nothing and the arena reclaims it all at once.
+     */
+    explicit BasicOrderManager(
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : storage_(resource), index_(resource), levels_(resource),
+          accounts_(resource), batch_(resource), timers_(resource), risk_(resource),
+          hash_(resource) {}
+
+    /**
+     * @brief Book with configured policies
+     * Policies carry their own resource; pass the same one to each of them
+     * and here to keep the whole book in one arena.
+     */
+    explicit BasicOrderManager(
+        Levels levels, Index index = Index(),
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : storage_(resource), index_(std::move(index)), levels_(std::move(levels)),
+          accounts_(resource), batch_(resource), timers_(resource), risk_(resource),
+          hash_(resource) {}
+    ~BasicOrderManager() = default;
+
     // Disable copying - we want explicit control over memory
-    OrderManager(const OrderManager&) = delete;
-    OrderManager& operator=(const OrderManager&) = delete;
-    
-    // Allow moving - useful for transferring ownership
-    OrderManager(OrderManager&&) = default;
-    OrderManager& operator=(OrderManager&&) = default;
-    
+    BasicOrderManager(const BasicOrderManager&) = delete;
+    BasicOrderManager& operator=(const BasicOrderManager&) = delete;
+
+    // Allow moving - useful for transferring ownership. Not assignable:
+    // storage stays bound to the resource it was allocated from.
+    BasicOrderManager(BasicOrderManager&&) = default;
+    BasicOrderManager& operator=(BasicOrderManager&&) = delete;
+
     /**
      * @brief Add a new order to the manager
-     * @param order The order to add (will be moved)
-     * @return true if added successfully, false if ID already exists
+     * @param order The order to add
+     * @param options Attributes kept off the order record (owning account,
+     *        expiry time)
+     * @return Ok, Duplicate, InvalidPrice (rejected by the level policy),
+     *         Expired (expires_at not after current_time()), a risk
+     *         rejection (see set_risk_limits) or BookFull (index, storage
+     *         or account table exhausted)
      */
-    bool add_order(Order order);
-    
+    OrderStatus try_add_order(const Order& order, const OrderOptions& options = OrderOptions()) noexcept;
+
     /**
      * @brief Cancel an order by ID
      * @param order_id The ID of the order to cancel
+     * @return Ok or UnknownId
+     */
+    OrderStatus try_cancel_order(uint64_t order_id) noexcept;
+
+    /**
+     * @brief Fill part or all of a resting order
+     *
+     * The fill primitive: reduces the order and its level in place, and
+     * removes the order once nothing is left. A quantity above what is
+     * left fills the remainder.
+     * @return Ok or UnknownId
+     */
+    OrderStatus try_execute_order(uint64_t order_id, uint32_t quantity) noexcept;
+
+    /**
+     * @brief Change the price and quantity of a resting order
+     *
+     * Reducing the quantity at the same price keeps the order's place in
+     * its queue. Any other change moves it to the back of the queue at
+     * its new price, as a cancel/replace would, but in place: the order
+     * keeps its ID, account and expiry. A quantity of 0 cancels.
+     * @return Ok, UnknownId, InvalidPrice or a risk rejection; a rejected
+     *         modify leaves the order as it was
+     */
+    OrderStatus try_modify_order(uint64_t order_id, double price, uint32_t quantity) noexcept;
+
+    /**
+     * @brief Add a new order to the manager
+     * @return true if added, false for any rejection (see try_add_order)
+     */
+    bool add_order(const Order& order, const OrderOptions& options = OrderOptions()) noexcept {
+        return try_add_order(order, options) == OrderStatus::Ok;
+    }
+
+    /**
+     * @brief Cancel an order by ID
      * @return true if cancelled successfully, false if not found
      */
-    bool cancel_order(uint64_t order_id);
-    
+    bool cancel_order(uint64_t order_id) noexcept {
+        return try_cancel_order(order_id) == OrderStatus::Ok;
+    }
+
+    /**
+     * @brief Fill part or all of a resting order
+     * @return true if the order was found
+     */
+    bool execute_order(uint64_t order_id, uint32_t quantity) noexcept {
+        return try_execute_order(order_id, quantity) == OrderStatus::Ok;
+    }
+
+    /**
+     * @brief Change the price and quantity of a resting order
+     * @return true if modified (see try_modify_order)
+     */
+    bool modify_order(uint64_t order_id, double price, uint32_t quantity) noexcept {
+        return try_modify_order(order_id, price, quantity) == OrderStatus::Ok;
+    }
+
+    /**
+     * @brief Add a burst of orders in one call
+     *
+     * The whole batch is hashed first and the target index slots are
+     * prefetched before any insert is applied, so the index misses of a
+     * burst overlap instead of being paid one after another.
+     * @param orders Pointer to the first order of the batch
+     * @param count Number of orders in the batch
+     * @param results Optional output array of count statuses, as
+     *        try_add_order would have returned them
+     * @return Number of orders added
+     */
+    size_t add_orders(const Order* orders, size_t count, OrderStatus* results = nullptr) noexcept;
+
+    /**
+     * @brief Cancel a burst of orders in one call
+     *
+     * Prefetches the index slots of the batch, then resolves every handle
+     * and prefetches the order records before unlinking any of them.
+     * @param order_ids Pointer to the first order ID of the batch
+     * @param count Number of IDs in the batch
+     * @param results Optional output array of count statuses, as
+     *        try_cancel_order would have returned them
+     * @return Number of orders cancelled
+     */
+    size_t cancel_orders(const uint64_t* order_ids, size_t count, OrderStatus* results = nullptr) noexcept;
+
+    /**
+     * @brief Cancel every order of an account (e.g. when its session drops)
+     *
+     * Walks the account's own list, so the cost follows its order count
+     * rather than the book size. Orders are grouped by price level and
+     * each level's aggregates are updated once for the group.
+     * @return Number of orders cancelled
+     */
+    size_t cancel_all(AccountId account) noexcept {
+        return cancel_account(account, [](const Order&) { return true; });
+    }
+
+    // Only the account's orders on side
+    size_t cancel_all(AccountId account, Side side) noexcept {
+        return cancel_account(account, [side](const Order& order) {
+            return order.side == static_cast<uint32_t>(side);
+        });
+    }
+
+    // Only the account's orders on side priced within [lo, hi]
+    size_t cancel_all(AccountId account, Side side, double lo, double hi) noexcept {
+        return cancel_account(account, [side, lo, hi](const Order& order) {
+            return order.side == static_cast<uint32_t>(side) && order.price >= lo && order.price <= hi;
+        });
+    }
+
+    /**
+     * @brief Account an order was added under, kNoAccount if none or not found
+     */
+    AccountId account_of(uint64_t order_id) const noexcept {
+        const OrderHandle handle = index_.find(order_id);
+        return handle != kNullHandle ? accounts_.account_of(handle) : kNoAccount;
+    }
+
+    size_t account_orders(AccountId account) const noexcept { return accounts_.order_count(account); }
+    // Accounts with at least one resting order
+    size_t active_accounts() const noexcept { return accounts_.account_count(); }
+
+    /**
+     * @brief Move the book's clock to now and remove every order due by then
+     *
+     * Expired orders leave the book like cancels, in expiry order, and are
+     * counted by the stats as expiries. The timing wheel reaches exactly
+     * the due orders, so the cost follows how many expire rather than the
+     * book size or the time skipped. The clock never moves back.
+     * @return Number of orders expired
+     */
+    size_t advance_time(Timestamp now) noexcept;
+
+    Timestamp current_time() const noexcept { return timers_.now(); }
+
+    // Expiry time of a resting order; kNoExpiry if none or not found
+    Timestamp expiry_of(uint64_t order_id) const noexcept {
+        const OrderHandle handle = index_.find(order_id);
+        return handle != kNullHandle ? timers_.deadline(handle) : kNoExpiry;
+    }
+
+    // Resting orders with an expiry time
+    size_t pending_expiries() const noexcept { return timers_.size(); }
+
+    /**
+     * @brief Enable pre-trade risk checks on every add
+     *
+     * Once limits are set, each add is checked for size (OrderTooLarge),
+     * price band around the reference price (PriceOutOfBand), and, for
+     * orders with an account, the position the account would reach if its
+     * open orders on that side filled (PositionLimit) and its open notional
+     * (NotionalLimit). Accounts without their own limits take a copy of
+     * the defaults when first seen. Books without limits pay one branch.
+     * @return false if the account table could not grow
+     */
+    bool set_risk_limits(AccountId account, const RiskLimits& limits) {
+        return risk_.set_limits(account, limits);
+    }
+
+    // Limits of accounts first seen from now on, and of orders without one
+    void set_default_risk_limits(const RiskLimits& limits) { risk_.set_default_limits(limits); }
+
+    // Limits, position and open exposure of an account; nullptr if never seen
+    const AccountRisk* account_risk(AccountId account) const noexcept { return risk_.find(account); }
+    // Whether adds are risk-checked: any limits have been set
+    bool risk_enabled() const noexcept { return risk_.enabled(); }
+
+    /**
+     * @brief Centre of the price bands (e.g. the previous close)
+     * Executions move it to the last traded price. Without one, the sorted
+     * policies centre on the mid, and the unsorted policy skips the band.
+     */
+    void set_reference_price(double price) noexcept { reference_price_ = price; }
+    double reference_price() const noexcept { return reference_price_; }
+
     /**
      * @brief Get an order by ID (const access)
      * @param order_id The ID to look up
-     * @return Pointer to order if found, nullptr otherwise
+     * @return Pointer to order if found, nullptr otherwise. The pointer is
+     *         valid until the order is cancelled.
+     */
+    const Order* get_order(uint64_t order_id) const noexcept;
+
+    /**
+     * @brief Pre-size the index and storage for an expected book size
+     * Does the large allocations up front instead of on the hot path
+     * @param expected_orders Number of orders the book should hold without growing
+     * @return Ok, or BookFull if the index could not be allocated
      */
-    const Order* get_order(uint64_t order_id) const;
-    
+    OrderStatus reserve(size_t expected_orders) {
+        if (!index_.reserve(expected_orders) || !storage_.reserve(expected_orders)) {
+            return OrderStatus::BookFull;
+        }
+        return OrderStatus::Ok;
+    }
+
+    /**
+     * @brief Set the index load factor that triggers growth (clamped to [0.25, 0.95])
+     */
+    void set_max_load_factor(float load) { index_.set_max_load_factor(load); }
+    float max_load_factor() const { return index_.max_load_factor(); }
+
+    /**
+     * @brief Choose between one-shot and incremental (amortized) rehashing
+     * Incremental (the default) bounds worst-case add_order latency
+     */
+    void set_rehash_policy(RehashPolicy policy) { index_.set_rehash_policy(policy); }
+    RehashPolicy rehash_policy() const { return index_.rehash_policy(); }
+
+    /**
+     * @brief Visit every order, bids best to worst then asks best to worst
+     * @param fn Callable taking const Order&
+     */
+    template <typename Fn>
+    void for_each_order(Fn&& fn) const {
+        levels_.for_each_sorted(storage_, index_, fn);
+    }
+
+    /**
+     * @brief Whether the price-ordered queries below are available
+     *
+     * top_orders, orders_in_range and the book features walk price levels
+     * from the touch. The unsorted policy keeps no price order, so each
+     * query would have to sort the whole book after every change; on it
+     * they do not exist, and such reads belong on a snapshot.
+     */
+    static constexpr bool kPriceQueries = Levels::kSorted;
+
+    /**
+     * @brief Copy the n best orders of one side, in priority order
+     *
+     * Walks from the touch and stops after n orders, so the cost follows n
+     * rather than the book size. Does not allocate.
+     * @param out Caller buffer with room for n orders
+     * @return Number of orders written, at most n
+     */
+    template <typename L = Levels, IfSortedLevels<L> = 0>
+    size_t top_orders(Side side, size_t n, Order* out) const {
+        size_t written = 0;
+        auto copy = [&](const Order& order) {
+            if (written == n) return false;
+            out[written++] = order;
+            return true;
+        };
+        if (n == 0) return 0;
+        if (side == Side::Buy) levels_.template visit_from_best<Side::Buy>(storage_, index_, copy);
+        else levels_.template visit_from_best<Side::Sell>(storage_, index_, copy);
+        return written;
+    }
+
+    /**
+     * @brief Visit the orders of one side priced within [lo, hi]
+     *
+     * Orders arrive best price first, FIFO within a level. The walk seeks
+     * to the better bound and stops past the worse one, so empty or
+     * out-of-range levels are never touched.
+     * @param fn Callable taking const Order&
+     */
+    template <typename Fn, typename L = Levels, IfSortedLevels<L> = 0>
+    void orders_in_range(Side side, double lo, double hi, Fn&& fn) const {
+        if (side == Side::Buy) levels_.template visit_range<Side::Buy>(storage_, index_, lo, hi, fn);
+        else levels_.template visit_range<Side::Sell>(storage_, index_, lo, hi, fn);
+    }
+
+    /**
+     * @brief Book features, maintained incrementally
+     *
+     * Level aggregates and the per-side totals are updated by every add,
+     * cancel and fill, so the touch and whole-side figures are O(1) reads,
+     * and the depth queries walk only the levels they report. None of them
+     * depends on the book size. Sorted policies only (kPriceQueries).
+     */
+    template <typename L = Levels, IfSortedLevels<L> = 0>
+    LevelQuote best_quote(Side side) const;
+
+    // (best bid + best ask) / 2; NaN unless both sides are quoted
+    template <typename L = Levels, IfSortedLevels<L> = 0>
+    double mid_price() const;
+
+    // Touch prices weighted by the opposite side's quantity (see ::microprice)
+    template <typename L = Levels, IfSortedLevels<L> = 0>
+    double microprice() const;
+
+    // Quantity resting in the best `levels` price levels of side
+    template <typename L = Levels, IfSortedLevels<L> = 0>
+    uint64_t depth_quantity(Side side, size_t levels) const;
+
+    // Bid/ask imbalance over the best `levels` levels of each side, in [-1, 1]
+    template <typename L = Levels, IfSortedLevels<L> = 0>
+    double imbalance(size_t levels = 1) const;
+
+    /**
+     * @brief Cost of sweeping quantity from the touch of side
+     *
+     * O(log L) on the ladder, which keeps Fenwick trees of cumulative
+     * quantity and notional (Levels::kDepthIndex); other policies walk
+     * levels best to worst and stop once quantity is covered.
+     */
+    template <typename L = Levels, IfSortedLevels<L> = 0>
+    SweepEstimate estimate_sweep(Side side, uint64_t quantity) const;
+
+    /**
+     * @brief Average price of sweeping quantity from the touch of side
+     * @param filled Optional: the quantity available, at most quantity
+     * @return VWAP of the available quantity, NaN if the side is empty
+     */
+    template <typename L = Levels, IfSortedLevels<L> = 0>
+    double vwap_for_quantity(Side side, uint64_t quantity, uint64_t* filled = nullptr) const {
+        const SweepEstimate estimate = estimate_sweep(side, quantity);
+        if (filled) *filled = estimate.filled;
+        return estimate.vwap();
+    }
+
+    // Worst price reached by sweeping quantity; NaN if the side holds less
+    template <typename L = Levels, IfSortedLevels<L> = 0>
+    double price_at_depth(Side side, uint64_t quantity) const {
+        const SweepEstimate estimate = estimate_sweep(side, quantity);
+        return estimate.filled == quantity ? estimate.worst_price
+                                           : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // Quantity resting at price or better on side; O(log L) on the ladder
+    template <typename L = Levels, IfSortedLevels<L> = 0>
+    uint64_t depth_through(Side side, double price) const;
+
+    /**
+     * @brief Quantity resting ahead of an order at its price level
+     *
+     * O(log n) in the level size. The first query on a level numbers its
+     * orders once (O(level)); from then on every add, cancel and fill at
+     * that level keeps the index current until the level empties.
+     * @return Ok, UnknownId, Unsupported on the unsorted policy, which
+     *         keeps no time priority, or BookFull if the level's tracker
+     *         could not be allocated
+     */
+    OrderStatus queue_position(uint64_t order_id, uint64_t& quantity_ahead) noexcept;
+
+    /**
+     * @brief Hash of the resting orders, kept current by every mutation
+     *
+     * A wrapping sum of per-order mixes (see BookHash), so it depends only
+     * on which orders rest with what quantity: two replays, or a primary
+     * and its replica, agree exactly when their books do, whatever the
+     * backend. Each add, cancel, fill, expiry and clear is one step of
+     * sequence().
+     */
+    uint64_t state_hash() const noexcept { return hash_.value(); }
+    uint64_t sequence() const noexcept { return hash_.sequence(); }
+
+    // Keep state_hash() after each of the last capacity mutations
+    void set_hash_trail(size_t capacity) { hash_.set_trail(capacity); }
+
+    // state_hash() as of sequence; false if in the future or off the trail
+    bool state_hash_at(uint64_t sequence, uint64_t& hash) const noexcept {
+        return hash_.value_at(sequence, hash);
+    }
+
+    // Whole-side totals, O(1) on every policy
+    uint64_t side_quantity(Side side) const { return totals_.quantity(side); }
+    uint64_t side_orders(Side side) const { return totals_.orders(side); }
+
     /**
      * @brief Print a snapshot of all active orders
      * @param os Output stream (default: std::cout)
      */
     void print_snapshot(std::ostream& os = std::cout) const;
-    
+
+    /**
+     * @brief Copy every live order out of the book, for formatting elsewhere
+     *
+     * The cheap, consistent half of a snapshot: one pass over the book and
+     * no formatting. The copy is in snapshot order when kSortedSnapshot is
+     * true, and needs sort_snapshot() otherwise.
+     * @param out Replaced with the orders; its capacity is reused
+     */
+    void capture_snapshot(std::vector<Order>& out) const;
+    static constexpr bool kSortedSnapshot = Levels::kSorted;
+
     /**
      * @brief Print a snapshot to a file
      * @param filename The file to write to
+     * @return Ok, or IoError if the file could not be opened or written
      */
-    void print_snapshot_to_file(const std::string& filename) const;
-    
+    OrderStatus print_snapshot_to_file(const std::string& filename) const;
+
     /**
      * @brief Load orders from a CSV file
      * @param filename The CSV file to read from
+     * @param status Optional: set to IoError if the file could not be opened
      * @return Number of orders successfully loaded
      */
-    size_t load_from_csv(const std::string& filename);
-    
+    size_t load_from_csv(const std::string& filename, OrderStatus* status = nullptr);
+
     /**
      * @brief Get statistics about the order manager
      */
     void print_stats(std::ostream& os = std::cout) const;
-    
+
     /**
      * @brief Get the number of active orders
      */
-    size_t size() const { return orders_.size(); }
-    
+    size_t size() const noexcept { return index_.size(); }
+
     /**
      * @brief Check if the manager is empty
      */
-    bool empty() const { return orders_.empty(); }
-    
+    bool empty() const noexcept { return size() == 0; }
+
     /**
      * @brief Clear all orders
      */
     void clear();
-    
-private:
+
     /**
-     * @brief Rebuild the snapshot cache if dirty
-     * This is called automatically when needed
+     * @brief Direct access to the policies, for policy-specific queries
      */
-    void rebuild_snapshot_cache() const;
-    
+    const Levels& levels() const { return levels_; }
+    const Stats& stats() const { return stats_; }
+
+private:
     /**
-     * @brief Parse a CSV line into an Order
-     * @param line The CSV line to parse
-     * @return Parsed order or nullptr if invalid
+     * @brief Per-side halves of add/cancel, entered after the one side dispatch
      */
-    std::unique_ptr<Order> parse_csv_line(const std::string& line) const;
-}; 
\ No newline at end of file
+    template <Side S>
+    OrderStatus add_side(const Order& order, const OrderOptions& options) noexcept;
+
+    template <Side S>
+    void remove_side(OrderHandle handle) noexcept;
+
+    template <Side S>
+    void reduce_side(OrderHandle handle, uint32_t quantity) noexcept;
+
+    template <Side S>
+    OrderStatus replace_side(OrderHandle handle, double price, uint32_t quantity) noexcept;
+
+    // Remove the orders of batch_[begin, end), one side at one price
+    template <Side S>
+    void remove_level_batch(size_t begin, size_t end) noexcept;
+
+    template <typename Match>
+    size_t cancel_account(AccountId account, Match match) noexcept;
+
+    template <Side S>
+    SweepEstimate estimate_sweep_side(uint64_t quantity) const;
+
+    template <Side S>
+    uint64_t depth_through_side(double price) const;
+
+    // Price levels of side, best to worst, until fn(LevelQuote) returns false
+    template <typename Fn>
+    void visit_levels(Side side, Fn&& fn) const {
+        if (side == Side::Buy) levels_.template visit_levels<Side::Buy>(storage_, index_, fn);
+        else levels_.template visit_levels<Side::Sell>(storage_, index_, fn);
+    }
+};
+
+/**
+ * @brief Parse a CSV line ("id,price,quantity,side") into an Order
+ * @param line The CSV line to parse; fields may carry surrounding blanks
+ * @param out Receives the order when the line is valid
+ * @return Ok, or ParseError for a malformed line or a side other than 0/1
+ */
+OrderStatus parse_order_csv_line(std::string_view line, Order& out) noexcept;
+
+/**
+ * @brief Snapshot text format shared by print_snapshot and the SnapshotWriter
+ * The header and footer print the "No active orders." case when count is 0.
+ */
+void write_snapshot_header(std::ostream& os, size_t count);
+void write_snapshot_row(std::ostream& os, const Order& order);
+void write_snapshot_footer(std::ostream& os, size_t count);
+
+/**
+ * @brief Put captured orders in snapshot order: bids best to worst, then asks
+ */
+void sort_snapshot(std::vector<Order>& orders);
+
+/**
+ * @brief On-disk snapshot encodings
+ *
+ * Binary is a 24-byte header ("LOBSNAP1", uint32 version, uint32 record
+ * size, uint64 count) followed by the raw 24-byte Order records in native
+ * byte order. Records are in capture order; they are not sorted.
+ */
+enum class SnapshotFormat : uint8_t { Text, Binary };
+
+/**
+ * @brief Write captured orders to filename
+ * @param sorted Whether orders are already in snapshot order (text only)
+ * @return Ok, or IoError if the file could not be opened or written
+ */
+OrderStatus save_snapshot(const std::string& filename, std::vector<Order>& orders,
+                          bool sorted, SnapshotFormat format);
+
+/**
+ * @brief Read the orders of a binary snapshot
+ * @return Ok, IoError, or ParseError for a bad header or truncated file
+ */
+OrderStatus load_binary_snapshot(const std::string& filename, std::vector<Order>& out);
+
+/**
+ * @brief Append one binary snapshot (header, then records) to out
+ * @return Ok or IoError
+ */
+OrderStatus write_binary_snapshot(std::FILE* out, const std::vector<Order>& orders);
+
+/**
+ * @brief Find the records of a binary snapshot held in memory, without copying
+ * @param data Start of the header; must be 8-byte aligned
+ * @param orders Receives a pointer to the first record, inside data
+ * @return Ok, or ParseError for a bad header or records running past size
+ */
+OrderStatus parse_binary_snapshot(const char* data, size_t size, const Order*& orders, size_t& count);
+
+/**
+ * @brief Today's engine: hash index, no price structure, sort on snapshot
+ */
+using OrderManager = BasicOrderManager<PooledStorage, HashIndex, UnsortedLevels, CountingStats>;
+
+/**
+ * @brief Liquid futures: dense IDs and a narrow, dense price band
+ */
+using LadderOrderManager = BasicOrderManager<PooledStorage, DirectIndex, LadderLevels, CountingStats>;
+
+/**
+ * @brief Sparse equities: arbitrary IDs and widely spread prices
+ */
+using TreeOrderManager = BasicOrderManager<PooledStorage, HashIndex, TreeLevels, CountingStats>;
+
+#include "order_manager_impl.hpp"
@@ -0,0 +1,599 @@
+#pragma once
+
+// Member definitions for BasicOrderManager; included from order_manager.hpp
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace order_manager_detail {
+// Batch items are prefetched this many at a time: enough misses in flight to
+// cover memory latency, few enough that the lines are still cached when used
+constexpr size_t kBatchWindow = 64;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+OrderStatus BasicOrderManager<Storage, Index, Levels, Stats>::try_add_order(
+        const Order& order, const OrderOptions& options) noexcept {
+    // The only branch on the runtime side; everything below is per-side code
+    return order.is_buy() ? add_side<Side::Buy>(order, options)
+                          : add_side<Side::Sell>(order, options);
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+OrderStatus BasicOrderManager<Storage, Index, Levels, Stats>::try_cancel_order(
+        uint64_t order_id) noexcept {
+    const OrderHandle handle = index_.erase(order_id);
+    if (handle == kNullHandle) {
+        return OrderStatus::UnknownId;
+    }
+
+    if (storage_[handle].is_buy()) {
+        remove_side<Side::Buy>(handle);
+    } else {
+        remove_side<Side::Sell>(handle);
+    }
+    stats_.on_cancel();
+    return OrderStatus::Ok;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+OrderStatus BasicOrderManager<Storage, Index, Levels, Stats>::try_execute_order(
+        uint64_t order_id, uint32_t quantity) noexcept {
+    const OrderHandle handle = index_.find(order_id);
+    if (handle == kNullHandle) {
+        return OrderStatus::UnknownId;
+    }
+
+    const bool buy = storage_[handle].is_buy();
+    reference_price_ = storage_[handle].price;
+    if (risk_.enabled()) {
+        const AccountId account = accounts_.account_of(handle);
+        const uint32_t filled = std::min(quantity, storage_[handle].quantity);
+        if (buy) risk_.on_fill<Side::Buy>(account, filled); else risk_.on_fill<Side::Sell>(account, filled);
+    }
+    if (quantity >= storage_[handle].quantity) {
+        // Filled in full: leaves the book like a cancel
+        index_.erase(order_id);
+        if (buy) remove_side<Side::Buy>(handle); else remove_side<Side::Sell>(handle);
+    } else {
+        if (buy) reduce_side<Side::Buy>(handle, quantity); else reduce_side<Side::Sell>(handle, quantity);
+    }
+    stats_.on_execute();
+    return OrderStatus::Ok;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+OrderStatus BasicOrderManager<Storage, Index, Levels, Stats>::try_modify_order(
+        uint64_t order_id, double price, uint32_t quantity) noexcept {
+    if (quantity == 0) {
+        return try_cancel_order(order_id);
+    }
+    const OrderHandle handle = index_.find(order_id);
+    if (handle == kNullHandle) {
+        return OrderStatus::UnknownId;
+    }
+
+    const Order& order = storage_[handle];
+    const bool buy = order.is_buy();
+    if (price == order.price && quantity <= order.quantity) {
+        // Shrinking in place keeps time priority
+        const uint32_t reduction = order.quantity - quantity;
+        if (reduction > 0) {
+            if (buy) reduce_side<Side::Buy>(handle, reduction); else reduce_side<Side::Sell>(handle, reduction);
+        }
+        stats_.on_modify();
+        return OrderStatus::Ok;
+    }
+    return buy ? replace_side<Side::Buy>(handle, price, quantity)
+               : replace_side<Side::Sell>(handle, price, quantity);
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <Side S>
+OrderStatus BasicOrderManager<Storage, Index, Levels, Stats>::add_side(
+        const Order& order, const OrderOptions& options) noexcept {
+    if (!levels_.accepts(order)) {
+        return OrderStatus::InvalidPrice;
+    }
+    if (options.expires_at != kNoExpiry && options.expires_at <= timers_.now()) {
+        return OrderStatus::Expired;
+    }
+    if (risk_.enabled()) {
+        // A duplicate is reported as such, not as whatever its terms breach
+        if (index_.find(order.id) != kNullHandle) {
+            return OrderStatus::Duplicate;
+        }
+        double reference = reference_price_;
+        if constexpr (Levels::kSorted) {
+            if (std::isnan(reference)) reference = mid_price();
+        }
+        const OrderStatus verdict = risk_.check<S>(options.account, order, reference);
+        if (verdict != OrderStatus::Ok) {
+            return verdict;
+        }
+    }
+
+    // Claim the index slot first: fails if order ID already exists
+    OrderHandle* slot = nullptr;
+    const OrderStatus status = index_.insert(order.id, slot);
+    if (status != OrderStatus::Ok) {
+        return status;
+    }
+
+    const OrderHandle handle = storage_.allocate(order);
+    if (handle == kNullHandle) {
+        index_.erase(order.id);
+        return OrderStatus::BookFull;
+    }
+    *slot = handle;
+    // Every step that may allocate runs before anything the book reports
+    // changes; if one fails, the steps already taken are undone. The risk
+    // record comes last, so it exists only once its first order rests.
+    bool placed = options.account == kNoAccount || accounts_.link(handle, options.account);
+    if (placed && options.expires_at != kNoExpiry) {
+        placed = timers_.schedule(handle, options.expires_at);
+    }
+    if (placed) {
+        placed = levels_.template insert<S>(storage_, handle);
+        if (placed && risk_.enabled() && !risk_.on_add<S>(options.account, order)) {
+            levels_.template erase<S>(storage_, handle);
+            placed = false;
+        }
+    }
+    if (!placed) {
+        timers_.cancel(handle);
+        accounts_.unlink(handle);
+        storage_.release(handle);
+        index_.erase(order.id);
+        return OrderStatus::BookFull;
+    }
+    totals_.template on_add<S>(order.quantity);
+    hash_.on_add(order);
+    stats_.on_add();
+    return OrderStatus::Ok;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <Side S>
+void BasicOrderManager<Storage, Index, Levels, Stats>::remove_side(OrderHandle handle) noexcept {
+    totals_.template on_remove<S>(storage_[handle].quantity);
+    hash_.on_remove(storage_[handle]);
+    if (risk_.enabled()) {
+        risk_.on_release<S>(accounts_.account_of(handle), storage_[handle].price,
+                            storage_[handle].quantity);
+    }
+    accounts_.unlink(handle);
+    timers_.cancel(handle);
+    levels_.template erase<S>(storage_, handle);
+    storage_.release(handle);
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <Side S>
+void BasicOrderManager<Storage, Index, Levels, Stats>::remove_level_batch(
+        size_t begin, size_t end) noexcept {
+    const KeyedItem<OrderHandle>* items = &batch_[begin];
+    const size_t n = end - begin;
+    for (size_t i = 0; i < n; ++i) {
+        const Order& order = storage_[items[i].value];
+        index_.erase(order.id);
+        totals_.template on_remove<S>(order.quantity);
+        hash_.on_remove(order);
+        if (risk_.enabled()) {
+            risk_.on_release<S>(accounts_.account_of(items[i].value), order.price, order.quantity);
+        }
+        accounts_.unlink(items[i].value);
+        timers_.cancel(items[i].value);
+        stats_.on_cancel();
+    }
+    levels_.template erase_batch<S>(storage_, HandleColumn<OrderHandle>{items}, n);
+    for (size_t i = 0; i < n; ++i) {
+        storage_.release(items[i].value);
+    }
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <typename Match>
+size_t BasicOrderManager<Storage, Index, Levels, Stats>::cancel_account(
+        AccountId account, Match match) noexcept {
+    const size_t count = accounts_.order_count(account);
+    if (count > batch_.size() && !try_allocate([&] { batch_.resize(count); })) {
+        // No room to sort by level: remove the orders one at a time instead
+        size_t removed = 0;
+        accounts_.for_each(account, [&](OrderHandle handle) {
+            const Order& order = storage_[handle];
+            if (!match(order)) return;
+            const bool buy = order.is_buy();
+            index_.erase(order.id);
+            if (buy) remove_side<Side::Buy>(handle); else remove_side<Side::Sell>(handle);
+            stats_.on_cancel();
+            removed++;
+        });
+        return removed;
+    }
+
+    // Bids fill the buffer from the front and asks from the back, keyed by
+    // price so the sort below compares keys only
+    batch_.resize(count);
+    size_t bids = 0;
+    size_t asks = batch_.size();
+    accounts_.for_each(account, [&](OrderHandle handle) {
+        const Order& order = storage_[handle];
+        if (!match(order)) return;
+        const KeyedItem<OrderHandle> item{snapshot_key<Side::Sell>(order.price), handle};
+        if (order.is_buy()) batch_[bids++] = item; else batch_[--asks] = item;
+    });
+    batch_.erase(batch_.begin() + bids, batch_.begin() + asks);
+
+    // Orders of one level end up adjacent, so each level is touched once
+    auto by_key = [](const KeyedItem<OrderHandle>& a, const KeyedItem<OrderHandle>& b) {
+        return a.key < b.key;
+    };
+    std::sort(batch_.begin(), batch_.begin() + bids, by_key);
+    std::sort(batch_.begin() + bids, batch_.end(), by_key);
+
+    const size_t total = batch_.size();
+    for (size_t begin = 0; begin < total;) {
+        size_t end = begin + 1;
+        const size_t side_end = begin < bids ? bids : total;
+        while (end < side_end && batch_[end].key == batch_[begin].key) ++end;
+        if (begin < bids) {
+            remove_level_batch<Side::Buy>(begin, end);
+        } else {
+            remove_level_batch<Side::Sell>(begin, end);
+        }
+        begin = end;
+    }
+    return total;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <Side S>
+void BasicOrderManager<Storage, Index, Levels, Stats>::reduce_side(
+        OrderHandle handle, uint32_t quantity) noexcept {
+    levels_.template reduce<S>(storage_, handle, quantity);
+    storage_[handle].quantity -= quantity;
+    totals_.template on_fill<S>(quantity);
+    hash_.on_reduce(storage_[handle], storage_[handle].quantity + quantity);
+    if (risk_.enabled()) {
+        risk_.on_release<S>(accounts_.account_of(handle), storage_[handle].price, quantity);
+    }
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <Side S>
+OrderStatus BasicOrderManager<Storage, Index, Levels, Stats>::replace_side(
+        OrderHandle handle, double price, uint32_t quantity) noexcept {
+    const Order before = storage_[handle];
+    Order replacement = before;
+    replacement.price = price;
+    replacement.quantity = quantity;
+    if (!levels_.accepts(replacement)) {
+        return OrderStatus::InvalidPrice;
+    }
+    // The one step of the move that may allocate, done before anything changes
+    if (!levels_.template prepare<S>(price)) {
+        return OrderStatus::BookFull;
+    }
+
+    // Check the new terms with the old ones released; restore on rejection
+    if (risk_.enabled()) {
+        const AccountId account = accounts_.account_of(handle);
+        // Only an account with a record had the old terms counted
+        const bool counted = account != kNoAccount && risk_.find(account) != nullptr;
+        risk_.on_release<S>(account, before.price, before.quantity);
+        double reference = reference_price_;
+        if constexpr (Levels::kSorted) {
+            if (std::isnan(reference)) reference = mid_price();
+        }
+        const OrderStatus verdict = risk_.check<S>(account, replacement, reference);
+        if (verdict != OrderStatus::Ok) {
+            if (counted) risk_.on_add<S>(account, before);
+            return verdict;
+        }
+        if (!risk_.on_add<S>(account, replacement)) {
+            return OrderStatus::BookFull;  // No record was made, so nothing was released
+        }
+    }
+
+    // Same handle, index entry, account and timer: only the level moves
+    levels_.template erase<S>(storage_, handle);
+    totals_.template on_remove<S>(before.quantity);
+    storage_[handle] = replacement;
+    levels_.template insert<S>(storage_, handle);  // Prepared above
+    totals_.template on_add<S>(quantity);
+    hash_.on_replace(before, replacement);
+    stats_.on_modify();
+    return OrderStatus::Ok;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+size_t BasicOrderManager<Storage, Index, Levels, Stats>::add_orders(
+        const Order* orders, size_t count, OrderStatus* results) noexcept {
+    using order_manager_detail::kBatchWindow;
+
+    size_t added = 0;
+    for (size_t base = 0; base < count; base += kBatchWindow) {
+        const size_t n = std::min(kBatchWindow, count - base);
+        const Order* window = orders + base;
+        for (size_t i = 0; i < n; ++i) {
+            index_.prefetch(window[i].id);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            const OrderStatus status = try_add_order(window[i]);
+            if (results) results[base + i] = status;
+            added += status == OrderStatus::Ok;
+        }
+    }
+    return added;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+size_t BasicOrderManager<Storage, Index, Levels, Stats>::cancel_orders(
+        const uint64_t* order_ids, size_t count, OrderStatus* results) noexcept {
+    using order_manager_detail::kBatchWindow;
+
+    size_t cancelled = 0;
+    OrderHandle handles[kBatchWindow];
+    for (size_t base = 0; base < count; base += kBatchWindow) {
+        const size_t n = std::min(kBatchWindow, count - base);
+        const uint64_t* window = order_ids + base;
+
+        // Stage 1: index slots
+        for (size_t i = 0; i < n; ++i) {
+            index_.prefetch(window[i]);
+        }
+        // Stage 2: resolve handles (now cache hits), prefetch the records
+        for (size_t i = 0; i < n; ++i) {
+            handles[i] = index_.find(window[i]);
+            if (handles[i] != kNullHandle) {
+                LOB_PREFETCH_WRITE(&storage_[handles[i]]);
+            }
+        }
+        // Stage 3: apply; duplicates within the window fail on the index
+        for (size_t i = 0; i < n; ++i) {
+            const OrderStatus status =
+                handles[i] != kNullHandle ? try_cancel_order(window[i]) : OrderStatus::UnknownId;
+            if (results) results[base + i] = status;
+            cancelled += status == OrderStatus::Ok;
+        }
+    }
+    return cancelled;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+size_t BasicOrderManager<Storage, Index, Levels, Stats>::advance_time(Timestamp now) noexcept {
+    return timers_.advance(now, [this](OrderHandle handle) {
+        index_.erase(storage_[handle].id);
+        if (storage_[handle].is_buy()) {
+            remove_side<Side::Buy>(handle);
+        } else {
+            remove_side<Side::Sell>(handle);
+        }
+        stats_.on_expire();
+    });
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+const Order* BasicOrderManager<Storage, Index, Levels, Stats>::get_order(
+        uint64_t order_id) const noexcept {
+    const OrderHandle handle = index_.find(order_id);
+    return handle != kNullHandle ? &storage_[handle] : nullptr;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <typename L, IfSortedLevels<L>>
+LevelQuote BasicOrderManager<Storage, Index, Levels, Stats>::best_quote(Side side) const {
+    LevelQuote quote;
+    visit_levels(side, [&quote](const LevelQuote& level) {
+        quote = level;
+        return false;
+    });
+    return quote;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <typename L, IfSortedLevels<L>>
+double BasicOrderManager<Storage, Index, Levels, Stats>::mid_price() const {
+    const LevelQuote bid = best_quote(Side::Buy);
+    const LevelQuote ask = best_quote(Side::Sell);
+    if (bid.empty() || ask.empty()) return std::numeric_limits<double>::quiet_NaN();
+    return (bid.price + ask.price) / 2;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <typename L, IfSortedLevels<L>>
+double BasicOrderManager<Storage, Index, Levels, Stats>::microprice() const {
+    return ::microprice(best_quote(Side::Buy), best_quote(Side::Sell));
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <typename L, IfSortedLevels<L>>
+uint64_t BasicOrderManager<Storage, Index, Levels, Stats>::depth_quantity(
+        Side side, size_t levels) const {
+    uint64_t quantity = 0;
+    size_t seen = 0;
+    if (levels == 0) return 0;
+    visit_levels(side, [&](const LevelQuote& level) {
+        quantity += level.quantity;
+        return ++seen < levels;
+    });
+    return quantity;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <typename L, IfSortedLevels<L>>
+double BasicOrderManager<Storage, Index, Levels, Stats>::imbalance(size_t levels) const {
+    return ::imbalance(depth_quantity(Side::Buy, levels), depth_quantity(Side::Sell, levels));
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <typename L, IfSortedLevels<L>>
+SweepEstimate BasicOrderManager<Storage, Index, Levels, Stats>::estimate_sweep(
+        Side side, uint64_t quantity) const {
+    return side == Side::Buy ? estimate_sweep_side<Side::Buy>(quantity)
+                             : estimate_sweep_side<Side::Sell>(quantity);
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <Side S>
+SweepEstimate BasicOrderManager<Storage, Index, Levels, Stats>::estimate_sweep_side(
+        uint64_t quantity) const {
+    if constexpr (Levels::kDepthIndex) {
+        return levels_.template estimate_sweep<S>(quantity);
+    } else {
+        SweepEstimate estimate;
+        if (quantity == 0) return estimate;
+        levels_.template visit_levels<S>(storage_, index_, [&](const LevelQuote& level) {
+            const uint64_t take = std::min(quantity - estimate.filled, level.quantity);
+            estimate.filled += take;
+            estimate.notional += level.price * static_cast<double>(take);
+            estimate.worst_price = level.price;
+            return estimate.filled < quantity;
+        });
+        return estimate;
+    }
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <typename L, IfSortedLevels<L>>
+uint64_t BasicOrderManager<Storage, Index, Levels, Stats>::depth_through(
+        Side side, double price) const {
+    return side == Side::Buy ? depth_through_side<Side::Buy>(price)
+                             : depth_through_side<Side::Sell>(price);
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+template <Side S>
+uint64_t BasicOrderManager<Storage, Index, Levels, Stats>::depth_through_side(double price) const {
+    if constexpr (Levels::kDepthIndex) {
+        return levels_.template depth_through<S>(price);
+    } else {
+        uint64_t quantity = 0;
+        levels_.template visit_levels<S>(storage_, index_, [&](const LevelQuote& level) {
+            // Level prices come off a tick grid; allow for the last-bit error
+            const double slack = std::fabs(price) * 1e-12;
+            if (SideTraits<S>::better(price, level.price) && std::fabs(price - level.price) > slack) {
+                return false;
+            }
+            quantity += level.quantity;
+            return true;
+        });
+        return quantity;
+    }
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+OrderStatus BasicOrderManager<Storage, Index, Levels, Stats>::queue_position(
+        uint64_t order_id, uint64_t& quantity_ahead) noexcept {
+    const OrderHandle handle = index_.find(order_id);
+    if (handle == kNullHandle) {
+        return OrderStatus::UnknownId;
+    }
+    return storage_[handle].is_buy()
+        ? levels_.template queue_ahead<Side::Buy>(storage_, handle, quantity_ahead)
+        : levels_.template queue_ahead<Side::Sell>(storage_, handle, quantity_ahead);
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+void BasicOrderManager<Storage, Index, Levels, Stats>::print_snapshot(std::ostream& os) const {
+    write_snapshot_header(os, size());
+
+    // Print orders sorted by price (best prices first)
+    for_each_order([&os](const Order& order) { write_snapshot_row(os, order); });
+
+    write_snapshot_footer(os, size());
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+void BasicOrderManager<Storage, Index, Levels, Stats>::capture_snapshot(
+        std::vector<Order>& out) const {
+    out.clear();
+    out.reserve(size());
+    if constexpr (Levels::kSorted) {
+        // The level walk is already in snapshot order
+        for_each_order([&out](const Order& order) { out.push_back(order); });
+    } else {
+        // Flat index scan; the consumer sorts with sort_snapshot()
+        index_.for_each([&](uint64_t, OrderHandle handle) { out.push_back(storage_[handle]); });
+    }
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+OrderStatus BasicOrderManager<Storage, Index, Levels, Stats>::print_snapshot_to_file(
+        const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        return OrderStatus::IoError;
+    }
+    print_snapshot(file);
+    return file.good() ? OrderStatus::Ok : OrderStatus::IoError;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+size_t BasicOrderManager<Storage, Index, Levels, Stats>::load_from_csv(
+        const std::string& filename, OrderStatus* status) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        if (status) *status = OrderStatus::IoError;
+        return 0;
+    }
+    if (status) *status = OrderStatus::Ok;
+
+    size_t loaded_count = 0;
+    std::string line;
+    Order order;
+
+    // Skip header line if it exists
+    std::getline(file, line);
+    if (line.find("id") != std::string::npos || line.find("ID") != std::string::npos) {
+        // This looks like a header, skip it
+    } else {
+        // Not a header, process this line
+        if (parse_order_csv_line(line, order) == OrderStatus::Ok && add_order(order)) {
+            loaded_count++;
+        }
+    }
+
+    // Process remaining lines
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+
+        if (parse_order_csv_line(line, order) == OrderStatus::Ok && add_order(order)) {
+            loaded_count++;
+        }
+    }
+
+    return loaded_count;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+void BasicOrderManager<Storage, Index, Levels, Stats>::print_stats(std::ostream& os) const {
+    os << "\n=== ORDER MANAGER STATISTICS ===" << std::endl;
+    os << "Active Orders: " << size() << std::endl;
+    stats_.print(os);
+    os << "State Hash: " << std::hex << hash_.value() << std::dec
+       << " (sequence " << hash_.sequence() << ")" << std::endl;
+    os << "Order Struct Size: " << sizeof(Order) << " bytes" << std::endl;
+    os << "Memory Usage (estimate): " << (size() * sizeof(Order)) << " bytes" << std::endl;
+    if (Levels::kSorted) {
+        os << "Price Levels: " << levels_.level_count() << std::endl;
+    }
+    index_.print_stats(os);
+    os << std::endl;
+}
+
+template <typename Storage, typename Index, typename Levels, typename Stats>
+void BasicOrderManager<Storage, Index, Levels, Stats>::clear() {
+    index_.clear();
+    storage_.clear();
+    levels_.clear();
+    totals_.reset();
+    accounts_.clear();
+    timers_.clear();
+    risk_.clear_open();
+    hash_.on_clear();
+    stats_.reset();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+/**
+ * @brief Memory resource tuned for the small, fixed-size nodes of a book
+ *
+ * Requests up to kMaxBlock bytes (tree nodes, small vectors) are rounded up
+ * to one of four size classes and served from per-class free lists, carved
+ * out of large slabs taken from the upstream resource. Anything larger
+ * (storage chunks, hash tables, ladders) is passed straight upstream.
+ *
+ * Performance considerations:
+ * - No locking: one resource per book, owned by the thread driving it
+ * - Freed blocks are reused LIFO, so churn at one price stays on warm lines
+ * - Slabs are only returned upstream by release() or the destructor, so a
+ *   whole book's small allocations are freed in one pass over the slabs
+ */
+class OrderPoolResource : public std::pmr::memory_resource {
+public:
+    static constexpr size_t kMaxBlock = 128;
+    static constexpr size_t kDefaultSlabBytes = 64 * 1024;
+
+    explicit OrderPoolResource(
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+        size_t slab_bytes = kDefaultSlabBytes);
+    ~OrderPoolResource() override;
+
+    OrderPoolResource(const OrderPoolResource&) = delete;
+    OrderPoolResource& operator=(const OrderPoolResource&) = delete;
+
+    /**
+     * @brief Return every slab upstream; all pooled blocks become invalid
+     * Large blocks are not tracked and must already have been deallocated.
+     */
+    void release();
+
+    std::pmr::memory_resource* upstream_resource() const { return upstream_; }
+
+    /**
+     * @brief Bytes currently held in slabs (pooled blocks, used or free)
+     */
+    size_t slab_bytes_reserved() const { return reserved_; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    static constexpr size_t kAlign = 16;
+    static constexpr size_t kClassCount = 4;  // 16, 32, 64, 128 bytes
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    // Header at the start of every slab, chaining them for release()
+    struct alignas(kAlign) Slab {
+        Slab* next;
+        size_t bytes;
+    };
+
+    static bool pooled(size_t bytes, size_t alignment) {
+        return bytes <= kMaxBlock && alignment <= kAlign;
+    }
+
+    static size_t size_class(size_t bytes) {
+        size_t cls = 0;
+        while ((kAlign << cls) < bytes) cls++;
+        return cls;
+    }
+
+    void* refill(size_t cls);
+
+    std::pmr::memory_resource* upstream_;
+    size_t slab_bytes_;
+    FreeBlock* free_[kClassCount] = {};
+    Slab* slabs_ = nullptr;
+    char* cursor_ = nullptr;  // Unused tail of the newest slab
+    char* end_ = nullptr;
+    size_t reserved_ = 0;
+};
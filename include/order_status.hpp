@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Outcome of a book operation
+ *
+ * Returned by the noexcept entry points instead of throwing, so callers can
+ * branch on the reason for a rejection without unwinding support.
+ */
+enum class OrderStatus : uint8_t {
+    Ok,
+    Duplicate,     // Order ID already resting in the book
+    UnknownId,     // No resting order with this ID
+    InvalidPrice,  // Price rejected by the level policy (off grid, out of band)
+    BookFull,      // Index or storage capacity exhausted
+    ParseError,    // Malformed input record
+    IoError,       // File could not be opened or written
+    Busy,          // A previous background operation is still running
+    Unsupported,   // The configured policies cannot answer this query
+    Expired,       // Expiry time not after the book's clock
+    OrderTooLarge, // Quantity above the account's max order size
+    PriceOutOfBand, // Price outside the fat-finger band around the reference
+    PositionLimit, // Would allow the account's position past its limit
+    NotionalLimit  // Would take the account's open notional past its limit
+};
+
+constexpr const char* status_name(OrderStatus status) noexcept {
+    switch (status) {
+        case OrderStatus::Ok:           return "ok";
+        case OrderStatus::Duplicate:    return "duplicate order ID";
+        case OrderStatus::UnknownId:    return "unknown order ID";
+        case OrderStatus::InvalidPrice: return "invalid price";
+        case OrderStatus::BookFull:     return "book full";
+        case OrderStatus::ParseError:   return "parse error";
+        case OrderStatus::IoError:      return "I/O error";
+        case OrderStatus::Busy:         return "busy";
+        case OrderStatus::Unsupported:  return "unsupported";
+        case OrderStatus::Expired:      return "already expired";
+        case OrderStatus::OrderTooLarge: return "order too large";
+        case OrderStatus::PriceOutOfBand: return "price out of band";
+        case OrderStatus::PositionLimit: return "position limit";
+        case OrderStatus::NotionalLimit: return "open notional limit";
+    }
+    return "unknown status";
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "order.hpp"
+#include "try_allocate.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Dense 32-bit handle to an order record inside a storage policy
+ *
+ * Indexes and price levels refer to orders by handle rather than by pointer:
+ * half the size, and stable across index rehashes.
+ */
+using OrderHandle = uint32_t;
+constexpr OrderHandle kNullHandle = UINT32_MAX;
+
+/**
+ * @brief Intrusive links threading an order through its price level FIFO
+ *
+ * Kept in a separate column from Order so the hot 24-byte record is not
+ * widened by bookkeeping that only the level structures read.
+ */
+struct OrderLinks {
+    OrderHandle prev = kNullHandle;
+    OrderHandle next = kNullHandle;
+};
+
+/**
+ * @brief Storage policy: chunked slab of order records addressed by handle
+ *
+ * Performance considerations:
+ * - Fixed-size chunks never move, so Order pointers stay valid until the
+ *   order itself is released (a vector would invalidate them on growth)
+ * - Freed handles are reused LIFO, so the next add lands on a warm line
+ * - Hot Order records and cold link records live in parallel chunks
+ * - Chunks and the free list come from the memory resource given at
+ *   construction; with a monotonic arena, releasing them is a no-op
+ */
+class PooledStorage {
+private:
+    static constexpr uint32_t kChunkShift = 12;  // 4096 orders (96 KB) per chunk
+    static constexpr uint32_t kChunkSize = 1u << kChunkShift;
+    static constexpr uint32_t kChunkMask = kChunkSize - 1;
+
+    std::pmr::memory_resource* resource_;
+    std::pmr::vector<Order*> orders_;
+    std::pmr::vector<OrderLinks*> links_;
+    std::pmr::vector<OrderHandle> free_;
+    uint32_t next_ = 0;  // First never-used handle
+    uint32_t limit_ = kNullHandle;  // allocate() fails once next_ reaches it
+    size_t live_ = 0;
+
+public:
+    explicit PooledStorage(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource_(resource), orders_(resource), links_(resource), free_(resource) {}
+    ~PooledStorage() { release_chunks(); }
+
+    PooledStorage(const PooledStorage&) = delete;
+    PooledStorage& operator=(const PooledStorage&) = delete;
+
+    // Chunks stay with the resource they came from, so a book can be moved
+    // but not move-assigned over one that may use a different resource
+    PooledStorage(PooledStorage&& other) noexcept
+        : resource_(other.resource_),
+          orders_(std::move(other.orders_)),
+          links_(std::move(other.links_)),
+          free_(std::move(other.free_)),
+          next_(std::exchange(other.next_, 0)),
+          limit_(std::exchange(other.limit_, kNullHandle)),
+          live_(std::exchange(other.live_, 0)) {}
+    PooledStorage& operator=(PooledStorage&&) = delete;
+
+    /**
+     * @brief Store order in a free record
+     * @return Its handle, or kNullHandle once the 32-bit handle space (or
+     *         the set_max_orders cap) is used up or a new chunk could not be
+     *         allocated
+     */
+    OrderHandle allocate(const Order& order) {
+        OrderHandle handle;
+        if (!free_.empty()) {
+            handle = free_.back();
+            free_.pop_back();
+        } else {
+            if (next_ == limit_) {
+                return kNullHandle;
+            }
+            if ((next_ >> kChunkShift) == orders_.size() && !add_chunk()) {
+                return kNullHandle;
+            }
+            handle = next_++;
+        }
+        (*this)[handle] = order;
+        links(handle) = OrderLinks{};
+        live_++;
+        return handle;
+    }
+
+    // Never allocates: the free list is kept at least as large as capacity()
+    void release(OrderHandle handle) {
+        free_.push_back(handle);
+        live_--;
+    }
+
+    Order& operator[](OrderHandle handle) {
+        return orders_[handle >> kChunkShift][handle & kChunkMask];
+    }
+    const Order& operator[](OrderHandle handle) const {
+        return orders_[handle >> kChunkShift][handle & kChunkMask];
+    }
+
+    OrderLinks& links(OrderHandle handle) {
+        return links_[handle >> kChunkShift][handle & kChunkMask];
+    }
+    const OrderLinks& links(OrderHandle handle) const {
+        return links_[handle >> kChunkShift][handle & kChunkMask];
+    }
+
+    // false if a chunk could not be allocated (the chunks added so far stay)
+    bool reserve(size_t n) {
+        n = std::min<size_t>(n, limit_);
+        while (orders_.size() * kChunkSize < n) {
+            if (!add_chunk()) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Cap the store at max_orders records and size the chunk
+     *        directories for that cap now
+     *
+     * Chunks are still added on demand, but the directories never move
+     * again, so another thread that was handed a handle under a lock can
+     * read its record while the owner keeps allocating. Call before the
+     * first allocate().
+     * @return false if the directories could not be allocated
+     */
+    bool set_max_orders(size_t max_orders) {
+        max_orders = std::min<size_t>(max_orders, kNullHandle);
+        const size_t chunks = (max_orders + kChunkSize - 1) / kChunkSize;
+        if (!try_allocate([&] {
+                orders_.reserve(chunks);
+                links_.reserve(chunks);
+            })) {
+            return false;
+        }
+        limit_ = static_cast<uint32_t>(max_orders);
+        return true;
+    }
+
+    /**
+     * @brief Forget every record but keep the chunks for reuse
+     */
+    void clear() {
+        free_.clear();
+        next_ = 0;
+        live_ = 0;
+    }
+
+    size_t size() const { return live_; }
+    size_t capacity() const { return orders_.size() * kChunkSize; }
+    std::pmr::memory_resource* resource() const { return resource_; }
+
+private:
+    // All or nothing: on failure no chunk is added and nothing leaks
+    bool add_chunk() {
+        Order* orders = nullptr;
+        OrderLinks* links = nullptr;
+        const bool allocated = try_allocate([&] {
+            // Room in every directory first, so the push_backs below cannot fail
+            if (orders_.size() == orders_.capacity()) {
+                orders_.reserve(std::max<size_t>(8, 2 * orders_.capacity()));
+                links_.reserve(orders_.capacity());
+            }
+            const size_t capacity = (orders_.size() + 1) * kChunkSize;
+            if (free_.capacity() < capacity) {
+                free_.reserve(std::max(capacity, 2 * free_.capacity()));
+            }
+            orders = static_cast<Order*>(
+                resource_->allocate(kChunkSize * sizeof(Order), alignof(Order)));
+            links = static_cast<OrderLinks*>(
+                resource_->allocate(kChunkSize * sizeof(OrderLinks), alignof(OrderLinks)));
+        });
+        if (!allocated) {
+            if (orders) resource_->deallocate(orders, kChunkSize * sizeof(Order), alignof(Order));
+            return false;
+        }
+        orders_.push_back(orders);
+        links_.push_back(links);
+        return true;
+    }
+
+    void release_chunks() {
+        for (Order* chunk : orders_) {
+            resource_->deallocate(chunk, kChunkSize * sizeof(Order), alignof(Order));
+        }
+        for (OrderLinks* chunk : links_) {
+            resource_->deallocate(chunk, kChunkSize * sizeof(OrderLinks), alignof(OrderLinks));
+        }
+        orders_.clear();
+        links_.clear();
+        free_.clear();
+        next_ = 0;
+        live_ = 0;
+    }
+};
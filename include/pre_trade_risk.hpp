@@ -0,0 +1,190 @@
+#pragma once
+
+#include "account_index.hpp"
+#include "flat_hash_map.hpp"
+#include "order.hpp"
+#include "order_status.hpp"
+#include "try_allocate.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * @brief Pre-trade limits of one account; the defaults impose none
+ */
+struct RiskLimits {
+    uint32_t max_order_quantity = std::numeric_limits<uint32_t>::max();
+    // Largest |position| reachable if every open order on one side filled
+    int64_t max_position = std::numeric_limits<int64_t>::max();
+    // Largest sum of price * quantity over the account's resting orders
+    double max_open_notional = std::numeric_limits<double>::infinity();
+    // Largest |price / reference - 1| accepted (fat-finger band)
+    double price_band = std::numeric_limits<double>::infinity();
+};
+
+/**
+ * @brief Risk state of one account, one cache line per account
+ */
+struct alignas(64) AccountRisk {
+    RiskLimits limits;
+    int64_t position = 0;  // Filled buys minus filled sells
+    uint64_t open_buy = 0;
+    uint64_t open_sell = 0;
+    double open_notional = 0.0;
+};
+static_assert(sizeof(AccountRisk) == 64, "AccountRisk should fill exactly one cache line");
+
+/**
+ * @brief In-process pre-trade risk checks for the add path
+ *
+ * Each account's limits and exposure share one 64-byte record, so a check
+ * is a hash lookup and one cache line. The state is written only by the
+ * thread that owns the book, as part of each add, cancel and fill, so it
+ * needs no locks or atomics. Books that configure no limits skip all of it
+ * on one branch.
+ *
+ * Order-level checks (size, price band) use the account's limits, or the
+ * defaults for orders without an account; exposure is tracked per account.
+ */
+class PreTradeRisk {
+private:
+    RiskLimits defaults_;
+    std::pmr::vector<AccountRisk> records_;
+    FlatHashMap<uint32_t> slots_;  // Account -> index into records_
+    bool enabled_ = false;
+
+public:
+    explicit PreTradeRisk(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : records_(resource), slots_(resource) {}
+
+    bool enabled() const { return enabled_; }
+
+    // Limits of accounts without their own, and of orders without an account
+    void set_default_limits(const RiskLimits& limits) {
+        defaults_ = limits;
+        enabled_ = true;
+    }
+
+    /**
+     * @brief Set one account's limits; its exposure is kept
+     * @return false if the account table could not grow
+     */
+    bool set_limits(AccountId account, const RiskLimits& limits) {
+        AccountRisk* record = find_or_add(account);
+        if (!record) return false;
+        record->limits = limits;
+        enabled_ = true;
+        return true;
+    }
+
+    const AccountRisk* find(AccountId account) const {
+        const uint32_t* slot = slots_.find(account);
+        return slot ? &records_[*slot] : nullptr;
+    }
+
+    /**
+     * @brief Run every check for order against reference (NaN: no band check)
+     *
+     * Read-only: an account seen for the first time is checked against the
+     * defaults with no exposure, and gets its record only in on_add.
+     * @return Ok, OrderTooLarge, PriceOutOfBand, PositionLimit or NotionalLimit
+     */
+    template <Side S>
+    OrderStatus check(AccountId account, const Order& order, double reference) const {
+        const AccountRisk* record = account != kNoAccount ? find(account) : nullptr;
+        const RiskLimits* limits = record ? &record->limits : &defaults_;
+
+        if (order.quantity > limits->max_order_quantity) return OrderStatus::OrderTooLarge;
+        // A NaN reference fails the comparison and skips the band
+        if (std::fabs(order.price - reference) > limits->price_band * reference) {
+            return OrderStatus::PriceOutOfBand;
+        }
+        if (account == kNoAccount) return OrderStatus::Ok;
+
+        const AccountRisk fresh{defaults_};
+        const AccountRisk& exposure = record ? *record : fresh;
+        if constexpr (S == Side::Buy) {
+            if (exposure.position + static_cast<int64_t>(exposure.open_buy + order.quantity) >
+                limits->max_position) {
+                return OrderStatus::PositionLimit;
+            }
+        } else {
+            if (static_cast<int64_t>(exposure.open_sell + order.quantity) - exposure.position >
+                limits->max_position) {
+                return OrderStatus::PositionLimit;
+            }
+        }
+        if (exposure.open_notional + order.price * order.quantity > limits->max_open_notional) {
+            return OrderStatus::NotionalLimit;
+        }
+        return OrderStatus::Ok;
+    }
+
+    /**
+     * @brief The checked order now rests on the book: count it
+     * @return false if the account needed a record and the table is full
+     */
+    template <Side S>
+    bool on_add(AccountId account, const Order& order) {
+        if (account == kNoAccount) return true;
+        AccountRisk* record = find_or_add(account);
+        if (!record) return false;
+        (S == Side::Buy ? record->open_buy : record->open_sell) += order.quantity;
+        record->open_notional += order.price * order.quantity;
+        return true;
+    }
+
+    // quantity of an account's resting order left the book (cancel or fill).
+    // Clamped at zero: orders resting from before the limits were set
+    // were never counted.
+    template <Side S>
+    void on_release(AccountId account, double price, uint64_t quantity) {
+        if (account == kNoAccount) return;
+        AccountRisk* record = find_mutable(account);
+        if (!record) return;
+        uint64_t& open = S == Side::Buy ? record->open_buy : record->open_sell;
+        open -= std::min(open, quantity);
+        record->open_notional = std::max(0.0, record->open_notional - price * static_cast<double>(quantity));
+        // Cancel rounding drift once nothing is open
+        if (record->open_buy == 0 && record->open_sell == 0) record->open_notional = 0.0;
+    }
+
+    // quantity of an account's resting order traded
+    template <Side S>
+    void on_fill(AccountId account, uint64_t quantity) {
+        if (account == kNoAccount) return;
+        AccountRisk* record = find_mutable(account);
+        if (!record) return;
+        record->position += S == Side::Buy ? static_cast<int64_t>(quantity)
+                                           : -static_cast<int64_t>(quantity);
+    }
+
+    // Forget all open orders; positions and limits are kept
+    void clear_open() {
+        for (AccountRisk& record : records_) {
+            record.open_buy = 0;
+            record.open_sell = 0;
+            record.open_notional = 0.0;
+        }
+    }
+
+private:
+    AccountRisk* find_mutable(AccountId account) {
+        uint32_t* slot = slots_.find(account);
+        return slot ? &records_[*slot] : nullptr;
+    }
+
+    AccountRisk* find_or_add(AccountId account) {
+        if (AccountRisk* record = find_mutable(account)) return record;
+        const uint32_t slot = static_cast<uint32_t>(records_.size());
+        if (!try_allocate([&] { records_.push_back(AccountRisk{defaults_}); })) return nullptr;
+        if (!slots_.insert(account, slot).first) {
+            records_.pop_back();
+            return nullptr;
+        }
+        return &records_.back();
+    }
+};
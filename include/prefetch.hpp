@@ -0,0 +1,16 @@
+#pragma once
+
+/**
+ * @brief Portable software prefetch hints
+ * 
+ * Used by the batched paths to start cache misses for later items while
+ * earlier items are still being applied. Falls back to a no-op on
+ * compilers without __builtin_prefetch.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define LOB_PREFETCH_READ(addr) __builtin_prefetch((addr), 0, 3)
+#define LOB_PREFETCH_WRITE(addr) __builtin_prefetch((addr), 1, 3)
+#else
+#define LOB_PREFETCH_READ(addr) ((void)(addr))
+#define LOB_PREFETCH_WRITE(addr) ((void)(addr))
+#endif
@@ -0,0 +1,956 @@
+#pragma once
+
+#include "book_analytics.hpp"
+#include "fenwick_tree.hpp"
+#include "order_status.hpp"
+#include "order_storage.hpp"
+#include "radix_sort.hpp"
+#include "try_allocate.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+constexpr uint32_t kNoQueueTracker = UINT32_MAX;
+
+/**
+ * @brief FIFO of all orders resting at one price, and their total quantity
+ *
+ * Orders are chained through their OrderLinks in arrival order, so the
+ * level itself stays a small fixed-size header. It holds exactly what
+ * matching and depth reads need: 16 bytes, four to a cache line, so the
+ * top levels of a LadderLevels side share one or two lines. The order
+ * count and queue tracker live beside it in a LevelTally.
+ */
+struct alignas(16) PriceLevel {
+    OrderHandle head = kNullHandle;
+    OrderHandle tail = kNullHandle;
+    uint64_t quantity = 0;
+
+    bool empty() const { return head == kNullHandle; }
+};
+static_assert(sizeof(PriceLevel) == 16, "PriceLevel should be 16 bytes: four headers per cache line");
+static_assert(alignof(PriceLevel) == 16, "PriceLevel should never straddle a cache line");
+
+/**
+ * @brief Bookkeeping of one price level, read only for quotes and queue positions
+ */
+struct LevelTally {
+    uint32_t count = 0;
+    uint32_t tracker = kNoQueueTracker;  // QueueTrackers slot, if queue positions are tracked
+};
+static_assert(sizeof(LevelTally) == 8, "LevelTally should be 8 bytes: eight per cache line");
+
+template <typename Storage>
+void level_append(Storage& storage, PriceLevel& level, LevelTally& tally, OrderHandle handle) {
+    OrderLinks& links = storage.links(handle);
+    links.prev = level.tail;
+    links.next = kNullHandle;
+    if (level.tail != kNullHandle) {
+        storage.links(level.tail).next = handle;
+    } else {
+        level.head = handle;
+    }
+    level.tail = handle;
+    level.quantity += storage[handle].quantity;
+    tally.count++;
+}
+
+template <typename Storage>
+void level_remove(Storage& storage, PriceLevel& level, LevelTally& tally, OrderHandle handle) {
+    const OrderLinks links = storage.links(handle);
+    if (links.prev != kNullHandle) {
+        storage.links(links.prev).next = links.next;
+    } else {
+        level.head = links.next;
+    }
+    if (links.next != kNullHandle) {
+        storage.links(links.next).prev = links.prev;
+    } else {
+        level.tail = links.prev;
+    }
+    level.quantity -= storage[handle].quantity;
+    tally.count--;
+}
+
+template <typename Storage, typename Fn>
+void level_for_each(const Storage& storage, const PriceLevel& level, Fn& fn) {
+    for (OrderHandle h = level.head; h != kNullHandle; h = storage.links(h).next) {
+        fn(storage[h]);
+    }
+}
+
+// Like level_for_each, but fn returns false to stop; returns false if it did
+template <typename Storage, typename Fn>
+bool level_visit(const Storage& storage, const PriceLevel& level, Fn& fn) {
+    for (OrderHandle h = level.head; h != kNullHandle; h = storage.links(h).next) {
+        if (!fn(storage[h])) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Handles read out of an array of keyed items, for batched erases
+ */
+template <typename Handle>
+struct HandleColumn {
+    const KeyedItem<Handle>* items;
+    Handle operator[](size_t i) const { return items[i].value; }
+};
+
+/**
+ * @brief Queue-position index for the levels whose positions are queried
+ *
+ * A tracked level numbers its orders in arrival order and keeps their
+ * quantities in a Fenwick tree by number, so the quantity ahead of an
+ * order is one prefix sum. A level is tracked from its first query until
+ * it empties; untracked levels cost one branch per update. When the
+ * numbers run out the live orders are renumbered from 0, which is O(level)
+ * but happens at most once per level-size appends.
+ *
+ * Tracking is only an accelerator, so book updates never fail on it: a
+ * level whose tracker cannot grow is simply untracked again, and the next
+ * query rebuilds it. The free list always has room for every tracker, so
+ * untracking never allocates.
+ */
+class QueueTrackers {
+private:
+    struct Tracker {
+        FenwickTree quantity;
+        uint32_t next_seq = 0;
+    };
+
+    std::pmr::vector<Tracker> trackers_;
+    std::pmr::vector<uint32_t> free_;  // Released tracker slots
+    std::pmr::vector<uint32_t> seq_;   // By handle: arrival number within its level
+
+public:
+    explicit QueueTrackers(std::pmr::memory_resource* resource)
+        : trackers_(resource), free_(resource), seq_(resource) {}
+
+    // After level_append
+    template <typename Storage>
+    void on_append(const Storage& storage, const PriceLevel& level, LevelTally& tally,
+                   OrderHandle handle) {
+        if (tally.tracker == kNoQueueTracker) return;
+        Tracker& tracker = trackers_[tally.tracker];
+        if (tracker.next_seq == tracker.quantity.size()) {
+            if (!renumber(storage, level, tally, tracker)) untrack(tally);
+            return;
+        }
+        if (!cover(handle)) {
+            untrack(tally);
+            return;
+        }
+        seq_[handle] = tracker.next_seq++;
+        tracker.quantity.add(seq_[handle], storage[handle].quantity);
+    }
+
+    // After level_remove; quantity is what the order still had open
+    void on_remove(LevelTally& tally, OrderHandle handle, uint64_t quantity) {
+        if (tally.tracker == kNoQueueTracker) return;
+        if (tally.count == 0) {
+            untrack(tally);
+            return;
+        }
+        trackers_[tally.tracker].quantity.add(seq_[handle], -static_cast<int64_t>(quantity));
+    }
+
+    void on_fill(const LevelTally& tally, OrderHandle handle, uint64_t quantity) {
+        if (tally.tracker == kNoQueueTracker) return;
+        trackers_[tally.tracker].quantity.add(seq_[handle], -static_cast<int64_t>(quantity));
+    }
+
+    /**
+     * @brief Quantity resting ahead of handle in level, tracking the level if needed
+     * @return false if the level was untracked and its tracker could not be built
+     */
+    template <typename Storage>
+    bool ahead(const Storage& storage, const PriceLevel& level, LevelTally& tally,
+               OrderHandle handle, uint64_t& quantity) {
+        if (tally.tracker == kNoQueueTracker) {
+            if (free_.empty()) {
+                const bool added = try_allocate([&] {
+                    if (free_.capacity() <= trackers_.size()) free_.reserve(2 * trackers_.size() + 1);
+                    trackers_.push_back(Tracker{FenwickTree(0, trackers_.get_allocator().resource())});
+                });
+                if (!added) return false;
+                tally.tracker = static_cast<uint32_t>(trackers_.size() - 1);
+            } else {
+                tally.tracker = free_.back();
+                free_.pop_back();
+            }
+            if (!renumber(storage, level, tally, trackers_[tally.tracker])) {
+                untrack(tally);
+                return false;
+            }
+        }
+        const int64_t before = static_cast<int64_t>(seq_[handle]) - 1;
+        quantity = static_cast<uint64_t>(trackers_[tally.tracker].quantity.prefix(before));
+        return true;
+    }
+
+    size_t tracked_levels() const { return trackers_.size() - free_.size(); }
+
+    void clear() {
+        trackers_.clear();
+        free_.clear();
+    }
+
+private:
+    // Grow the sequence column to reach handle; false if it could not
+    bool cover(OrderHandle handle) {
+        return handle < seq_.size() ||
+               try_allocate([&] { seq_.resize(std::max<size_t>(handle + 1, seq_.size() * 2)); });
+    }
+
+    // Never allocates: free_ has room for every tracker
+    void untrack(LevelTally& tally) {
+        free_.push_back(tally.tracker);
+        tally.tracker = kNoQueueTracker;
+    }
+
+    // Number the live orders 0..count-1 in FIFO order, with room to double;
+    // false (tracker unchanged) if its memory could not be allocated
+    template <typename Storage>
+    bool renumber(const Storage& storage, const PriceLevel& level, const LevelTally& tally,
+                  Tracker& tracker) {
+        OrderHandle top = 0;
+        for (OrderHandle h = level.head; h != kNullHandle; h = storage.links(h).next) {
+            top = std::max(top, h);
+        }
+        // The new tree is built before it replaces the old one, so a failure
+        // leaves the tracker as it was
+        const size_t size = std::max<size_t>(16, size_t{2} * tally.count);
+        if (!cover(top) || !try_allocate([&] {
+                tracker.quantity = FenwickTree(size, trackers_.get_allocator().resource());
+            })) {
+            return false;
+        }
+        tracker.next_seq = 0;
+        for (OrderHandle h = level.head; h != kNullHandle; h = storage.links(h).next) {
+            seq_[h] = tracker.next_seq;
+            tracker.quantity.add(tracker.next_seq++, storage[h].quantity);
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Maps double prices onto an integer tick grid
+ */
+class TickGrid {
+private:
+    double tick_size_;
+
+public:
+    explicit TickGrid(double tick_size) : tick_size_(tick_size) {}
+
+    int64_t to_ticks(double price) const { return std::llround(price / tick_size_); }
+    double to_price(int64_t ticks) const { return ticks * tick_size_; }
+
+    // Nearest grid tick at or below / at or above price, for range bounds
+    int64_t ticks_floor(double price) const {
+        return static_cast<int64_t>(std::floor(price / tick_size_ + 1e-6));
+    }
+    int64_t ticks_ceil(double price) const {
+        return static_cast<int64_t>(std::ceil(price / tick_size_ - 1e-6));
+    }
+
+    /**
+     * @brief Range [lo, hi] as ticks ordered for side S: better end, worse end
+     */
+    template <Side S>
+    std::pair<int64_t, int64_t> side_bounds(double lo, double hi) const {
+        if constexpr (S == Side::Buy) return {ticks_floor(hi), ticks_ceil(lo)};
+        else return {ticks_ceil(lo), ticks_floor(hi)};
+    }
+
+    bool on_grid(double price) const {
+        return std::isfinite(price) &&
+               std::fabs(to_price(to_ticks(price)) - price) <= tick_size_ * 1e-6;
+    }
+
+    double tick_size() const { return tick_size_; }
+};
+
+/**
+ * @brief Level policy: no price structure, sort on demand
+ *
+ * The original OrderManager behaviour. Adds and cancels only mark the
+ * snapshot cache dirty; a snapshot rebuilds it from the index and sorts it.
+ * Cheapest possible hot path, O(n) radix-sorted snapshots, any finite
+ * price accepted. With no price order to walk it offers no visit_levels,
+ * visit_from_best or visit_range, so the book's price-ordered queries do
+ * not exist on it.
+ *
+ * The rebuild reads each order once into a contiguous (price key, pointer)
+ * buffer per side and radix sorts that, so the sort itself never touches
+ * the scattered Order records.
+ */
+class UnsortedLevels {
+private:
+    using Item = KeyedItem<const Order*>;
+
+    // Cold path: only touched when printing, one sorted cache per side
+    mutable std::pmr::vector<Item> bids_;
+    mutable std::pmr::vector<Item> asks_;
+    mutable std::pmr::vector<Item> scratch_;
+    mutable bool snapshot_dirty_ = true;
+
+public:
+    static constexpr bool kSorted = false;
+    static constexpr bool kDepthIndex = false;
+
+    explicit UnsortedLevels(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : bids_(resource), asks_(resource), scratch_(resource) {}
+
+    bool accepts(const Order& order) const { return std::isfinite(order.price); }
+
+    template <Side S, typename Storage>
+    bool insert(Storage&, OrderHandle) {
+        snapshot_dirty_ = true;
+        return true;
+    }
+
+    template <Side S>
+    bool prepare(double) { return true; }
+
+    template <Side S, typename Storage>
+    void erase(Storage&, OrderHandle) { snapshot_dirty_ = true; }
+
+    template <Side S, typename Storage, typename Handles>
+    void erase_batch(Storage&, const Handles&, size_t) { snapshot_dirty_ = true; }
+
+    // No aggregates to adjust; the cache order depends on price only
+    template <Side S, typename Storage>
+    void reduce(Storage&, OrderHandle, uint32_t) {}
+
+    // No time priority is kept, so there is no queue to stand in
+    template <Side S, typename Storage>
+    OrderStatus queue_ahead(const Storage&, OrderHandle, uint64_t&) { return OrderStatus::Unsupported; }
+
+    /**
+     * @brief Visit orders bids first (best to worst), then asks (best to worst)
+     */
+    template <typename Storage, typename Index, typename Fn>
+    void for_each_sorted(const Storage& storage, const Index& index, Fn&& fn) const {
+        rebuild_snapshot_cache(storage, index);
+        for (const Item& item : bids_) fn(*item.value);
+        for (const Item& item : asks_) fn(*item.value);
+    }
+
+    void clear() {
+        bids_.clear();
+        asks_.clear();
+        snapshot_dirty_ = false;
+    }
+
+    size_t level_count() const { return 0; }
+
+private:
+    template <typename Storage, typename Index>
+    void rebuild_snapshot_cache(const Storage& storage, const Index& index) const {
+        if (!snapshot_dirty_) return;
+
+        // Partition by side once, so the keys never need to encode it
+        bids_.clear();
+        asks_.clear();
+        bids_.reserve(index.size());
+        asks_.reserve(index.size());
+        index.for_each([&](uint64_t, OrderHandle handle) {
+            const Order& order = storage[handle];
+            if (order.is_buy()) {
+                bids_.push_back(Item{snapshot_key<Side::Buy>(order.price), &order});
+            } else {
+                asks_.push_back(Item{snapshot_key<Side::Sell>(order.price), &order});
+            }
+        });
+        radix_sort(bids_, scratch_);
+        radix_sort(asks_, scratch_);
+
+        snapshot_dirty_ = false;
+    }
+};
+
+/**
+ * @brief Comparator putting the better price of side S first
+ */
+template <Side S>
+struct BetterPrice {
+    bool operator()(int64_t a, int64_t b) const { return SideTraits<S>::better(a, b); }
+};
+
+/**
+ * @brief One side of a TreeLevels book: levels ordered best price first
+ */
+template <Side S>
+class TreeBookSide {
+private:
+    // Nodes are scattered anyway, so header and tally share one
+    struct Node {
+        PriceLevel level;
+        LevelTally tally;
+    };
+
+    using Map = std::pmr::map<int64_t, Node, BetterPrice<S>>;
+
+    Map levels_;
+    // The node of the last level to empty, reused by the next new level:
+    // saves a free and an allocation per level turnover, and means an
+    // order erased from a level it emptied can always go back
+    typename Map::node_type spare_;
+    QueueTrackers queues_;
+
+public:
+    explicit TreeBookSide(std::pmr::memory_resource* resource)
+        : levels_(resource), queues_(resource) {}
+
+    // Make sure an insert at ticks will not need to allocate
+    bool prepare(int64_t ticks) {
+        if (!spare_.empty() || levels_.count(ticks)) return true;
+        return try_allocate([&] { spare_ = levels_.extract(levels_.emplace(ticks, Node{}).first); });
+    }
+
+    // false only if ticks opens a new level and its node cannot be allocated
+    template <typename Storage>
+    bool insert(Storage& storage, int64_t ticks, OrderHandle handle) {
+        auto it = levels_.lower_bound(ticks);
+        if (it == levels_.end() || it->first != ticks) {
+            if (!spare_.empty()) {
+                spare_.key() = ticks;
+                spare_.mapped() = Node{};
+                it = levels_.insert(it, std::move(spare_));
+            } else if (!try_allocate([&] { it = levels_.emplace_hint(it, ticks, Node{}); })) {
+                return false;
+            }
+        }
+        Node& node = it->second;
+        level_append(storage, node.level, node.tally, handle);
+        queues_.on_append(storage, node.level, node.tally, handle);
+        return true;
+    }
+
+    // Remove n orders that all rest at ticks: one lookup for the lot
+    template <typename Storage, typename Handles>
+    void erase(Storage& storage, int64_t ticks, const Handles& handles, size_t n) {
+        auto it = levels_.find(ticks);
+        Node& node = it->second;
+        for (size_t k = 0; k < n; ++k) {
+            level_remove(storage, node.level, node.tally, handles[k]);
+            queues_.on_remove(node.tally, handles[k], storage[handles[k]].quantity);
+        }
+        if (node.level.empty()) {
+            if (spare_.empty()) {
+                spare_ = levels_.extract(it);
+            } else {
+                levels_.erase(it);
+            }
+        }
+    }
+
+    // Partial fill of an order resting at ticks
+    void reduce(int64_t ticks, OrderHandle handle, uint64_t quantity) {
+        Node& node = levels_.find(ticks)->second;
+        node.level.quantity -= quantity;
+        queues_.on_fill(node.tally, handle, quantity);
+    }
+
+    // Quantity ahead of handle at its level; false if it could not be tracked
+    template <typename Storage>
+    bool queue_ahead(const Storage& storage, int64_t ticks, OrderHandle handle, uint64_t& ahead) {
+        Node& node = levels_.find(ticks)->second;
+        return queues_.ahead(storage, node.level, node.tally, handle, ahead);
+    }
+
+    // Levels best to worst until fn(ticks, level, tally) returns false
+    template <typename Fn>
+    void visit_levels(Fn& fn) const {
+        for (const auto& [ticks, node] : levels_) {
+            if (!fn(ticks, node.level, node.tally)) return;
+        }
+    }
+
+    template <typename Storage, typename Fn>
+    void for_each(const Storage& storage, Fn& fn) const {
+        for (const auto& [ticks, node] : levels_) level_for_each(storage, node.level, fn);
+    }
+
+    // Best to worst until fn returns false
+    template <typename Storage, typename Fn>
+    void visit(const Storage& storage, Fn& fn) const {
+        for (const auto& [ticks, node] : levels_) {
+            if (!level_visit(storage, node.level, fn)) return;
+        }
+    }
+
+    // Levels from the better bound to the worse bound, both inclusive
+    template <typename Storage, typename Fn>
+    void visit_range(const Storage& storage, int64_t better, int64_t worse, Fn& fn) const {
+        for (auto it = levels_.lower_bound(better);
+             it != levels_.end() && !SideTraits<S>::better(worse, it->first); ++it) {
+            level_for_each(storage, it->second.level, fn);
+        }
+    }
+
+    bool has_best() const { return !levels_.empty(); }
+    int64_t best_ticks() const { return levels_.begin()->first; }
+    const PriceLevel& best_level() const { return levels_.begin()->second.level; }
+
+    size_t level_count() const { return levels_.size(); }
+    size_t tracked_levels() const { return queues_.tracked_levels(); }
+
+    void clear() {
+        levels_.clear();
+        queues_.clear();
+    }
+};
+
+/**
+ * @brief Level policy: balanced tree of price levels per side
+ *
+ * For sparse books (equities, wide tick ranges): memory proportional to
+ * the number of occupied prices, O(log L) level lookup, and the best price
+ * is always the first node. Prices must lie on the tick grid.
+ */
+class TreeLevels {
+private:
+    TickGrid grid_;
+    TreeBookSide<Side::Buy> bids_;
+    TreeBookSide<Side::Sell> asks_;
+
+public:
+    static constexpr bool kSorted = true;
+    static constexpr bool kDepthIndex = false;
+
+    explicit TreeLevels(double tick_size = 0.01,
+                        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : grid_(tick_size), bids_(resource), asks_(resource) {}
+    explicit TreeLevels(std::pmr::memory_resource* resource) : TreeLevels(0.01, resource) {}
+
+    bool accepts(const Order& order) const { return grid_.on_grid(order.price); }
+
+    // false if a new level's node cannot be allocated
+    template <Side S, typename Storage>
+    bool insert(Storage& storage, OrderHandle handle) {
+        return side<S>().insert(storage, grid_.to_ticks(storage[handle].price), handle);
+    }
+
+    // Allocate ahead whatever an insert at price would need; false if it
+    // cannot be. A prepared insert cannot fail, even after erases.
+    template <Side S>
+    bool prepare(double price) {
+        return side<S>().prepare(grid_.to_ticks(price));
+    }
+
+    template <Side S, typename Storage>
+    void erase(Storage& storage, OrderHandle handle) {
+        side<S>().erase(storage, grid_.to_ticks(storage[handle].price), &handle, 1);
+    }
+
+    // All n orders rest at one price; handles[i] yields an OrderHandle
+    template <Side S, typename Storage, typename Handles>
+    void erase_batch(Storage& storage, const Handles& handles, size_t n) {
+        side<S>().erase(storage, grid_.to_ticks(storage[handles[0]].price), handles, n);
+    }
+
+    template <Side S, typename Storage>
+    void reduce(Storage& storage, OrderHandle handle, uint32_t quantity) {
+        side<S>().reduce(grid_.to_ticks(storage[handle].price), handle, quantity);
+    }
+
+    // Ok, or BookFull if the level's queue tracker could not be allocated
+    template <Side S, typename Storage>
+    OrderStatus queue_ahead(const Storage& storage, OrderHandle handle, uint64_t& ahead) {
+        return side<S>().queue_ahead(storage, grid_.to_ticks(storage[handle].price), handle, ahead)
+            ? OrderStatus::Ok : OrderStatus::BookFull;
+    }
+
+    template <Side S, typename Storage, typename Index, typename Fn>
+    void visit_levels(const Storage&, const Index&, Fn&& fn) const {
+        auto at_price = [&](int64_t ticks, const PriceLevel& level, const LevelTally& tally) {
+            return fn(LevelQuote{grid_.to_price(ticks), level.quantity, tally.count});
+        };
+        side<S>().visit_levels(at_price);
+    }
+
+    template <typename Storage, typename Index, typename Fn>
+    void for_each_sorted(const Storage& storage, const Index&, Fn&& fn) const {
+        bids_.for_each(storage, fn);
+        asks_.for_each(storage, fn);
+    }
+
+    template <Side S, typename Storage, typename Index, typename Fn>
+    void visit_from_best(const Storage& storage, const Index&, Fn&& fn) const {
+        side<S>().visit(storage, fn);
+    }
+
+    template <Side S, typename Storage, typename Index, typename Fn>
+    void visit_range(const Storage& storage, const Index&, double lo, double hi, Fn&& fn) const {
+        const auto [better, worse] = grid_.side_bounds<S>(lo, hi);
+        side<S>().visit_range(storage, better, worse, fn);
+    }
+
+    template <Side S>
+    TreeBookSide<S>& side() {
+        if constexpr (S == Side::Buy) return bids_; else return asks_;
+    }
+    template <Side S>
+    const TreeBookSide<S>& side() const {
+        if constexpr (S == Side::Buy) return bids_; else return asks_;
+    }
+
+    const TickGrid& grid() const { return grid_; }
+
+    void clear() {
+        bids_.clear();
+        asks_.clear();
+    }
+
+    size_t level_count() const { return bids_.level_count() + asks_.level_count(); }
+};
+
+/**
+ * @brief One side of a LadderLevels book: dense levels over the price band
+ *
+ * Best-price tracking walks toward worse prices (down for bids, up for
+ * asks) through an occupancy bitmap, 64 ticks per word.
+ */
+template <Side S>
+class LadderBookSide {
+private:
+    // Headers and tallies in separate columns: a walk down from the touch
+    // reads four headers per cache line and no tallies
+    std::pmr::vector<PriceLevel> levels_;
+    std::pmr::vector<LevelTally> tallies_;
+    std::pmr::vector<uint64_t> bits_;  // Bit i set when levels_[i] is non-empty
+    int64_t best_ = -1;                // Index of the best occupied level, -1 if none
+
+    // Cumulative depth, indexed by distance from the better end of the
+    // ladder so prefix sums run from the touch: quantity per level, and
+    // quantity times the level's tick count (notional in ticks)
+    FenwickTree depth_;
+    FenwickTree notional_;
+    int64_t min_tick_;
+
+    QueueTrackers queues_;
+
+public:
+    LadderBookSide(size_t levels, int64_t min_tick, std::pmr::memory_resource* resource)
+        : levels_(levels, resource),
+          tallies_(levels, resource),
+          bits_((levels + 63) / 64, resource),
+          depth_(levels, resource),
+          notional_(levels, resource),
+          min_tick_(min_tick),
+          queues_(resource) {}
+
+    template <typename Storage>
+    void insert(Storage& storage, int64_t i, OrderHandle handle) {
+        level_append(storage, levels_[i], tallies_[i], handle);
+        queues_.on_append(storage, levels_[i], tallies_[i], handle);
+        set_bit(i);
+        if (best_ < 0 || SideTraits<S>::better(i, best_)) best_ = i;
+        add_depth(i, storage[handle].quantity);
+    }
+
+    // Remove n orders that all rest at level i: one depth update for the lot
+    template <typename Storage, typename Handles>
+    void erase(Storage& storage, int64_t i, const Handles& handles, size_t n) {
+        int64_t removed = 0;
+        for (size_t k = 0; k < n; ++k) {
+            removed += storage[handles[k]].quantity;
+            level_remove(storage, levels_[i], tallies_[i], handles[k]);
+            queues_.on_remove(tallies_[i], handles[k], storage[handles[k]].quantity);
+        }
+        add_depth(i, -removed);
+        if (levels_[i].empty()) {
+            clear_bit(i);
+            if (i == best_) best_ = at_or_worse(i);
+        }
+    }
+
+    // Partial fill of an order resting at level i
+    void reduce(int64_t i, OrderHandle handle, uint64_t quantity) {
+        levels_[i].quantity -= quantity;
+        add_depth(i, -static_cast<int64_t>(quantity));
+        queues_.on_fill(tallies_[i], handle, quantity);
+    }
+
+    // Quantity ahead of handle at level i; false if it could not be tracked
+    template <typename Storage>
+    bool queue_ahead(const Storage& storage, int64_t i, OrderHandle handle, uint64_t& ahead) {
+        return queues_.ahead(storage, levels_[i], tallies_[i], handle, ahead);
+    }
+
+    size_t tracked_levels() const { return queues_.tracked_levels(); }
+
+    // Quantity resting at level i or better, O(log L)
+    uint64_t depth_through(int64_t i) const {
+        return static_cast<uint64_t>(depth_.prefix(position(i)));
+    }
+
+    /**
+     * @brief Sweep quantity from the touch, O(log L)
+     * @param filled Receives the quantity available, at most quantity
+     * @param notional_ticks Receives the swept quantity times price in ticks
+     * @return Index of the worst level reached, -1 if the side is empty
+     */
+    int64_t sweep(uint64_t quantity, uint64_t& filled, int64_t& notional_ticks) const {
+        const int64_t total = depth_.prefix(static_cast<ptrdiff_t>(levels_.size()) - 1);
+        if (total == 0 || quantity == 0) {
+            filled = 0;
+            notional_ticks = 0;
+            return total == 0 ? -1 : best_;
+        }
+        const int64_t want = std::min<int64_t>(total, static_cast<int64_t>(quantity));
+        const ptrdiff_t pos = static_cast<ptrdiff_t>(depth_.lower_bound(want));
+        const int64_t i = index_at(pos);
+        // Everything better than the last level, then part of it
+        const int64_t before = depth_.prefix(pos - 1);
+        filled = static_cast<uint64_t>(want);
+        notional_ticks = notional_.prefix(pos - 1) + (want - before) * (min_tick_ + i);
+        return i;
+    }
+
+    // Occupied levels best to worst until fn(i, level, tally) returns false
+    template <typename Fn>
+    void visit_levels(Fn& fn) const {
+        for (int64_t i = best_; i >= 0; i = at_or_worse(worse(i))) {
+            if (!fn(i, levels_[i], tallies_[i])) return;
+        }
+    }
+
+    template <typename Storage, typename Fn>
+    void for_each(const Storage& storage, Fn& fn) const {
+        for (int64_t i = best_; i >= 0; i = at_or_worse(worse(i))) {
+            level_for_each(storage, levels_[i], fn);
+        }
+    }
+
+    // Best to worst until fn returns false
+    template <typename Storage, typename Fn>
+    void visit(const Storage& storage, Fn& fn) const {
+        for (int64_t i = best_; i >= 0; i = at_or_worse(worse(i))) {
+            if (!level_visit(storage, levels_[i], fn)) return;
+        }
+    }
+
+    // Levels from the better bound to the worse bound (indices, inclusive),
+    // jumping over empty ticks through the bitmap
+    template <typename Storage, typename Fn>
+    void visit_range(const Storage& storage, int64_t better, int64_t worse, Fn& fn) const {
+        if (best_ < 0) return;
+        // Nothing on the book is better than best_, so start no earlier
+        int64_t i = SideTraits<S>::better(better, best_) ? best_ : better;
+        for (i = at_or_worse(i); i >= 0 && !SideTraits<S>::better(worse, i);
+             i = at_or_worse(this->worse(i))) {
+            level_for_each(storage, levels_[i], fn);
+        }
+    }
+
+    bool has_best() const { return best_ >= 0; }
+    int64_t best_index() const { return best_; }
+    const PriceLevel& best_level() const { return levels_[best_]; }
+
+    size_t level_count() const {
+        size_t count = 0;
+        for (uint64_t word : bits_) count += __builtin_popcountll(word);
+        return count;
+    }
+
+    void clear() {
+        std::fill(levels_.begin(), levels_.end(), PriceLevel{});
+        std::fill(tallies_.begin(), tallies_.end(), LevelTally{});
+        std::fill(bits_.begin(), bits_.end(), 0);
+        best_ = -1;
+        depth_.clear();
+        notional_.clear();
+        queues_.clear();
+    }
+
+private:
+    // One tick toward the back of the book
+    static int64_t worse(int64_t i) { return S == Side::Buy ? i - 1 : i + 1; }
+
+    // Ladder index <-> Fenwick position (distance from the better end);
+    // indices past either end clamp to -1 (nothing) or the last position
+    ptrdiff_t position(int64_t i) const {
+        const int64_t last = static_cast<int64_t>(levels_.size()) - 1;
+        const int64_t pos = S == Side::Buy ? last - i : i;
+        return static_cast<ptrdiff_t>(std::clamp<int64_t>(pos, -1, last));
+    }
+    int64_t index_at(ptrdiff_t pos) const {
+        return S == Side::Buy ? static_cast<int64_t>(levels_.size()) - 1 - pos : pos;
+    }
+
+    void add_depth(int64_t i, int64_t quantity) {
+        const size_t pos = static_cast<size_t>(position(i));
+        depth_.add(pos, quantity);
+        notional_.add(pos, quantity * (min_tick_ + i));
+    }
+
+    void set_bit(int64_t i) { bits_[i >> 6] |= uint64_t{1} << (i & 63); }
+    void clear_bit(int64_t i) { bits_[i >> 6] &= ~(uint64_t{1} << (i & 63)); }
+
+    // First occupied level at i or worse, -1 if none
+    int64_t at_or_worse(int64_t i) const {
+        const int64_t words = static_cast<int64_t>(bits_.size());
+        if (i < 0 || i >= static_cast<int64_t>(levels_.size())) return -1;
+        int64_t word = i >> 6;
+        if constexpr (S == Side::Buy) {
+            uint64_t mask = bits_[word] & (~uint64_t{0} >> (63 - (i & 63)));
+            while (!mask) {
+                if (--word < 0) return -1;
+                mask = bits_[word];
+            }
+            return (word << 6) + 63 - __builtin_clzll(mask);
+        } else {
+            uint64_t mask = bits_[word] & (~uint64_t{0} << (i & 63));
+            while (!mask) {
+                if (++word >= words) return -1;
+                mask = bits_[word];
+            }
+            return (word << 6) + __builtin_ctzll(mask);
+        }
+    }
+};
+
+/**
+ * @brief Level policy: dense array of levels over a fixed price band
+ *
+ * For liquid instruments that trade in a narrow band (futures): the level
+ * for a price is one subtraction away, and an occupancy bitmap lets the
+ * best-price scan skip 64 empty ticks per word. Orders outside
+ * [min_price, min_price + levels * tick_size) are rejected.
+ */
+class LadderLevels {
+private:
+    TickGrid grid_;
+    int64_t min_tick_;
+    int64_t levels_;
+    LadderBookSide<Side::Buy> bids_;
+    LadderBookSide<Side::Sell> asks_;
+
+public:
+    static constexpr bool kSorted = true;
+    // Cumulative depth queries run on Fenwick trees in O(log L)
+    static constexpr bool kDepthIndex = true;
+
+    explicit LadderLevels(double min_price = 0.0, double tick_size = 0.01,
+                          size_t levels = 100000,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : grid_(tick_size),
+          min_tick_(grid_.to_ticks(min_price)),
+          levels_(static_cast<int64_t>(levels)),
+          bids_(levels, min_tick_, resource),
+          asks_(levels, min_tick_, resource) {}
+    explicit LadderLevels(std::pmr::memory_resource* resource)
+        : LadderLevels(0.0, 0.01, 100000, resource) {}
+
+    bool accepts(const Order& order) const {
+        if (!grid_.on_grid(order.price)) return false;
+        const int64_t index = index_of(order.price);
+        return index >= 0 && index < levels_;
+    }
+
+    // Never fails: every level is preallocated
+    template <Side S, typename Storage>
+    bool insert(Storage& storage, OrderHandle handle) {
+        side<S>().insert(storage, index_of(storage[handle].price), handle);
+        return true;
+    }
+
+    template <Side S>
+    bool prepare(double) { return true; }
+
+    template <Side S, typename Storage>
+    void erase(Storage& storage, OrderHandle handle) {
+        side<S>().erase(storage, index_of(storage[handle].price), &handle, 1);
+    }
+
+    // All n orders rest at one price; handles[i] yields an OrderHandle
+    template <Side S, typename Storage, typename Handles>
+    void erase_batch(Storage& storage, const Handles& handles, size_t n) {
+        side<S>().erase(storage, index_of(storage[handles[0]].price), handles, n);
+    }
+
+    template <Side S, typename Storage>
+    void reduce(Storage& storage, OrderHandle handle, uint32_t quantity) {
+        side<S>().reduce(index_of(storage[handle].price), handle, quantity);
+    }
+
+    // Ok, or BookFull if the level's queue tracker could not be allocated
+    template <Side S, typename Storage>
+    OrderStatus queue_ahead(const Storage& storage, OrderHandle handle, uint64_t& ahead) {
+        return side<S>().queue_ahead(storage, index_of(storage[handle].price), handle, ahead)
+            ? OrderStatus::Ok : OrderStatus::BookFull;
+    }
+
+    // Quantity resting at price or better on side S
+    template <Side S>
+    uint64_t depth_through(double price) const {
+        const int64_t ticks = S == Side::Buy ? grid_.ticks_ceil(price) : grid_.ticks_floor(price);
+        return side<S>().depth_through(ticks - min_tick_);
+    }
+
+    template <Side S>
+    SweepEstimate estimate_sweep(uint64_t quantity) const {
+        SweepEstimate estimate;
+        int64_t notional_ticks = 0;
+        const int64_t worst = side<S>().sweep(quantity, estimate.filled, notional_ticks);
+        if (estimate.filled == 0) return estimate;
+        estimate.notional = grid_.to_price(notional_ticks);
+        estimate.worst_price = grid_.to_price(ticks_at(worst));
+        return estimate;
+    }
+
+    template <Side S, typename Storage, typename Index, typename Fn>
+    void visit_levels(const Storage&, const Index&, Fn&& fn) const {
+        auto at_price = [&](int64_t i, const PriceLevel& level, const LevelTally& tally) {
+            return fn(LevelQuote{grid_.to_price(ticks_at(i)), level.quantity, tally.count});
+        };
+        side<S>().visit_levels(at_price);
+    }
+
+    template <typename Storage, typename Index, typename Fn>
+    void for_each_sorted(const Storage& storage, const Index&, Fn&& fn) const {
+        bids_.for_each(storage, fn);
+        asks_.for_each(storage, fn);
+    }
+
+    template <Side S, typename Storage, typename Index, typename Fn>
+    void visit_from_best(const Storage& storage, const Index&, Fn&& fn) const {
+        side<S>().visit(storage, fn);
+    }
+
+    template <Side S, typename Storage, typename Index, typename Fn>
+    void visit_range(const Storage& storage, const Index&, double lo, double hi, Fn&& fn) const {
+        const auto [better, worse] = grid_.side_bounds<S>(lo, hi);
+        side<S>().visit_range(storage, better - min_tick_, worse - min_tick_, fn);
+    }
+
+    template <Side S>
+    LadderBookSide<S>& side() {
+        if constexpr (S == Side::Buy) return bids_; else return asks_;
+    }
+    template <Side S>
+    const LadderBookSide<S>& side() const {
+        if constexpr (S == Side::Buy) return bids_; else return asks_;
+    }
+
+    const TickGrid& grid() const { return grid_; }
+    int64_t index_of(double price) const { return grid_.to_ticks(price) - min_tick_; }
+    int64_t ticks_at(int64_t index) const { return min_tick_ + index; }
+
+    void clear() {
+        bids_.clear();
+        asks_.clear();
+    }
+
+    size_t level_count() const { return bids_.level_count() + asks_.level_count(); }
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "order.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A sort key with its payload (an Order pointer or index)
+ */
+template <typename T>
+struct KeyedItem {
+    uint64_t key;
+    T value;
+};
+
+/**
+ * @brief Maps a price onto an unsigned key in snapshot order for side S
+ *
+ * IEEE doubles compare like sign-magnitude integers: flipping the sign bit
+ * of non-negatives and every bit of negatives makes them compare as
+ * unsigned. Bids are inverted so the best (highest) price sorts first.
+ */
+template <Side S>
+inline uint64_t snapshot_key(double price) {
+    uint64_t bits;
+    std::memcpy(&bits, &price, sizeof(bits));
+    const uint64_t ascending = (bits >> 63) ? ~bits : bits | (uint64_t{1} << 63);
+    return S == Side::Buy ? ~ascending : ascending;
+}
+
+namespace radix_detail {
+
+// Above this many items the sort splits on its top byte across threads
+constexpr size_t kParallelThreshold = size_t{1} << 20;
+constexpr unsigned kMaxThreads = 8;
+
+// Digit width of the LSD passes: 2048 counters (8 KB) stay in L1
+constexpr unsigned kDigitBits = 11;
+constexpr size_t kDigits = size_t{1} << kDigitBits;
+
+// Bits in which at least two keys differ; only those are sorted on
+template <typename Item>
+uint64_t varying_bits(const Item* data, size_t n) {
+    uint64_t diff = 0;
+    for (size_t i = 1; i < n; ++i) diff |= data[i].key ^ data[0].key;
+    return diff;
+}
+
+// Stable LSD sort of data on key bits [lo, hi); result ends in data. All
+// digit histograms are gathered in one read pass up front.
+template <typename Item>
+void lsd_sort(Item* data, Item* scratch, size_t n, unsigned lo, unsigned hi) {
+    if (hi <= lo || n < 2) return;
+    const unsigned passes = (hi - lo + kDigitBits - 1) / kDigitBits;
+    std::vector<size_t> counts(passes * kDigits, 0);
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t key = data[i].key >> lo;
+        for (unsigned p = 0; p < passes; ++p) {
+            counts[p * kDigits + ((key >> (p * kDigitBits)) & (kDigits - 1))]++;
+        }
+    }
+
+    Item* src = data;
+    Item* dst = scratch;
+    for (unsigned p = 0; p < passes; ++p) {
+        size_t* count = &counts[p * kDigits];
+        const unsigned shift = lo + p * kDigitBits;
+        size_t offset = 0;
+        for (size_t d = 0; d < kDigits; ++d) {
+            const size_t bucket = count[d];
+            count[d] = offset;
+            offset += bucket;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            dst[count[(src[i].key >> shift) & (kDigits - 1)]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if (src != data) std::copy(src, src + n, data);
+}
+
+// One MSD pass on the top 8 varying bits, spread over threads, then each
+// bucket finished with an LSD sort on the bits below them
+template <typename Item>
+void parallel_sort(Item* data, Item* scratch, size_t n, unsigned lo, unsigned hi,
+                   unsigned threads) {
+    const unsigned shift = hi > lo + 8 ? hi - 8 : lo;
+    auto bucket_of = [shift](const Item& item) { return (item.key >> shift) & 0xFF; };
+
+    const size_t chunk = (n + threads - 1) / threads;
+    std::vector<std::vector<size_t>> offsets(threads, std::vector<size_t>(256, 0));
+    auto run = [threads](auto&& fn) {
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(fn, t);
+        fn(0u);
+        for (std::thread& thread : pool) thread.join();
+    };
+
+    // Per-thread histograms of the top digit
+    run([&](unsigned t) {
+        const size_t end = std::min(n, (t + 1) * chunk);
+        for (size_t i = t * chunk; i < end; ++i) offsets[t][bucket_of(data[i])]++;
+    });
+
+    // Bucket b, thread t writes after all of bucket b from threads < t
+    size_t bucket_start[257];
+    size_t offset = 0;
+    for (size_t b = 0; b < 256; ++b) {
+        bucket_start[b] = offset;
+        for (unsigned t = 0; t < threads; ++t) {
+            const size_t count = offsets[t][b];
+            offsets[t][b] = offset;
+            offset += count;
+        }
+    }
+    bucket_start[256] = n;
+
+    run([&](unsigned t) {
+        const size_t end = std::min(n, (t + 1) * chunk);
+        for (size_t i = t * chunk; i < end; ++i) {
+            scratch[offsets[t][bucket_of(data[i])]++] = data[i];
+        }
+    });
+
+    // Buckets are handed out dynamically: their sizes can be very uneven
+    std::atomic<size_t> next_bucket{0};
+    run([&](unsigned) {
+        for (size_t b; (b = next_bucket.fetch_add(1)) < 256;) {
+            const size_t begin = bucket_start[b];
+            const size_t size = bucket_start[b + 1] - begin;
+            lsd_sort(scratch + begin, data + begin, size, lo, shift);
+            std::copy(scratch + begin, scratch + begin + size, data + begin);
+        }
+    });
+}
+
+}  // namespace radix_detail
+
+/**
+ * @brief Stable ascending sort of items by key
+ *
+ * LSD radix sort, 11 bits per pass, over only the span of key bits that
+ * differ between items (a price band fixes the sign and exponent bits).
+ * Books past kParallelThreshold items are split across up to kMaxThreads
+ * threads.
+ * @param scratch Reused between calls; grown to items.size()
+ */
+template <typename Items>
+void radix_sort(Items& items, Items& scratch) {
+    const size_t n = items.size();
+    if (n < 2) return;
+    if (scratch.size() < n) scratch.resize(n);
+
+    const uint64_t mask = radix_detail::varying_bits(items.data(), n);
+    if (mask == 0) return;
+    const unsigned lo = __builtin_ctzll(mask);
+    const unsigned hi = 64 - __builtin_clzll(mask);
+
+    const unsigned threads = std::min(radix_detail::kMaxThreads,
+                                      std::max(1u, std::thread::hardware_concurrency()));
+    if (n >= radix_detail::kParallelThreshold && threads > 1) {
+        radix_detail::parallel_sort(items.data(), scratch.data(), n, lo, hi, threads);
+    } else {
+        radix_detail::lsd_sort(items.data(), scratch.data(), n, lo, hi);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "order.hpp"
+#include "order_manager.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Writes book snapshots to files on a background thread
+ *
+ * The engine thread only pays for capture_snapshot(): one pass copying the
+ * live orders into a recycled buffer. Sorting, formatting and file I/O run
+ * on the writer's own thread, against that point-in-time copy.
+ *
+ * Performance considerations:
+ * - Capture buffers are recycled, so steady-state requests do not allocate
+ * - A request for a file that is still queued replaces the queued copy
+ *   (counted as superseded), so requests at any rate never build a backlog
+ * - The engine only takes the queue lock for a few pointer swaps
+ */
+class SnapshotWriter {
+public:
+    SnapshotWriter();
+
+    /**
+     * @brief Writes every queued snapshot, then stops the thread
+     */
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    /**
+     * @brief Capture book now and write it to filename in the background
+     * @param book Any BasicOrderManager; only read during this call
+     */
+    template <typename Book>
+    void request(const Book& book, const std::string& filename,
+                 SnapshotFormat format = SnapshotFormat::Text) {
+        std::vector<Order> orders = take_buffer();
+        book.capture_snapshot(orders);
+        submit(std::move(orders), Book::kSortedSnapshot, filename, format);
+    }
+
+    /**
+     * @brief Queue an already captured set of orders
+     * @param sorted Whether orders are already in snapshot order
+     */
+    void submit(std::vector<Order> orders, bool sorted, const std::string& filename,
+                SnapshotFormat format = SnapshotFormat::Text);
+
+    /**
+     * @brief Block until every queued snapshot has been written
+     */
+    void flush();
+
+    uint64_t written() const;
+    uint64_t superseded() const;
+    uint64_t failed() const;
+
+private:
+    struct Job {
+        std::string filename;
+        std::vector<Order> orders;
+        bool sorted;
+        SnapshotFormat format;
+    };
+
+    std::vector<Order> take_buffer();
+    void run();
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;   // Worker: a job arrived or stop requested
+    std::condition_variable idle_;   // flush(): queue drained
+    std::deque<Job> pending_;
+    std::vector<std::vector<Order>> spare_;  // Recycled capture buffers
+    bool busy_ = false;
+    bool stopping_ = false;
+    uint64_t written_ = 0;
+    uint64_t superseded_ = 0;
+    uint64_t failed_ = 0;
+
+    // Declared last: starts only once the state above is constructed
+    std::thread worker_;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "order.hpp"
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * @brief 64-bit finalizer (splitmix64): every input bit reaches every output bit
+ */
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * @brief Hash of one resting order: ID, price bits, open quantity and side
+ */
+inline uint64_t order_mix(const Order& order) {
+    uint64_t price_bits;
+    std::memcpy(&price_bits, &order.price, sizeof(price_bits));
+    uint64_t h = mix64(order.id);
+    h = mix64(h ^ price_bits);
+    return mix64(h ^ ((uint64_t{order.quantity} << 1) | order.side));
+}
+
+/**
+ * @brief Rolling hash of the set of resting orders, with a sequence number
+ *
+ * The hash is the wrapping sum of order_mix over the resting orders, so it
+ * does not depend on insertion order, container layout or the backend:
+ * two books holding the same orders hash the same. Each mutation adjusts
+ * it in O(1) and advances the sequence by one. An optional trail keeps the
+ * hash after each of the last N mutations, so a replica can compare
+ * against a primary at any recent sequence number.
+ */
+class BookHash {
+private:
+    uint64_t value_ = 0;
+    uint64_t sequence_ = 0;
+    std::pmr::vector<uint64_t> trail_;  // Ring: hash after sequence s at s % size
+    uint64_t trail_start_ = 0;          // First sequence the trail holds
+
+    void record() {
+        sequence_++;
+        if (!trail_.empty()) trail_[sequence_ % trail_.size()] = value_;
+    }
+
+public:
+    explicit BookHash(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : trail_(resource) {}
+
+    void on_add(const Order& order) {
+        value_ += order_mix(order);
+        record();
+    }
+
+    void on_remove(const Order& order) {
+        value_ -= order_mix(order);
+        record();
+    }
+
+    // The order's quantity changed from quantity_before to what it holds now
+    void on_reduce(const Order& order, uint32_t quantity_before) {
+        Order before = order;
+        before.quantity = quantity_before;
+        value_ += order_mix(order) - order_mix(before);
+        record();
+    }
+
+    // The order now reads as replacement (a modify): one mutation
+    void on_replace(const Order& before, const Order& replacement) {
+        value_ += order_mix(replacement) - order_mix(before);
+        record();
+    }
+
+    // The whole book was emptied: one mutation
+    void on_clear() {
+        value_ = 0;
+        record();
+    }
+
+    uint64_t value() const { return value_; }
+    uint64_t sequence() const { return sequence_; }
+
+    /**
+     * @brief Keep the hash after each of the last capacity mutations
+     * Resizing forgets the trail recorded so far; 0 turns it off.
+     */
+    void set_trail(size_t capacity) {
+        trail_.assign(capacity, 0);
+        trail_start_ = sequence_;
+        if (capacity) trail_[sequence_ % capacity] = value_;
+    }
+
+    /**
+     * @brief Hash of the book right after mutation number sequence
+     * @return false if sequence is in the future or has left the trail
+     */
+    bool value_at(uint64_t sequence, uint64_t& hash) const {
+        if (sequence == sequence_) {
+            hash = value_;
+            return true;
+        }
+        if (sequence > sequence_ || trail_.empty() || sequence < trail_start_ ||
+            sequence_ - sequence >= trail_.size()) {
+            return false;
+        }
+        hash = trail_[sequence % trail_.size()];
+        return true;
+    }
+};
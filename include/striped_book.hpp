@@ -0,0 +1,372 @@
+#pragma once
+
+#include "flat_hash_map.hpp"
+#include "order.hpp"
+#include "order_status.hpp"
+#include "order_storage.hpp"
+#include "price_levels.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>  // std::lock_guard
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Test-and-test-and-set lock for short critical sections
+ *
+ * lock() cannot fail, unlike std::mutex::lock, so noexcept writers can
+ * take it. A waiter spins on a plain load and yields every few rounds, so
+ * it still makes progress when there are more threads than cores.
+ */
+class SpinLock {
+private:
+    std::atomic<bool> locked_{false};
+
+public:
+    void lock() noexcept {
+        for (unsigned spins = 0; locked_.exchange(true, std::memory_order_acquire);) {
+            while (locked_.load(std::memory_order_relaxed)) {
+                if (++spins % 16 == 0) std::this_thread::yield();
+            }
+        }
+    }
+
+    void unlock() noexcept { locked_.store(false, std::memory_order_release); }
+};
+
+/**
+ * @brief A book several threads may write at once
+ *
+ * IDs are striped: an ID always maps to the same stripe, which holds a
+ * spin lock, the book's only ID -> handle index and its own PooledStorage
+ * for the records of its IDs. Lookup, duplicate check, record allocation
+ * and release all run under that stripe's lock alone, so writers on
+ * different stripes never wait for each other there.
+ *
+ * The price levels are one Levels policy whose bid and ask sides each
+ * have a spin lock. A side lock is held only around the level insert,
+ * unlink or reduce itself; two writers contend only while both touch the
+ * levels of one side. Locks are always taken stripe first, then side.
+ *
+ * Levels follow handles into every stripe's records: a handle carries its
+ * stripe in the low bits, and each stripe's chunk directory is sized up
+ * front (max_orders), so those reads never race with a stripe adding
+ * chunks. Once linked, an order's fields change only under its side lock.
+ *
+ * Uncontended, each write takes two locks (stripe, then side) where a
+ * mutex-wrapped book takes one, and each record read decodes its stripe
+ * first, so a single writer runs somewhat slower than under one global
+ * mutex. The striping only pays once writers run on several cores.
+ *
+ * Plain limit orders only: accounts, expiries and risk checks need
+ * book-wide state, which belongs in a single-writer BasicOrderManager.
+ * Levels must be sorted (TreeLevels, LadderLevels).
+ */
+template <typename Levels>
+class StripedBook {
+    static_assert(Levels::kSorted, "a striped book keeps price order for its level queries");
+
+private:
+    static constexpr uint32_t kMaxStripeBits = 10;
+
+    struct alignas(64) Stripe {
+        mutable SpinLock lock;
+        FlatHashMap<OrderHandle> ids;
+        PooledStorage storage;
+
+        explicit Stripe(std::pmr::memory_resource* resource) : ids(resource), storage(resource) {}
+    };
+
+    struct alignas(64) SideState {
+        mutable SpinLock lock;
+        uint64_t quantity = 0;
+        uint64_t orders = 0;
+    };
+
+    // The levels' view of every stripe's records: handle = local << bits | stripe
+    class Records {
+    private:
+        const std::unique_ptr<Stripe>* stripes_;
+        uint32_t mask_;
+        uint32_t bits_;
+
+    public:
+        Records(const std::unique_ptr<Stripe>* stripes, uint32_t bits)
+            : stripes_(stripes), mask_((1u << bits) - 1), bits_(bits) {}
+
+        Order& operator[](OrderHandle handle) const {
+            return stripes_[handle & mask_]->storage[handle >> bits_];
+        }
+        OrderLinks& links(OrderHandle handle) const {
+            return stripes_[handle & mask_]->storage.links(handle >> bits_);
+        }
+    };
+
+    std::vector<std::unique_ptr<Stripe>> stripes_;
+    uint32_t stripe_bits_ = 0;
+    Records records_;
+    Levels levels_;
+    SideState sides_[2];
+
+    uint32_t stripe_index(uint64_t id) const {
+        // Full murmur3 fmix64: sequential IDs spread over every stripe. The
+        // top bits pick it, as each stripe's FlatHashMap takes its home
+        // slots from the low bits of the first round alone; sharing those
+        // would crowd a stripe's keys onto 1/stripe_count of its homes
+        if (stripe_bits_ == 0) return 0;
+        id ^= id >> 33;
+        id *= 0xff51afd7ed558ccdull;
+        id ^= id >> 33;
+        id *= 0xc4ceb9fe1a85ec53ull;
+        id ^= id >> 33;
+        return static_cast<uint32_t>(id >> (64 - stripe_bits_));
+    }
+
+    OrderHandle local(OrderHandle handle) const { return handle >> stripe_bits_; }
+
+    template <Side S>
+    SideState& side() { return sides_[static_cast<size_t>(S)]; }
+    const SideState& side(Side s) const { return sides_[static_cast<size_t>(s)]; }
+
+    // Link a freshly stored record into its level; false if the level could not grow
+    template <Side S>
+    bool link(OrderHandle handle) {
+        SideState& state = side<S>();
+        std::lock_guard<SpinLock> side_lock(state.lock);
+        if (!levels_.template insert<S>(records_, handle)) return false;
+        state.quantity += records_[handle].quantity;
+        state.orders++;
+        return true;
+    }
+
+    // Unlink a resting order and free its record; the ID is already gone
+    template <Side S>
+    void remove(Stripe& stripe, OrderHandle handle) {
+        {
+            SideState& state = side<S>();
+            std::lock_guard<SpinLock> side_lock(state.lock);
+            state.quantity -= records_[handle].quantity;
+            state.orders--;
+            levels_.template erase<S>(records_, handle);
+        }
+        stripe.storage.release(local(handle));
+    }
+
+    template <Side S>
+    void reduce(OrderHandle handle, uint32_t quantity) {
+        SideState& state = side<S>();
+        std::lock_guard<SpinLock> side_lock(state.lock);
+        levels_.template reduce<S>(records_, handle, quantity);
+        records_[handle].quantity -= quantity;
+        state.quantity -= quantity;
+    }
+
+    // New price or a larger quantity: to the back of the new level
+    template <Side S>
+    OrderStatus replace(OrderHandle handle, double price, uint32_t quantity) {
+        SideState& state = side<S>();
+        std::lock_guard<SpinLock> side_lock(state.lock);
+        if (!levels_.template prepare<S>(price)) return OrderStatus::BookFull;
+        Order& order = records_[handle];
+        levels_.template erase<S>(records_, handle);
+        state.quantity -= order.quantity;
+        order.price = price;
+        order.quantity = quantity;
+        levels_.template insert<S>(records_, handle);  // Prepared above
+        state.quantity += quantity;
+        return OrderStatus::Ok;
+    }
+
+public:
+    static constexpr size_t kDefaultMaxOrders = size_t{1} << 24;
+
+    /**
+     * @param stripes Rounded up to a power of two (at most 1024); a few
+     *        times the number of writer threads keeps two writers off one
+     *        stripe
+     * @param max_orders Capacity, split over the stripes with a quarter
+     *        of headroom each since IDs spread only statistically; the
+     *        chunk directories for it are allocated here, and a stripe
+     *        whose directory cannot be reports BookFull on every add
+     */
+    explicit StripedBook(Levels levels, size_t stripes = 64, size_t max_orders = kDefaultMaxOrders,
+                         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : records_(nullptr, 0), levels_(std::move(levels)) {
+        while (stripe_bits_ < kMaxStripeBits && (size_t{1} << stripe_bits_) < stripes) stripe_bits_++;
+        const size_t count = size_t{1} << stripe_bits_;
+        // Local handles stop short of the top so no encoded handle is kNullHandle
+        const size_t handle_space = (size_t{1} << (32 - stripe_bits_)) - 1;
+        const size_t per_stripe = std::min(max_orders / count + max_orders / (4 * count) + 1, handle_space);
+        stripes_.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            stripes_.push_back(std::make_unique<Stripe>(resource));
+            if (!stripes_.back()->storage.set_max_orders(per_stripe)) {
+                stripes_.back()->storage.set_max_orders(0);
+            }
+        }
+        records_ = Records(stripes_.data(), stripe_bits_);
+    }
+    explicit StripedBook(size_t stripes = 64, size_t max_orders = kDefaultMaxOrders,
+                         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : StripedBook(Levels(resource), stripes, max_orders, resource) {}
+
+    StripedBook(const StripedBook&) = delete;
+    StripedBook& operator=(const StripedBook&) = delete;
+
+    /**
+     * @brief Add an order; safe from any thread
+     * @return Ok, Duplicate if the ID is live, InvalidPrice, or BookFull
+     *         if the stripe or the level could not grow
+     */
+    OrderStatus try_add_order(const Order& order) noexcept {
+        if (!levels_.accepts(order)) return OrderStatus::InvalidPrice;
+        const uint32_t index = stripe_index(order.id);
+        Stripe& stripe = *stripes_[index];
+        std::lock_guard<SpinLock> stripe_lock(stripe.lock);
+        auto [slot, inserted] = stripe.ids.insert(order.id, kNullHandle);
+        if (!inserted) return slot ? OrderStatus::Duplicate : OrderStatus::BookFull;
+        const OrderHandle stored = stripe.storage.allocate(order);
+        if (stored == kNullHandle) {
+            stripe.ids.erase(order.id);
+            return OrderStatus::BookFull;
+        }
+        const OrderHandle handle = stored << stripe_bits_ | index;
+        *slot = handle;
+        const bool linked = order.is_buy() ? link<Side::Buy>(handle) : link<Side::Sell>(handle);
+        if (!linked) {
+            stripe.storage.release(stored);
+            stripe.ids.erase(order.id);
+            return OrderStatus::BookFull;
+        }
+        return OrderStatus::Ok;
+    }
+
+    OrderStatus try_cancel_order(uint64_t order_id) noexcept {
+        Stripe& stripe = *stripes_[stripe_index(order_id)];
+        std::lock_guard<SpinLock> stripe_lock(stripe.lock);
+        OrderHandle handle;
+        if (!stripe.ids.take(order_id, handle)) return OrderStatus::UnknownId;
+        // The side never changes while the order rests, and only this stripe writes it
+        if (records_[handle].is_buy()) remove<Side::Buy>(stripe, handle);
+        else remove<Side::Sell>(stripe, handle);
+        return OrderStatus::Ok;
+    }
+
+    OrderStatus try_execute_order(uint64_t order_id, uint32_t quantity) noexcept {
+        Stripe& stripe = *stripes_[stripe_index(order_id)];
+        std::lock_guard<SpinLock> stripe_lock(stripe.lock);
+        const OrderHandle* found = stripe.ids.find(order_id);
+        if (!found) return OrderStatus::UnknownId;
+        const OrderHandle handle = *found;
+        const bool buy = records_[handle].is_buy();
+        if (quantity >= records_[handle].quantity) {
+            // Filled in full: leaves the book like a cancel
+            stripe.ids.erase(order_id);
+            if (buy) remove<Side::Buy>(stripe, handle); else remove<Side::Sell>(stripe, handle);
+        } else {
+            if (buy) reduce<Side::Buy>(handle, quantity); else reduce<Side::Sell>(handle, quantity);
+        }
+        return OrderStatus::Ok;
+    }
+
+    /**
+     * @brief Change price and quantity; shrinking in place keeps priority
+     * @return Ok, UnknownId, InvalidPrice, or BookFull if a new level
+     *         could not be allocated (the order is unchanged). A quantity
+     *         of 0 cancels.
+     */
+    OrderStatus try_modify_order(uint64_t order_id, double new_price, uint32_t new_quantity) noexcept {
+        if (new_quantity == 0) return try_cancel_order(order_id);
+        Stripe& stripe = *stripes_[stripe_index(order_id)];
+        std::lock_guard<SpinLock> stripe_lock(stripe.lock);
+        const OrderHandle* found = stripe.ids.find(order_id);
+        if (!found) return OrderStatus::UnknownId;
+        const OrderHandle handle = *found;
+        Order replacement = records_[handle];
+        const bool buy = replacement.is_buy();
+        if (new_price == replacement.price && new_quantity <= replacement.quantity) {
+            const uint32_t reduction = replacement.quantity - new_quantity;
+            if (reduction > 0) {
+                if (buy) reduce<Side::Buy>(handle, reduction); else reduce<Side::Sell>(handle, reduction);
+            }
+            return OrderStatus::Ok;
+        }
+        replacement.price = new_price;
+        if (!levels_.accepts(replacement)) return OrderStatus::InvalidPrice;
+        return buy ? replace<Side::Buy>(handle, new_price, new_quantity)
+                   : replace<Side::Sell>(handle, new_price, new_quantity);
+    }
+
+    /**
+     * @brief Copy of a resting order; takes only its stripe's lock
+     * @return false if no order rests under order_id
+     */
+    bool get_order(uint64_t order_id, Order& out) const noexcept {
+        const Stripe& stripe = *stripes_[stripe_index(order_id)];
+        std::lock_guard<SpinLock> stripe_lock(stripe.lock);
+        const OrderHandle* found = stripe.ids.find(order_id);
+        if (found) out = records_[*found];
+        return found != nullptr;
+    }
+
+    /**
+     * @brief Visit the price levels of side best to worst until fn returns false
+     * Runs under the side's lock: writers to that side wait, so keep fn short.
+     */
+    template <typename Fn>
+    void visit_levels(Side s, Fn&& fn) const {
+        std::lock_guard<SpinLock> side_lock(side(s).lock);
+        // Sorted policies walk their own levels and take no index
+        if (s == Side::Buy) levels_.template visit_levels<Side::Buy>(records_, records_, fn);
+        else levels_.template visit_levels<Side::Sell>(records_, records_, fn);
+    }
+
+    LevelQuote best_quote(Side s) const {
+        LevelQuote quote;
+        visit_levels(s, [&quote](const LevelQuote& level) {
+            quote = level;
+            return false;
+        });
+        return quote;
+    }
+
+    uint64_t side_quantity(Side s) const {
+        std::lock_guard<SpinLock> side_lock(side(s).lock);
+        return side(s).quantity;
+    }
+
+    uint64_t side_orders(Side s) const {
+        std::lock_guard<SpinLock> side_lock(side(s).lock);
+        return side(s).orders;
+    }
+
+    size_t size() const { return side_orders(Side::Buy) + side_orders(Side::Sell); }
+    size_t stripe_count() const { return stripes_.size(); }
+
+    // Ok, or BookFull if an index or storage chunk could not be allocated
+    OrderStatus reserve(size_t expected_orders) {
+        const size_t per_stripe = expected_orders / stripe_count() + expected_orders / (4 * stripe_count()) + 16;
+        for (const std::unique_ptr<Stripe>& stripe : stripes_) {
+            std::lock_guard<SpinLock> stripe_lock(stripe->lock);
+            if (!stripe->ids.reserve(per_stripe) || !stripe->storage.reserve(per_stripe)) {
+                return OrderStatus::BookFull;
+            }
+        }
+        return OrderStatus::Ok;
+    }
+
+    // Not safe against concurrent writers: call between runs
+    void clear() {
+        for (const std::unique_ptr<Stripe>& stripe : stripes_) {
+            stripe->ids.clear();
+            stripe->storage.clear();
+        }
+        levels_.clear();
+        sides_[0].quantity = sides_[0].orders = 0;
+        sides_[1].quantity = sides_[1].orders = 0;
+    }
+};
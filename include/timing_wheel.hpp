@@ -0,0 +1,169 @@
+#pragma once
+
+#include "order_storage.hpp"
+#include "try_allocate.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * @brief A point on the caller's clock (any unit); kNoExpiry for "never"
+ */
+using Timestamp = uint64_t;
+constexpr Timestamp kNoExpiry = 0;
+
+/**
+ * @brief Hierarchical timing wheel of order expiries
+ *
+ * Levels of 64 slots cover the whole 64-bit clock. Level k holds the timers
+ * that fall in the current level-(k+1) span but past the current level-k
+ * one, in slot (deadline >> 6k) & 63, so every level-k timer is due before
+ * any level-(k+1) timer. Timers are intrusive lists in a cold column indexed
+ * by order handle: scheduling and cancelling are O(1).
+ *
+ * Advancing the clock jumps to the next occupied slot through a per-level
+ * bitmap. Level-0 slots expire; higher slots cascade their timers down,
+ * at most once per level per timer. The cost follows the due timers, not
+ * the idle time skipped or the number of timers pending.
+ */
+class TimingWheel {
+public:
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr unsigned kSlots = 1u << kSlotBits;
+    static constexpr unsigned kLevels = (64 + kSlotBits - 1) / kSlotBits;
+
+private:
+    struct Link {
+        Timestamp deadline = kNoExpiry;
+        OrderHandle prev = kNullHandle;
+        OrderHandle next = kNullHandle;
+    };
+
+    std::pmr::vector<Link> links_;     // By handle
+    OrderHandle heads_[kLevels][kSlots];
+    uint64_t occupied_[kLevels] = {};  // Bit s set while slot s is non-empty
+    Timestamp now_ = 0;
+    size_t size_ = 0;
+
+    // Highest 6-bit digit in which deadline and the clock differ
+    static unsigned level_of(Timestamp deadline, Timestamp now) {
+        return (63 - __builtin_clzll(deadline ^ now)) / kSlotBits;
+    }
+
+    static unsigned slot_of(Timestamp deadline, unsigned level) {
+        return static_cast<unsigned>(deadline >> (level * kSlotBits)) & (kSlots - 1);
+    }
+
+    // Clock bits below the digit above level
+    static Timestamp span_mask(unsigned level) {
+        const unsigned bits = (level + 1) * kSlotBits;
+        return bits >= 64 ? ~Timestamp{0} : (Timestamp{1} << bits) - 1;
+    }
+
+    void push(OrderHandle handle, Timestamp deadline) {
+        const unsigned level = level_of(deadline, now_);
+        const unsigned slot = slot_of(deadline, level);
+        OrderHandle& head = heads_[level][slot];
+        links_[handle] = Link{deadline, kNullHandle, head};
+        if (head != kNullHandle) links_[head].prev = handle;
+        head = handle;
+        occupied_[level] |= uint64_t{1} << slot;
+    }
+
+    void unlink(OrderHandle handle, unsigned level, unsigned slot) {
+        Link& link = links_[handle];
+        OrderHandle& head = heads_[level][slot];
+        if (link.prev != kNullHandle) links_[link.prev].next = link.next;
+        else head = link.next;
+        if (link.next != kNullHandle) links_[link.next].prev = link.prev;
+        if (head == kNullHandle) occupied_[level] &= ~(uint64_t{1} << slot);
+        link = Link{};
+    }
+
+public:
+    explicit TimingWheel(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : links_(resource) {
+        std::fill(&heads_[0][0], &heads_[0][0] + kLevels * kSlots, kNullHandle);
+    }
+
+    /**
+     * @brief Arm handle's timer for deadline
+     * @return false if deadline is not after now(), or the timer column
+     *         could not grow
+     */
+    bool schedule(OrderHandle handle, Timestamp deadline) {
+        if (deadline <= now_) return false;
+        if (handle >= links_.size() &&
+            !try_allocate([&] { links_.resize(std::max<size_t>(handle + 1, links_.size() * 2)); })) {
+            return false;
+        }
+        push(handle, deadline);
+        size_++;
+        return true;
+    }
+
+    // Called for every order leaving the book; a no-op without a timer
+    void cancel(OrderHandle handle) {
+        if (handle >= links_.size() || links_[handle].deadline == kNoExpiry) return;
+        const Timestamp deadline = links_[handle].deadline;
+        const unsigned level = level_of(deadline, now_);
+        unlink(handle, level, slot_of(deadline, level));
+        size_--;
+    }
+
+    Timestamp deadline(OrderHandle handle) const {
+        return handle < links_.size() ? links_[handle].deadline : kNoExpiry;
+    }
+
+    /**
+     * @brief Move the clock to target, calling fn(handle) for each timer due
+     *
+     * Timers fire in deadline order; a timer is disarmed before fn sees it.
+     * The clock never moves back: an earlier target is ignored.
+     * @return Number of timers fired
+     */
+    template <typename Fn>
+    size_t advance(Timestamp target, Fn&& fn) {
+        size_t fired = 0;
+        for (;;) {
+            unsigned level = 0;
+            while (level < kLevels && occupied_[level] == 0) ++level;
+            if (level == kLevels) break;
+
+            // The lowest occupied slot of the lowest level is due first
+            const unsigned slot = __builtin_ctzll(occupied_[level]);
+            const Timestamp start =
+                (now_ & ~span_mask(level)) | (Timestamp{slot} << (level * kSlotBits));
+            if (start > target) break;
+            now_ = start;
+
+            OrderHandle& head = heads_[level][slot];
+            while (head != kNullHandle) {
+                const OrderHandle handle = head;
+                const Timestamp deadline = links_[handle].deadline;
+                unlink(handle, level, slot);
+                if (deadline == now_) {
+                    size_--;
+                    fired++;
+                    fn(handle);
+                } else {
+                    push(handle, deadline);  // Cascades to a lower level
+                }
+            }
+        }
+        now_ = std::max(now_, target);
+        return fired;
+    }
+
+    Timestamp now() const { return now_; }
+    size_t size() const { return size_; }
+
+    // Disarm every timer; the clock keeps its time
+    void clear() {
+        links_.clear();
+        std::fill(&heads_[0][0], &heads_[0][0] + kLevels * kSlots, kNullHandle);
+        std::fill(occupied_, occupied_ + kLevels, 0);
+        size_ = 0;
+    }
+};
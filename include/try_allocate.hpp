@@ -0,0 +1,30 @@
+#pragma once
+
+/**
+ * @brief Run a step that may allocate from a path that must not throw
+ *
+ * The book's mutators are noexcept and report exhaustion as BookFull, but
+ * standard containers and memory resources report it by throwing. Each
+ * growing step is wrapped at the policy that owns the container, so a
+ * failure surfaces as a return value right where the book can still undo
+ * what it started. fn should leave its container unchanged when it throws
+ * (a single resize, reserve or push_back does).
+ *
+ * Built with -fno-exceptions there is nothing to catch: an allocation
+ * failure aborts inside the allocator, as the standard library does in
+ * that mode.
+ * @return false if fn threw
+ */
+template <typename Fn>
+bool try_allocate(Fn&& fn) noexcept {
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+    try {
+        fn();
+    } catch (...) {
+        return false;
+    }
+#else
+    fn();
+#endif
+    return true;
+}
@@ -2,6 +2,8 @@
 
 # Benchmark Script for Limit Order Manager
 # Runs comprehensive performance tests and generates reports
+#   ./scripts/bench.sh                 full suite against the current binary
+#   ./scripts/bench.sh --compare-pgo   build release and release-pgo, compare
 
 set -e  # Exit on any error
 
@@ -18,6 +20,9 @@ EXECUTABLE="limit_order_manager"
 DATA_DIR="data"
 RESULTS_DIR="results"
 LOG_FILE="benchmark.log"
+COMPARE_ORDERS=100000
+COMPARE_COMMANDS=2000000
+COMPARE_RUNS=5
 
 # Create results directory
 mkdir -p "$RESULTS_DIR"
@@ -52,6 +57,24 @@ run_benchmark() {
     fi
 }
 
+# Function to run every per-feature benchmark (bench all); named
+# benchmark_features_* so the report picks it up
+run_feature_benchmarks() {
+    local order_count="$1"
+    local output_file="$RESULTS_DIR/benchmark_features_${order_count}.txt"
+    
+    log "Running feature benchmarks with $order_count orders..."
+    
+    if timeout 600 "$BUILD_DIR/$EXECUTABLE" bench all "$order_count" > "$output_file" 2>&1; then
+        echo -e "${GREEN}✓${NC} feature benchmarks completed successfully"
+        log "feature benchmarks completed successfully"
+    else
+        echo -e "${RED}✗${NC} feature benchmarks failed or timed out"
+        log "feature benchmarks failed or timed out"
+        return 1
+    fi
+}
+
 # Function to check if executable exists
 check_executable() {
     if [[ ! -f "$BUILD_DIR/$EXECUTABLE" ]]; then
@@ -149,8 +172,85 @@ EOF
     log "Performance report generated"
 }
 
+# One benchmark run and one pipe replay of the given binary, appended to
+# the variant's raw output
+measure_variant() {
+    local variant="$1"
+    local binary="$2"
+    local raw="$RESULTS_DIR/pgo_compare_${variant}.txt"
+    "$binary" benchmark "$COMPARE_ORDERS" >> "$raw" 2>&1
+    "$binary" pipe < "$RESULTS_DIR/replay.txt" 2>> "$raw" >/dev/null
+}
+
+# Best time of each measurement in a variant's raw output: "<name>\t<value>"
+# lines, microseconds for benchmark timings, ns/command for the replay
+summarize_variant() {
+    local variant="$1"
+    awk '
+        / took [0-9]+ microseconds/ {
+            name = $0; sub(/ took.*/, "", name)
+            value = $(NF - 1)
+        }
+        /^Pipe: .* commands\/s/ {
+            name = "Pipe replay (ns/command)"
+            value = 1e9 / $(NF - 1)
+        }
+        name != "" {
+            if (!(name in best) || value < best[name]) best[name] = value
+            if (!(name in seen)) { seen[name] = 1; order[n++] = name }
+            name = ""
+        }
+        END { for (i = 0; i < n; i++) printf "%s\t%.1f\n", order[i], best[order[i]] }
+    ' "$RESULTS_DIR/pgo_compare_${variant}.txt" > "$RESULTS_DIR/pgo_compare_${variant}.tsv"
+}
+
+# Build plain release and release-pgo, then run them alternately so drift
+# in machine load hits both alike, and report the two side by side
+run_pgo_comparison() {
+    local report_file="$RESULTS_DIR/pgo_report.txt"
+    log "Comparing release against release-pgo..."
+    python3 scripts/gen_orders.py "$COMPARE_COMMANDS" --commands -o "$RESULTS_DIR/replay.txt" >/dev/null
+    
+    make clean >/dev/null && make release >/dev/null
+    cp "$BUILD_DIR/$EXECUTABLE" "$RESULTS_DIR/$EXECUTABLE.release"
+    make clean >/dev/null && make release-pgo >/dev/null 2>&1
+    cp "$BUILD_DIR/$EXECUTABLE" "$RESULTS_DIR/$EXECUTABLE.pgo"
+    
+    : > "$RESULTS_DIR/pgo_compare_release.txt"
+    : > "$RESULTS_DIR/pgo_compare_pgo.txt"
+    for run in $(seq 1 "$COMPARE_RUNS"); do
+        measure_variant release "$RESULTS_DIR/$EXECUTABLE.release"
+        measure_variant pgo "$RESULTS_DIR/$EXECUTABLE.pgo"
+    done
+    summarize_variant release
+    summarize_variant pgo
+    
+    {
+        echo "Limit Order Manager - release vs release-pgo"
+        echo "Generated: $(date)"
+        echo "Best of $COMPARE_RUNS runs; benchmark $COMPARE_ORDERS orders, replay $COMPARE_COMMANDS commands"
+        echo "========================================"
+        printf "%-50s %12s %12s %8s\n" "Measurement" "release" "pgo" "speedup"
+        awk -F '\t' '
+            NR == FNR { base[$1] = $2; next }
+            ($1 in base) && $2 > 0 {
+                printf "%-50s %12.1f %12.1f %7.2fx\n", $1, base[$1], $2, base[$1] / $2
+            }
+        ' "$RESULTS_DIR/pgo_compare_release.tsv" "$RESULTS_DIR/pgo_compare_pgo.tsv"
+    } > "$report_file"
+    
+    cat "$report_file"
+    echo -e "${GREEN}✓${NC} PGO comparison written to $report_file (binary left as release-pgo)"
+    log "PGO comparison completed"
+}
+
 # Main execution
 main() {
+    if [[ "$1" == "--compare-pgo" ]]; then
+        run_pgo_comparison
+        return
+    fi
+    
     echo "Starting benchmark suite at $(date)"
     log "Starting benchmark suite"
     
@@ -173,6 +273,9 @@ main() {
     run_benchmark "benchmark" 10000
     run_benchmark "benchmark" 100000
     
+    run_feature_benchmarks 10000
+    run_feature_benchmarks 100000
+    
     # Generate final report
     generate_report
     
@@ -1,7 +1,8 @@
 #!/usr/bin/env python3
 """
 Order Generator Script
-Generates large CSV files with random order data for performance testing.
+Generates large CSV files with random order data for performance testing,
+or command scripts for the CLI's pipe mode (--commands).
 """
 
 import csv
@@ -35,6 +36,70 @@ def generate_orders(count: int, price_range: Tuple[float, float] = (100.0, 200.0
     
     return orders
 
+def generate_commands(count: int, price_range: Tuple[float, float] = (100.0, 200.0),
+                      qty_range: Tuple[int, int] = (1, 1000)) -> List[str]:
+    """
+    Generate a pipe-mode command script shaped like a live feed.
+    
+    Order IDs are sequential. Roughly 60% of commands add, 25% cancel,
+    8% modify and 7% execute a resting order, so most orders are
+    short-lived while some stay on the book. Remaining quantities are
+    tracked, so an execute that fills an order in full retires its ID and
+    later commands only touch orders still resting. A `time` tick (nanoseconds)
+    before every 1000 commands advances the book clock by 1 ms, so a
+    replay can be seeked by time.
+    
+    Args:
+        count: Number of commands to generate
+        price_range: (min_price, max_price) tuple
+        qty_range: (min_qty, max_qty) tuple
+    
+    Returns:
+        List of command lines
+    """
+    commands = []
+    live = []
+    remaining = {}  # Resting quantity by live ID
+    next_id = 1
+    
+    for i in range(count):
+        if i % 1000 == 0:
+            commands.append(f"time {i * 1000}")
+        roll = random.random()
+        if roll < 0.60 or not live:
+            price = round(random.uniform(price_range[0], price_range[1]), 2)
+            quantity = random.randint(qty_range[0], qty_range[1])
+            commands.append(f"add {next_id} {price:.2f} {quantity} {random.randint(0, 1)}")
+            live.append(next_id)
+            remaining[next_id] = quantity
+            next_id += 1
+            continue
+        
+        # Recent orders are the likeliest to be touched
+        slot = len(live) - 1 - min(int(random.expovariate(0.05)), len(live) - 1)
+        order_id = live[slot]
+        if roll < 0.85:
+            commands.append(f"cancel {order_id}")
+            filled = True
+        elif roll < 0.93:
+            price = round(random.uniform(price_range[0], price_range[1]), 2)
+            quantity = random.randint(qty_range[0], qty_range[1])
+            commands.append(f"modify {order_id} {price:.2f} {quantity}")
+            remaining[order_id] = quantity
+            filled = False
+        else:
+            quantity = random.randint(qty_range[0], qty_range[1])
+            commands.append(f"execute {order_id} {quantity}")
+            # The book removes an order executed for all it has left
+            filled = quantity >= remaining[order_id]
+            remaining[order_id] -= min(quantity, remaining[order_id])
+        if filled:
+            del remaining[order_id]
+            live[slot] = live[-1]
+            live.pop()
+    
+    return commands
+
 def write_csv(filename: str, orders: List[Tuple[int, float, int, int]], 
               include_header: bool = True):
     """
@@ -69,6 +134,8 @@ def main():
                        help='Maximum quantity (default: 1000)')
     parser.add_argument('--no-header', action='store_true',
                        help='Skip CSV header row')
+    parser.add_argument('--commands', action='store_true',
+                       help='Write a pipe-mode command script of COUNT commands instead')
     
     args = parser.parse_args()
     
@@ -84,11 +151,23 @@ def main():
         print("Error: min_qty must be less than max_qty", file=sys.stderr)
         sys.exit(1)
     
-    print(f"Generating {args.count} orders...")
-    
     # Set random seed for reproducible results
     random.seed(42)
     
+    if args.commands:
+        print(f"Generating {args.count} commands...")
+        commands = generate_commands(
+            args.count,
+            price_range=(args.min_price, args.max_price),
+            qty_range=(args.min_qty, args.max_qty)
+        )
+        with open(args.output, 'w') as script:
+            script.write("\n".join(commands) + "\n")
+        print(f"Generated {len(commands)} commands in {args.output}")
+        return
+    
+    print(f"Generating {args.count} orders...")
+    
     # Generate orders
     orders = generate_orders(
         args.count,
@@ -0,0 +1,185 @@
+#include "../include/checkpoint_index.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LOB_HAVE_MMAP 1
+#else
+#define LOB_HAVE_MMAP 0
+#endif
+
+namespace {
+
+constexpr char kIndexMagic[8] = {'L', 'O', 'B', 'C', 'K', 'I', 'X', '1'};
+constexpr uint32_t kIndexVersion = 1;
+constexpr uint32_t kBinaryInputFlag = 1;
+constexpr size_t kIndexHeaderSize = 16;
+constexpr size_t kSnapshotHeaderSize = 24;  // LOBSNAP1, ahead of each snapshot's records
+
+std::string data_path(const std::string& prefix) { return prefix + ".ckpt"; }
+std::string index_path(const std::string& prefix) { return prefix + ".ckix"; }
+
+}  // namespace
+
+OrderStatus CheckpointWriter::open(const std::string& prefix, bool binary_input) {
+    close();
+    data_ = std::fopen(data_path(prefix).c_str(), "wb");
+    index_ = std::fopen(index_path(prefix).c_str(), "wb");
+    if (!data_ || !index_) {
+        close();
+        return OrderStatus::IoError;
+    }
+
+    char header[kIndexHeaderSize];
+    const uint32_t flags = binary_input ? kBinaryInputFlag : 0;
+    std::memcpy(header, kIndexMagic, sizeof(kIndexMagic));
+    std::memcpy(header + 8, &kIndexVersion, sizeof(kIndexVersion));
+    std::memcpy(header + 12, &flags, sizeof(flags));
+    if (std::fwrite(header, 1, kIndexHeaderSize, index_) != kIndexHeaderSize ||
+        std::fflush(index_) != 0) {
+        close();
+        return OrderStatus::IoError;
+    }
+    return OrderStatus::Ok;
+}
+
+OrderStatus CheckpointWriter::append(const std::vector<Order>& orders, CheckpointEntry entry) {
+    if (!is_open() || failed_) return OrderStatus::IoError;
+    entry.offset = offset_;
+    if (write_binary_snapshot(data_, orders) != OrderStatus::Ok || std::fflush(data_) != 0) {
+        // Drop the partial snapshot so the next one lands where its entry says
+        std::fseek(data_, static_cast<long>(offset_), SEEK_SET);
+        return OrderStatus::IoError;
+    }
+    if (std::fwrite(&entry, sizeof(entry), 1, index_) != 1 || std::fflush(index_) != 0) {
+        // Part of the entry may be on disk, and entries after it would sit
+        // misaligned behind it or label a snapshot at a stale offset
+        failed_ = true;
+        return OrderStatus::IoError;
+    }
+    offset_ += kSnapshotHeaderSize + orders.size() * sizeof(Order);
+    count_++;
+    return OrderStatus::Ok;
+}
+
+OrderStatus CheckpointWriter::close() {
+    bool ok = true;
+    if (data_) ok &= std::fclose(data_) == 0;
+    if (index_) ok &= std::fclose(index_) == 0;
+    data_ = nullptr;
+    index_ = nullptr;
+    offset_ = 0;
+    count_ = 0;
+    failed_ = false;
+    return ok ? OrderStatus::Ok : OrderStatus::IoError;
+}
+
+OrderStatus CheckpointIndex::load(const std::string& prefix) {
+    entries_.clear();
+    std::FILE* file = std::fopen(index_path(prefix).c_str(), "rb");
+    if (!file) return OrderStatus::IoError;
+
+    char header[kIndexHeaderSize];
+    uint32_t version = 0;
+    uint32_t flags = 0;
+    if (std::fread(header, 1, kIndexHeaderSize, file) == kIndexHeaderSize) {
+        std::memcpy(&version, header + 8, sizeof(version));
+        std::memcpy(&flags, header + 12, sizeof(flags));
+    }
+    if (version != kIndexVersion || std::memcmp(header, kIndexMagic, sizeof(kIndexMagic)) != 0) {
+        std::fclose(file);
+        return OrderStatus::ParseError;
+    }
+    binary_input_ = (flags & kBinaryInputFlag) != 0;
+
+    CheckpointEntry entry;
+    while (std::fread(&entry, sizeof(entry), 1, file) == 1) {
+        if (!entries_.empty() && (entry.sequence < entries_.back().sequence ||
+                                  entry.timestamp < entries_.back().timestamp)) {
+            entries_.clear();
+            std::fclose(file);
+            return OrderStatus::ParseError;
+        }
+        entries_.push_back(entry);
+    }
+    std::fclose(file);
+    return OrderStatus::Ok;
+}
+
+const CheckpointEntry* CheckpointIndex::at_sequence(uint64_t sequence) const {
+    auto it = std::upper_bound(entries_.begin(), entries_.end(), sequence,
+                               [](uint64_t s, const CheckpointEntry& e) { return s < e.sequence; });
+    return it == entries_.begin() ? nullptr : &*(it - 1);
+}
+
+const CheckpointEntry* CheckpointIndex::at_time(Timestamp time) const {
+    auto it = std::upper_bound(entries_.begin(), entries_.end(), time,
+                               [](Timestamp t, const CheckpointEntry& e) { return t < e.timestamp; });
+    return it == entries_.begin() ? nullptr : &*(it - 1);
+}
+
+OrderStatus CheckpointFile::open(const std::string& prefix) {
+    close();
+    const std::string path = data_path(prefix);
+#if LOB_HAVE_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return OrderStatus::IoError;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return OrderStatus::IoError;
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ > 0) {
+        void* mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return OrderStatus::IoError;
+        }
+        data_ = static_cast<const char*>(mapping);
+        mapped_ = true;
+    }
+    ::close(fd);  // The mapping outlives the descriptor
+    return OrderStatus::Ok;
+#else
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return OrderStatus::IoError;
+    char block[1 << 16];
+    for (size_t got; (got = std::fread(block, 1, sizeof(block), file)) > 0;) {
+        buffer_.insert(buffer_.end(), block, block + got);
+    }
+    const bool ok = !std::ferror(file);
+    std::fclose(file);
+    if (!ok) {
+        buffer_.clear();
+        return OrderStatus::IoError;
+    }
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    return OrderStatus::Ok;
+#endif
+}
+
+void CheckpointFile::close() {
+#if LOB_HAVE_MMAP
+    if (mapped_) munmap(const_cast<char*>(data_), size_);
+#endif
+    buffer_.clear();
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+}
+
+OrderStatus CheckpointFile::orders_at(const CheckpointEntry& entry, const Order*& orders,
+                                      size_t& count) const {
+    // Snapshots are whole 24-byte header and records, so every one starts
+    // 8-byte aligned within the page-aligned mapping
+    if (entry.offset >= size_ || entry.offset % alignof(Order) != 0) return OrderStatus::ParseError;
+    return parse_binary_snapshot(data_ + entry.offset, size_ - static_cast<size_t>(entry.offset),
+                                 orders, count);
+}
@@ -0,0 +1,177 @@
+#include "../include/command_pipe.hpp"
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'O', 'B', 'C', 'M', 'D', 'S', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 16;
+
+bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Split the next blank-separated word off rest
+std::string_view next_word(std::string_view& rest) noexcept {
+    size_t first = 0;
+    while (first < rest.size() && is_blank(rest[first])) ++first;
+    size_t last = first;
+    while (last < rest.size() && !is_blank(rest[last])) ++last;
+    const std::string_view word = rest.substr(first, last - first);
+    rest = rest.substr(last);
+    return word;
+}
+
+// The whole next word must be a number that fits T
+template <typename T>
+bool parse_word(std::string_view& rest, T& value) noexcept {
+    const std::string_view word = next_word(rest);
+    if (word.empty()) return false;
+    const char* end = word.data() + word.size();
+    auto [ptr, ec] = std::from_chars(word.data(), end, value);
+    return ec == std::errc() && ptr == end;
+}
+
+bool valid(const Command& command) {
+    return command.kind >= CommandKind::Add && command.kind <= CommandKind::Time && command.side <= 1;
+}
+
+}  // namespace
+
+OrderStatus parse_command_line(std::string_view line, Command& out) noexcept {
+    const std::string_view verb = next_word(line);
+    Command command;
+    bool ok = true;
+    if (verb == "add") {
+        uint32_t side = 0;
+        command.kind = CommandKind::Add;
+        ok = parse_word(line, command.id) && parse_word(line, command.price) &&
+             parse_word(line, command.quantity) && parse_word(line, side) && side <= 1;
+        command.side = static_cast<uint8_t>(side);
+    } else if (verb == "cancel") {
+        command.kind = CommandKind::Cancel;
+        ok = parse_word(line, command.id);
+    } else if (verb == "modify") {
+        command.kind = CommandKind::Modify;
+        ok = parse_word(line, command.id) && parse_word(line, command.price) &&
+             parse_word(line, command.quantity);
+    } else if (verb == "execute") {
+        command.kind = CommandKind::Execute;
+        ok = parse_word(line, command.id) && parse_word(line, command.quantity);
+    } else if (verb == "snapshot") {
+        command.kind = CommandKind::Snapshot;
+    } else if (verb == "stats") {
+        command.kind = CommandKind::Stats;
+    } else if (verb == "clear") {
+        command.kind = CommandKind::Clear;
+    } else if (verb == "time") {
+        command.kind = CommandKind::Time;
+        ok = parse_word(line, command.id);
+    } else {
+        return OrderStatus::ParseError;
+    }
+    // Nothing may follow the arguments
+    if (!ok || !next_word(line).empty()) return OrderStatus::ParseError;
+    out = command;
+    return OrderStatus::Ok;
+}
+
+CommandReader::CommandReader(std::FILE* in) : in_(in), buffer_(kBlockSize) {}
+
+CommandReader::CommandReader(std::FILE* in, bool binary)
+    : in_(in), buffer_(kBlockSize), detected_(true), binary_(binary) {}
+
+bool CommandReader::refill() {
+    if (eof_) return false;
+    if (begin_ > 0) {
+        std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+        base_ += begin_;
+        end_ -= begin_;
+        begin_ = 0;
+    }
+    // A line longer than the buffer grows it
+    if (end_ == buffer_.size()) buffer_.resize(buffer_.size() * 2);
+    const size_t got = std::fread(buffer_.data() + end_, 1, buffer_.size() - end_, in_);
+    end_ += got;
+    if (got == 0) eof_ = true;
+    return got > 0;
+}
+
+bool CommandReader::detect() {
+    while (end_ - begin_ < kHeaderSize && refill()) {}
+    detected_ = true;
+    if (end_ - begin_ < sizeof(kMagic) ||
+        std::memcmp(buffer_.data() + begin_, kMagic, sizeof(kMagic)) != 0) {
+        return true;  // Text
+    }
+    binary_ = true;
+    uint32_t version = 0;
+    uint32_t record_size = 0;
+    if (end_ - begin_ >= kHeaderSize) {
+        std::memcpy(&version, buffer_.data() + begin_ + 8, sizeof(version));
+        std::memcpy(&record_size, buffer_.data() + begin_ + 12, sizeof(record_size));
+    }
+    if (version != kVersion || record_size != sizeof(Command)) {
+        malformed_++;
+        begin_ = end_;
+        eof_ = true;
+        return false;
+    }
+    begin_ += kHeaderSize;
+    return true;
+}
+
+size_t CommandReader::read(Command* out, size_t max) {
+    if (!detected_ && !detect()) return 0;
+    size_t n = 0;
+    while (n < max) {
+        if (binary_) {
+            if (end_ - begin_ < sizeof(Command)) {
+                if (refill()) continue;
+                if (end_ != begin_) malformed_++;  // Truncated last record
+                begin_ = end_;
+                break;
+            }
+            std::memcpy(&out[n], buffer_.data() + begin_, sizeof(Command));
+            begin_ += sizeof(Command);
+            if (valid(out[n])) n++; else malformed_++;
+            continue;
+        }
+
+        const char* line = buffer_.data() + begin_;
+        const char* newline = static_cast<const char*>(std::memchr(line, '\n', end_ - begin_));
+        size_t length;
+        if (newline) {
+            length = static_cast<size_t>(newline - line);
+            begin_ += length + 1;
+        } else if (refill()) {
+            continue;
+        } else if (end_ > begin_) {
+            length = end_ - begin_;  // Last line without a newline
+            line = buffer_.data() + begin_;
+            begin_ = end_;
+        } else {
+            break;
+        }
+
+        std::string_view text(line, length);
+        const size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos || text[first] == '#') continue;
+        if (parse_command_line(text, out[n]) == OrderStatus::Ok) n++; else malformed_++;
+    }
+    return n;
+}
+
+OrderStatus write_command_header(std::FILE* out) {
+    char header[kHeaderSize];
+    const uint32_t record_size = sizeof(Command);
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    std::memcpy(header + 8, &kVersion, sizeof(kVersion));
+    std::memcpy(header + 12, &record_size, sizeof(record_size));
+    return std::fwrite(header, 1, kHeaderSize, out) == kHeaderSize ? OrderStatus::Ok
+                                                                   : OrderStatus::IoError;
+}
+
+OrderStatus write_commands(std::FILE* out, const Command* commands, size_t count) {
+    return std::fwrite(commands, sizeof(Command), count, out) == count ? OrderStatus::Ok
+                                                                       : OrderStatus::IoError;
+}
@@ -0,0 +1,128 @@
+#include "../include/fork_snapshot.hpp"
+#include <algorithm>
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define LOB_HAVE_FORK 1
+#else
+#define LOB_HAVE_FORK 0
+#endif
+
+namespace {
+
+#if LOB_HAVE_FORK
+int64_t minor_faults() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+// waitpid, retried when a signal interrupts it
+pid_t wait_child(pid_t pid, int& status, int options) {
+    pid_t result;
+    do {
+        result = waitpid(pid, &status, options);
+    } while (result < 0 && errno == EINTR);
+    return result;
+}
+
+// Whether a reaped child's status says the dump succeeded
+bool dump_succeeded(pid_t result, int status) {
+    return result > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+#endif
+
+}  // namespace
+
+ForkSnapshotter::~ForkSnapshotter() {
+    wait();
+}
+
+OrderStatus ForkSnapshotter::launch(const std::function<OrderStatus()>& dump) {
+#if LOB_HAVE_FORK
+    if (busy() && !poll()) {
+        return OrderStatus::Busy;
+    }
+
+    const int64_t faults_before = minor_faults();
+    const auto start = std::chrono::steady_clock::now();
+    const pid_t pid = fork();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    if (pid == 0) {
+        // Child: write the inherited book, then leave without running the
+        // parent's atexit handlers or flushing its stdio buffers
+        _exit(dump() == OrderStatus::Ok ? 0 : 1);
+    }
+    if (pid < 0) {
+        stats_.failures++;
+        return OrderStatus::IoError;
+    }
+
+    child_ = pid;
+    faults_at_fork_ = minor_faults();
+    stats_.last_fork_faults = faults_at_fork_ - faults_before;
+    stats_.last_fork_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    stats_.total_fork_us += stats_.last_fork_us;
+    stats_.max_fork_us = std::max(stats_.max_fork_us, stats_.last_fork_us);
+    return OrderStatus::Ok;
+#else
+    (void)dump;
+    stats_.failures++;
+    return OrderStatus::IoError;
+#endif
+}
+
+bool ForkSnapshotter::poll() {
+#if LOB_HAVE_FORK
+    if (!busy()) return true;
+    int status = 0;
+    const pid_t result = wait_child(static_cast<pid_t>(child_), status, WNOHANG);
+    if (result == 0) {
+        return false;
+    }
+    // -1 (e.g. ECHILD when SIGCHLD is ignored) means the child's outcome is
+    // lost: count it as failed rather than wait on it forever
+    reaped(dump_succeeded(result, status));
+#endif
+    return true;
+}
+
+void ForkSnapshotter::wait() {
+#if LOB_HAVE_FORK
+    if (!busy()) return;
+    int status = 0;
+    const pid_t result = wait_child(static_cast<pid_t>(child_), status, 0);
+    reaped(dump_succeeded(result, status));
+#endif
+}
+
+void ForkSnapshotter::reaped(bool succeeded) {
+#if LOB_HAVE_FORK
+    // Every parent fault since the fork is attributed to copy-on-write; on a
+    // busy engine that also counts first touches of fresh memory
+    stats_.last_cow_faults = minor_faults() - faults_at_fork_;
+    stats_.total_cow_faults += stats_.last_cow_faults;
+    if (succeeded) {
+        stats_.dumps++;
+    } else {
+        stats_.failures++;
+    }
+#else
+    (void)succeeded;
+#endif
+    child_ = 0;
+}
+
+void ForkSnapshotter::print_stats(std::ostream& os) const {
+    os << "Fork Dumps: " << stats_.dumps << " (" << stats_.failures << " failed)" << std::endl;
+    os << "Last Fork Time: " << stats_.last_fork_us << " us (max "
+       << stats_.max_fork_us << " us, total " << stats_.total_fork_us << " us)" << std::endl;
+    os << "Last Fork Minor Faults: " << stats_.last_fork_faults << " in fork, "
+       << stats_.last_cow_faults << " while the child ran" << std::endl;
+    os << "Total Copy-On-Write Faults: " << stats_.total_cow_faults << std::endl;
+}
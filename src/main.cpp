@@ -1,8 +1,33 @@
 #include "../include/order_manager.hpp"
+#include "../include/book_history.hpp"
+#include "../include/checkpoint_index.hpp"
+#include "../include/command_pipe.hpp"
+#include "../include/external_id_book.hpp"
+#include "../include/fork_snapshot.hpp"
+#include "../include/order_pool_resource.hpp"
+#include "../include/snapshot_writer.hpp"
+#include "../include/striped_book.hpp"
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory_resource>
+#include <mutex>
 #include <random>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 // Performance measurement utilities
 class Timer {
@@ -36,20 +61,489 @@ void generate_random_orders(OrderManager& manager, size_t count) {
         Timer timer("Order generation");
         for (size_t i = 0; i < count; ++i) {
             Order order(i + 1, price_dist(gen), qty_dist(gen), side_dist(gen));
-            manager.add_order(std::move(order));
+            manager.add_order(order);
         }
     }
     
     std::cout << "Generated " << count << " orders successfully." << std::endl;
 }
 
+// One order per tick-aligned price, cycling over 10000 ticks from 100.00
+std::vector<Order> tick_aligned_orders(size_t count) {
+    std::vector<Order> orders;
+    orders.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        orders.emplace_back(i + 1, 100.0 + (i % 10000) * 0.01, 100, i % 2);
+    }
+    return orders;
+}
+
+// Benchmark scratch files go to the system temp directory, never the working directory
+std::string scratch_path(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("limit_order_manager_" + name)).string();
+}
+
+// Add then cancel the same workload on one backend configuration
+template <typename Book>
+void time_backend(const std::string& name, Book& book, const std::vector<Order>& orders) {
+    {
+        Timer timer(name + " addition");
+        for (const Order& order : orders) {
+            book.add_order(order);
+        }
+    }
+    if constexpr (Book::kPriceQueries) {
+        // Depth reads walk from the touch, whatever the book size
+        Order top[10];
+        size_t seen = 0;
+        {
+            Timer timer(name + " top-10 query (x1000)");
+            for (int i = 0; i < 1000; ++i) seen += book.top_orders(Side::Buy, 10, top);
+        }
+        double features = 0.0;
+        {
+            Timer timer(name + " microprice/imbalance/VWAP (x1000)");
+            for (int i = 0; i < 1000; ++i) {
+                features += book.microprice() + book.imbalance(5) +
+                            book.vwap_for_quantity(Side::Sell, 10000);
+            }
+        }
+        {
+            // Half the side: the level walk grows with it, the ladder's Fenwick trees do not
+            Timer timer(name + " half-side sweep estimate (x1000)");
+            for (int i = 0; i < 1000; ++i) {
+                features += book.estimate_sweep(Side::Buy, book.side_quantity(Side::Buy) / 2).notional;
+            }
+        }
+        // Market-making poll: where does one resting order stand in its
+        // queue. The first query starts tracking the level and is untimed.
+        const uint64_t polled = orders[orders.size() / 2].id;
+        uint64_t ahead = 0;
+        book.queue_position(polled, ahead);
+        {
+            Timer timer(name + " queue position poll (x1000)");
+            for (int i = 0; i < 1000; ++i) {
+                uint64_t position = 0;
+                book.queue_position(polled, position);
+                ahead += position;
+            }
+        }
+        volatile size_t sink = seen + ahead;
+        volatile double feature_sink = features;
+        (void)sink;
+        (void)feature_sink;
+    }
+    {
+        Timer timer(name + " cancellation");
+        for (const Order& order : orders) {
+            book.cancel_order(order.id);
+        }
+    }
+}
+
+// Dropping one of 64 accounts: its own list versus cancelling id by id
+void time_mass_cancel(const std::vector<Order>& orders) {
+    constexpr AccountId kAccounts = 64;
+    LadderOrderManager book(LadderLevels(100.00, 0.01, 10000));
+    std::vector<uint64_t> tracked_ids;  // What a caller had to keep without accounts
+    for (const Order& order : orders) {
+        const AccountId account = static_cast<AccountId>(1 + order.id % kAccounts);
+        book.add_order(order, OrderOptions{account});
+        if (account == 2) tracked_ids.push_back(order.id);
+    }
+    {
+        Timer timer("Mass cancel of one account (cancel_all)");
+        book.cancel_all(1);
+    }
+    {
+        Timer timer("Mass cancel of one account (cancel_order loop)");
+        for (uint64_t id : tracked_ids) book.cancel_order(id);
+    }
+}
+
+// Good-till-date orders expiring over 100 clock steps: the timing wheel
+// against scanning the whole book for due orders at every step
+void time_expiry(const std::vector<Order>& orders) {
+    constexpr Timestamp kSteps = 100;
+    LadderOrderManager wheel_book(LadderLevels(100.00, 0.01, 10000));
+    LadderOrderManager scan_book(LadderLevels(100.00, 0.01, 10000));
+    std::vector<Timestamp> expiry(orders.size() + 1, kNoExpiry);  // By id, for the scan
+    for (const Order& order : orders) {
+        OrderOptions options;
+        options.expires_at = 1 + order.id * 7919 % (kSteps * 10);
+        wheel_book.add_order(order, options);
+        scan_book.add_order(order);
+        expiry[order.id] = options.expires_at;
+    }
+    {
+        Timer timer("GTD expiry over 100 clock steps (timing wheel)");
+        for (Timestamp now = 1; now <= kSteps; ++now) wheel_book.advance_time(now);
+    }
+    {
+        Timer timer("GTD expiry over 100 clock steps (scan of the book)");
+        std::vector<uint64_t> due;
+        for (Timestamp now = 1; now <= kSteps; ++now) {
+            due.clear();
+            scan_book.for_each_order([&](const Order& order) {
+                if (expiry[order.id] <= now) due.push_back(order.id);
+            });
+            scan_book.cancel_orders(due.data(), due.size());
+        }
+    }
+}
+
+// Adds by 64 accounts with and without pre-trade limits configured
+void time_risk_checks(const std::vector<Order>& orders) {
+    constexpr AccountId kAccounts = 64;
+    RiskLimits limits;
+    limits.max_order_quantity = 10000;
+    limits.price_band = 0.5;
+    limits.max_position = int64_t{1} << 40;
+    limits.max_open_notional = 1e15;
+    // Alternating rounds, best of each, to keep warm-up out of the comparison
+    int64_t add_ns[2] = {std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::max()};
+    for (int round = 0; round < 6; ++round) {
+        const int checked = round % 2;
+        LadderOrderManager book(LadderLevels(100.00, 0.01, 10000), DirectIndex(orders.size() + 1));
+        book.reserve(orders.size());
+        if (checked) {
+            book.set_default_risk_limits(limits);
+            book.set_reference_price(150.00);
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (const Order& order : orders) {
+            book.add_order(order, OrderOptions{static_cast<AccountId>(1 + order.id % kAccounts)});
+        }
+        add_ns[checked] = std::min<int64_t>(add_ns[checked],
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+    const size_t n = std::max<size_t>(orders.size(), 1);
+    std::cout << "Add with accounts, no risk limits: " << add_ns[0] / n << " ns/order" << std::endl;
+    std::cout << "Add with accounts, pre-trade risk checks: " << add_ns[1] / n << " ns/order" << std::endl;
+}
+
+// Build, fill and tear down one tree book with every container on resource
+void fill_tree_book(std::pmr::memory_resource* resource, const Order* orders, size_t count) {
+    TreeOrderManager book(TreeLevels(0.01, resource), HashIndex(resource), resource);
+    book.add_orders(orders, count);
+}
+
+// Many small books (auction/backtest style) under each allocation strategy
+void time_short_lived_books(const std::vector<Order>& orders) {
+    const size_t per_book = std::min<size_t>(orders.size(), std::max<size_t>(orders.size() / 100, 100));
+    {
+        Timer timer("Short-lived books (default allocator)");
+        for (size_t i = 0; i < orders.size(); i += per_book) {
+            fill_tree_book(std::pmr::get_default_resource(), orders.data() + i,
+                           std::min(per_book, orders.size() - i));
+        }
+    }
+    {
+        Timer timer("Short-lived books (OrderPoolResource)");
+        for (size_t i = 0; i < orders.size(); i += per_book) {
+            OrderPoolResource pool;
+            fill_tree_book(&pool, orders.data() + i, std::min(per_book, orders.size() - i));
+        }
+    }
+    {
+        // One buffer reused by every book; only overflow reaches the heap
+        std::vector<std::byte> buffer(std::size_t{4} << 20);
+        Timer timer("Short-lived books (monotonic arena)");
+        for (size_t i = 0; i < orders.size(); i += per_book) {
+            std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+            fill_tree_book(&arena, orders.data() + i, std::min(per_book, orders.size() - i));
+        }
+    }
+}
+
+// 20-character client order IDs on ladder-level books: a string map kept
+// outside a hash-indexed book (two lookups per message) against a
+// direct-indexed book interning them itself
+void time_external_ids(const std::vector<Order>& orders) {
+    using HashedLadderBook = BasicOrderManager<PooledStorage, HashIndex, LadderLevels, CountingStats>;
+    std::vector<std::string> client_ids;
+    client_ids.reserve(orders.size());
+    for (const Order& order : orders) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "CL%018llx",
+                      static_cast<unsigned long long>(order.id * 0x9e3779b97f4a7c15ull >> 8));
+        client_ids.emplace_back(text);
+    }
+    {
+        HashedLadderBook book(LadderLevels(100.00, 0.01, 10000));
+        std::unordered_map<std::string, uint64_t> outside;
+        book.reserve(orders.size());
+        outside.reserve(orders.size());
+        Timer timer("Client IDs via outside map (add + cancel)");
+        for (size_t i = 0; i < orders.size(); ++i) {
+            if (outside.emplace(client_ids[i], orders[i].id).second) book.add_order(orders[i]);
+        }
+        for (const std::string& client_id : client_ids) {
+            auto it = outside.find(client_id);
+            book.cancel_order(it->second);
+            outside.erase(it);
+        }
+    }
+    {
+        ExternalIdBook<LadderOrderManager> book(LadderOrderManager(LadderLevels(100.00, 0.01, 10000)));
+        book.reserve(orders.size());
+        Timer timer("Client IDs interned by the book (add + cancel)");
+        for (size_t i = 0; i < orders.size(); ++i) {
+            book.try_add_order(client_ids[i], orders[i].price, orders[i].quantity, orders[i].side);
+        }
+        for (const std::string& client_id : client_ids) {
+            book.try_cancel_order(client_id);
+        }
+    }
+}
+
+// Level header layout: summing the top levels from many cold touches, over
+// the former 24-byte header (count and tracker inline) and the 16-byte one;
+// then a book field and a counter written from two threads, on one cache
+// line and on separate lines (the CountingStats alignment)
+void time_level_layout(size_t touches) {
+    struct InlineLevel {
+        OrderHandle head = kNullHandle;
+        OrderHandle tail = kNullHandle;
+        uint32_t count = 0;
+        uint32_t tracker = kNoQueueTracker;
+        uint64_t quantity = 0;
+    };
+    constexpr size_t kLevels = size_t{1} << 20;  // Well past the last-level cache
+    constexpr size_t kTop = 8;
+    std::mt19937_64 gen(42);
+    std::vector<size_t> touch(touches);
+    for (size_t& t : touch) t = gen() % (kLevels - kTop);
+    std::vector<InlineLevel> inline_levels(kLevels);
+    std::vector<PriceLevel> levels(kLevels);
+    for (size_t i = 0; i < kLevels; ++i) {
+        inline_levels[i].quantity = levels[i].quantity = i & 1023;
+    }
+    uint64_t sum = 0;
+    {
+        Timer timer("Top 8 levels, 24-byte headers");
+        for (size_t t : touch) {
+            for (size_t i = t; i < t + kTop; ++i) sum += inline_levels[i].quantity;
+        }
+    }
+    {
+        Timer timer("Top 8 levels, 16-byte headers");
+        for (size_t t : touch) {
+            for (size_t i = t; i < t + kTop; ++i) sum -= levels[i].quantity;
+        }
+    }
+    if (sum != 0) std::cout << "level sums disagree" << std::endl;
+
+    struct SharedLine {
+        std::atomic<uint64_t> book{0};
+        std::atomic<uint64_t> counter{0};
+    };
+    struct SeparateLines {
+        alignas(64) std::atomic<uint64_t> book{0};
+        alignas(64) std::atomic<uint64_t> counter{0};
+    };
+    auto contend = [touches](auto& line) {
+        std::thread monitor([&] {
+            for (size_t i = 0; i < touches; ++i) line.counter.fetch_add(1, std::memory_order_relaxed);
+        });
+        for (size_t i = 0; i < touches; ++i) line.book.fetch_add(1, std::memory_order_relaxed);
+        monitor.join();
+    };
+    {
+        SharedLine line;
+        Timer timer("Book field and counter on one cache line (2 threads)");
+        contend(line);
+    }
+    {
+        SeparateLines lines;
+        Timer timer("Book field and counter on separate cache lines (2 threads)");
+        contend(lines);
+    }
+}
+
+// Several writer threads, each adding then cancelling its own slice of
+// the orders: one book behind a global mutex against a StripedBook
+void time_concurrent_writers(const std::vector<Order>& orders) {
+    struct LockedBook {
+        std::mutex mutex;
+        TreeOrderManager book;
+        OrderStatus try_add_order(const Order& order) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return book.try_add_order(order);
+        }
+        OrderStatus try_cancel_order(uint64_t id) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return book.try_cancel_order(id);
+        }
+    };
+    auto run = [&orders](auto& book, size_t threads) {
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < threads; ++t) {
+            writers.emplace_back([&, t] {
+                const size_t begin = orders.size() * t / threads;
+                const size_t end = orders.size() * (t + 1) / threads;
+                for (size_t i = begin; i < end; ++i) book.try_add_order(orders[i]);
+                for (size_t i = begin; i < end; ++i) book.try_cancel_order(orders[i].id);
+            });
+        }
+        for (std::thread& writer : writers) writer.join();
+    };
+    for (size_t threads : {1, 2, 4}) {
+        const std::string label = " (" + std::to_string(threads) + " writers, add + cancel)";
+        {
+            LockedBook book;
+            Timer timer("Global mutex book" + label);
+            run(book, threads);
+        }
+        {
+            StripedBook<TreeLevels> book;
+            Timer timer("Striped book" + label);
+            run(book, threads);
+        }
+    }
+}
+
+// A day's commands (all adds, then fills and cancels in arrival order),
+// queried at 20 random sequence numbers: from the nearest stored version,
+// against a replay from the open for each query
+void time_book_history(const std::vector<Order>& orders) {
+    std::vector<Command> commands;
+    commands.reserve(orders.size() * 2);
+    for (const Order& order : orders) {
+        Command command;
+        command.id = order.id;
+        command.price = order.price;
+        command.quantity = order.quantity;
+        command.side = static_cast<uint8_t>(order.side);
+        commands.push_back(command);
+    }
+    for (size_t i = 0; i < orders.size(); ++i) {
+        Command command;
+        command.kind = i % 3 == 0 ? CommandKind::Execute : CommandKind::Cancel;
+        command.id = orders[i].id;
+        command.quantity = orders[i].quantity / 2;
+        commands.push_back(command);
+    }
+    std::mt19937_64 gen(7);
+    std::vector<uint64_t> queries(20);
+    for (uint64_t& query : queries) query = gen() % (commands.size() + 1);
+
+    BookHistory history(0.01, 4096);
+    {
+        Timer timer("Book history recording (versions every 4096 commands)");
+        for (const Command& command : commands) history.apply(command);
+    }
+    size_t resting = 0;
+    {
+        Timer timer("Point-in-time queries from the nearest version (x20)");
+        for (uint64_t query : queries) resting += history.at(query).size();
+    }
+    {
+        std::ostringstream ignored;
+        Timer timer("Point-in-time queries by replay from the open (x20)");
+        for (uint64_t query : queries) {
+            TreeOrderManager book;
+            apply_commands(book, commands.data(), query, ignored);
+            resting -= book.size();
+        }
+    }
+    if (resting != 0) std::cout << "history and replay disagree" << std::endl;
+    std::cout << "Book history: " << history.version_count() << " versions, "
+              << history.node_bytes() / 1024 << " KiB of nodes for " << commands.size()
+              << " commands" << std::endl;
+}
+
+// Snapshot to a file: all on this thread, versus capture plus background
+// write, versus a forked child dumping while this thread keeps cancelling
+void time_snapshot_files(const std::vector<Order>& orders) {
+    OrderManager manager;
+    manager.reserve(orders.size());
+    for (const Order& order : orders) manager.add_order(order);
+
+    const std::string text_path = scratch_path("snapshot.txt");
+    {
+        Timer timer("Snapshot to file (synchronous)");
+        manager.print_snapshot_to_file(text_path);
+    }
+    {
+        SnapshotWriter writer;
+        {
+            Timer timer("Snapshot capture (background writer)");
+            writer.request(manager, text_path);
+        }
+        writer.flush();
+    }
+    std::remove(text_path.c_str());
+
+    const std::string binary_path = scratch_path("snapshot.bin");
+    ForkSnapshotter dumper;
+    {
+        Timer timer("Snapshot fork (copy-on-write dump)");
+        dumper.start(manager, binary_path, SnapshotFormat::Binary);
+    }
+    {
+        Timer timer("Order cancellation (during fork dump)");
+        for (size_t i = 0; i < std::min(orders.size(), size_t(1000)); ++i) {
+            manager.cancel_order(orders[i].id);
+        }
+    }
+    dumper.wait();
+    std::remove(binary_path.c_str());
+    dumper.print_stats();
+}
+
+// Same tick-aligned workload on each backend configuration
+void time_backends(const std::vector<Order>& orders) {
+    TreeOrderManager tree_book;
+    time_backend("Tree backend", tree_book, orders);
+    LadderOrderManager ladder_book(LadderLevels(100.00, 0.01, 10000));
+    time_backend("Ladder backend", ladder_book, orders);
+}
+
+void time_level_layout_for(const std::vector<Order>& orders) { time_level_layout(orders.size() * 10); }
+
+// Per-feature benchmarks, run by name with `bench`, each on tick_aligned_orders
+struct FeatureBenchmark {
+    const char* name;
+    void (*run)(const std::vector<Order>& orders);
+};
+
+constexpr FeatureBenchmark kFeatureBenchmarks[] = {
+    {"backends", time_backends},
+    {"mass-cancel", time_mass_cancel},
+    {"expiry", time_expiry},
+    {"risk", time_risk_checks},
+    {"arenas", time_short_lived_books},
+    {"external-ids", time_external_ids},
+    {"level-layout", time_level_layout_for},
+    {"writers", time_concurrent_writers},
+    {"history", time_book_history},
+    {"snapshot-files", time_snapshot_files},
+};
+
+// Run the named feature benchmark, or every one for "all"
+// @return false if no benchmark has that name
+bool run_feature_benchmark(const std::string& name, size_t order_count) {
+    const std::vector<Order> orders = tick_aligned_orders(order_count);
+    bool found = false;
+    for (const FeatureBenchmark& benchmark : kFeatureBenchmarks) {
+        if (name != "all" && name != benchmark.name) continue;
+        std::cout << "\n=== " << benchmark.name << " (" << order_count << " orders) ===" << std::endl;
+        benchmark.run(orders);
+        found = true;
+    }
+    return found;
+}
+
 // Performance benchmark
 void run_benchmark(OrderManager& manager, size_t order_count) {
     std::cout << "\n=== PERFORMANCE BENCHMARK ===" << std::endl;
     std::cout << "Testing with " << order_count << " orders" << std::endl;
     
-    // Clear existing orders
+    // Clear existing orders and size the index for the run up front
     manager.clear();
+    manager.reserve(order_count);
     
     // Benchmark order addition
     {
@@ -63,6 +557,30 @@ void run_benchmark(OrderManager& manager, size_t order_count) {
         manager.print_snapshot();
     }
     
+    // Full-book ordering alone: comparison sort over pointers versus radix sort
+    {
+        std::vector<Order> captured;
+        manager.capture_snapshot(captured);
+        std::vector<const Order*> ptrs;
+        ptrs.reserve(captured.size());
+        for (const Order& order : captured) ptrs.push_back(&order);
+        {
+            Timer timer("Snapshot ordering (comparison sort)");
+            auto asks = std::partition(ptrs.begin(), ptrs.end(),
+                                       [](const Order* order) { return order->is_buy(); });
+            std::sort(ptrs.begin(), asks, [](const Order* a, const Order* b) {
+                return SideTraits<Side::Buy>::better(a->price, b->price);
+            });
+            std::sort(asks, ptrs.end(), [](const Order* a, const Order* b) {
+                return SideTraits<Side::Sell>::better(a->price, b->price);
+            });
+        }
+        {
+            Timer timer("Snapshot ordering (radix sort)");
+            sort_snapshot(captured);
+        }
+    }
+    
     // Benchmark order cancellation
     {
         Timer timer("Order cancellation");
@@ -71,6 +589,44 @@ void run_benchmark(OrderManager& manager, size_t order_count) {
         }
     }
     
+    // Benchmark the batched paths on the same workload, in feed-sized bursts
+    constexpr size_t kBurst = 256;
+    const std::vector<Order> burst_orders = tick_aligned_orders(order_count);
+    std::vector<uint64_t> burst_ids;
+    burst_ids.reserve(order_count);
+    for (const Order& order : burst_orders) burst_ids.push_back(order.id);
+    
+    OrderManager batched;
+    {
+        Timer timer("Batched addition (bursts of 256)");
+        for (size_t i = 0; i < order_count; i += kBurst) {
+            batched.add_orders(burst_orders.data() + i, std::min(kBurst, order_count - i));
+        }
+    }
+    {
+        Timer timer("Batched cancellation (bursts of 256)");
+        for (size_t i = 0; i < order_count; i += kBurst) {
+            batched.cancel_orders(burst_ids.data() + i, std::min(kBurst, order_count - i));
+        }
+    }
+    
+    // Worst single add_order under each rehash policy (growth from empty)
+    for (RehashPolicy policy : {RehashPolicy::Immediate, RehashPolicy::Incremental}) {
+        OrderManager book;
+        book.set_rehash_policy(policy);
+        int64_t worst_ns = 0;
+        for (const Order& order : burst_orders) {
+            auto start = std::chrono::steady_clock::now();
+            book.add_order(order);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            worst_ns = std::max<int64_t>(worst_ns,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+        std::cout << "Worst add_order latency ("
+                  << (policy == RehashPolicy::Immediate ? "immediate" : "incremental")
+                  << " rehash): " << worst_ns << " ns" << std::endl;
+    }
+    
     // Print final stats
     manager.print_stats();
 }
@@ -84,15 +640,196 @@ void print_usage() {
     std::cout << "  load <filename>     - Load orders from CSV file" << std::endl;
     std::cout << "  generate <count>    - Generate random orders" << std::endl;
     std::cout << "  benchmark <count>   - Run performance benchmark" << std::endl;
+    std::cout << "  bench <name> <count> - Run one feature benchmark, or all of them:" << std::endl;
+    std::cout << "                      ";
+    for (const FeatureBenchmark& benchmark : kFeatureBenchmarks) std::cout << " " << benchmark.name;
+    std::cout << " all" << std::endl;
     std::cout << "  snapshot [filename] - Print snapshot (optional file output)" << std::endl;
     std::cout << "  stats              - Print statistics" << std::endl;
     std::cout << "  interactive        - Start interactive mode" << std::endl;
+    std::cout << "  pipe [--echo] [--checkpoint <prefix> [--every <n>]]" << std::endl;
+    std::cout << "                     - Apply text or binary commands from stdin, optionally" << std::endl;
+    std::cout << "                       checkpointing the book every n commands" << std::endl;
+    std::cout << "  seek <file> <prefix> (--seq <n> | --time <t>) [--snapshot]" << std::endl;
+    std::cout << "                     - Book after n commands of file, or at book time t," << std::endl;
+    std::cout << "                       from the nearest checkpoint" << std::endl;
+    std::cout << "  encode             - Convert text commands on stdin to binary on stdout" << std::endl;
     std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
     std::cout << "  ./main load data/ticks.txt" << std::endl;
     std::cout << "  ./main generate 1000" << std::endl;
     std::cout << "  ./main benchmark 10000" << std::endl;
     std::cout << "  ./main snapshot output.txt" << std::endl;
+    std::cout << "  ./main pipe < commands.txt" << std::endl;
+    std::cout << "  ./main pipe --checkpoint day < commands.bin" << std::endl;
+    std::cout << "  ./main seek commands.bin day --seq 1500000" << std::endl;
+}
+
+// Scripted mode: commands from stdin in large blocks, applied in batches.
+// Silent unless echo, which prints one status per command. With a
+// checkpoint prefix, the book is checkpointed at the first batch boundary
+// after every `every` commands, for seek_mode.
+void pipe_mode(OrderManager& manager, bool echo, const std::string& checkpoint_prefix = "",
+               size_t every = 0) {
+    constexpr size_t kBatch = 4096;
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    CommandReader reader(stdin);
+    std::vector<Command> commands(kBatch);
+    std::vector<OrderStatus> statuses(kBatch);
+    std::ostringstream out;
+    size_t total = 0;
+    size_t rejected = 0;
+    CheckpointWriter checkpoints;
+    size_t next_checkpoint = every;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n; (n = reader.read(commands.data(), kBatch)) > 0;) {
+        total += n;
+        if (!echo) {
+            rejected += apply_commands(manager, commands.data(), n, std::cout);
+        } else {
+            // One at a time, so snapshot output and statuses stay in order
+            for (size_t i = 0; i < n; ++i) {
+                rejected += apply_commands(manager, &commands[i], 1, out, &statuses[i]);
+                out << status_name(statuses[i]) << '\n';
+            }
+            std::cout << out.str();
+            out.str("");
+        }
+        if (checkpoint_prefix.empty() || total < next_checkpoint) continue;
+        // Opened only now: the stream's format is known once it has been read
+        if (!checkpoints.is_open() && checkpoints.open(checkpoint_prefix, reader.binary()) != OrderStatus::Ok) {
+            std::cerr << "Error: could not create checkpoints: " << checkpoint_prefix << std::endl;
+            return;
+        }
+        const OrderStatus status = checkpoints.write(manager, total, reader.position());
+        if (status != OrderStatus::Ok) {
+            std::cerr << "Error: could not write checkpoint at command " << total << " ("
+                      << status_name(status) << ")" << std::endl;
+        }
+        // A failed index write ends checkpointing; the entries so far stand
+        next_checkpoint = checkpoints.failed() ? SIZE_MAX : total + every;
+    }
+    std::cout.flush();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << "Pipe: " << total << " commands (" << (reader.binary() ? "binary" : "text")
+              << "), " << rejected << " rejected, " << reader.malformed() << " malformed, "
+              << static_cast<uint64_t>(total / std::max(elapsed, 1e-9)) << " commands/s" << std::endl;
+    if (checkpoints.is_open()) {
+        std::cerr << "Checkpoints: " << checkpoints.count() << " written to " << checkpoint_prefix
+                  << ".ckpt" << std::endl;
+        checkpoints.close();
+    }
+}
+
+bool seek_stream(std::FILE* in, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(in, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(in, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+// The book after the first target commands of a file replayed with
+// pipe --checkpoint (or, by_time, as of book time target): restored from
+// the nearest checkpoint, then only the gap after it is replayed.
+int seek_mode(OrderManager& manager, const std::string& input, const std::string& prefix,
+              bool by_time, uint64_t target, bool print_book) {
+    constexpr size_t kBatch = 4096;
+    auto start = std::chrono::steady_clock::now();
+
+    CheckpointIndex index;
+    CheckpointFile file;
+    if (index.load(prefix) != OrderStatus::Ok || file.open(prefix) != OrderStatus::Ok) {
+        std::cerr << "Error: could not read checkpoints: " << prefix << std::endl;
+        return 1;
+    }
+    std::FILE* in = std::fopen(input.c_str(), "rb");
+    if (!in) {
+        std::cerr << "Error: could not open file: " << input << std::endl;
+        return 1;
+    }
+
+    // No checkpoint early enough: replay from the open
+    const CheckpointEntry* entry = by_time ? index.at_time(target) : index.at_sequence(target);
+    uint64_t sequence = 0;
+    if (entry) {
+        const OrderStatus status = restore_checkpoint(file, *entry, manager);
+        if (status != OrderStatus::Ok || !seek_stream(in, entry->input_offset)) {
+            std::cerr << "Error: bad checkpoint at command " << entry->sequence << " ("
+                      << status_name(status) << ")" << std::endl;
+            std::fclose(in);
+            return 1;
+        }
+        sequence = entry->sequence;
+    }
+    CommandReader reader = entry ? CommandReader(in, index.binary_input()) : CommandReader(in);
+
+    std::vector<Command> commands(kBatch);
+    std::ostringstream ignored;
+    uint64_t replayed = 0;
+    for (;;) {
+        size_t want = kBatch;
+        if (!by_time) {
+            if (sequence >= target) break;
+            want = static_cast<size_t>(std::min<uint64_t>(kBatch, target - sequence));
+        }
+        const size_t n = reader.read(commands.data(), want);
+        if (n == 0) break;
+        size_t take = n;
+        if (by_time) {
+            // Stop short of the first tick past the target
+            for (size_t i = 0; i < n; ++i) {
+                if (commands[i].kind == CommandKind::Time && commands[i].id > target) {
+                    take = i;
+                    break;
+                }
+            }
+        }
+        apply_commands(manager, commands.data(), take, ignored);
+        ignored.str("");
+        sequence += take;
+        replayed += take;
+        if (take < n) break;
+    }
+    std::fclose(in);
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << "Seek: ";
+    if (entry) {
+        std::cerr << "checkpoint at command " << entry->sequence << " (time " << entry->timestamp << ")";
+    } else {
+        std::cerr << "no checkpoint, from the open";
+    }
+    std::cerr << ", replayed " << replayed << " commands to command " << sequence << " in "
+              << elapsed << " ms" << (file.mapped() ? " (mapped)" : "") << std::endl;
+    if (print_book) {
+        manager.print_snapshot();
+    } else {
+        manager.print_stats();
+    }
+    return 0;
+}
+
+// Text commands on stdin to the binary pipe format on stdout
+int encode_mode() {
+    constexpr size_t kBatch = 4096;
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    CommandReader reader(stdin);
+    std::vector<Command> commands(kBatch);
+    if (write_command_header(stdout) != OrderStatus::Ok) return 1;
+    for (size_t n; (n = reader.read(commands.data(), kBatch)) > 0;) {
+        if (write_commands(stdout, commands.data(), n) != OrderStatus::Ok) return 1;
+    }
+    if (reader.malformed()) {
+        std::cerr << "Skipped " << reader.malformed() << " malformed lines" << std::endl;
+    }
+    return std::fflush(stdout) == 0 ? 0 : 1;
 }
 
 void interactive_mode(OrderManager& manager) {
@@ -124,10 +861,11 @@ void interactive_mode(OrderManager& manager) {
             
             if (iss >> cmd >> id >> price >> qty >> side) {
                 Order order(id, price, qty, side);
-                if (manager.add_order(std::move(order))) {
+                OrderStatus status = manager.try_add_order(order);
+                if (status == OrderStatus::Ok) {
                     std::cout << "Order added successfully." << std::endl;
                 } else {
-                    std::cout << "Failed to add order (ID already exists)." << std::endl;
+                    std::cout << "Failed to add order (" << status_name(status) << ")." << std::endl;
                 }
             } else {
                 std::cout << "Usage: add <id> <price> <qty> <side>" << std::endl;
@@ -169,7 +907,12 @@ int main(int argc, char* argv[]) {
             std::cout << "Loading orders from " << filename << "..." << std::endl;
             
             Timer timer("CSV loading");
-            size_t loaded = manager.load_from_csv(filename);
+            OrderStatus status;
+            size_t loaded = manager.load_from_csv(filename, &status);
+            if (status != OrderStatus::Ok) {
+                std::cerr << "Error: could not open file: " << filename << std::endl;
+                return 1;
+            }
             std::cout << "Loaded " << loaded << " orders." << std::endl;
             
             manager.print_snapshot();
@@ -183,10 +926,22 @@ int main(int argc, char* argv[]) {
             size_t count = std::stoul(argv[2]);
             run_benchmark(manager, count);
             
+        } else if (command == "bench" && argc >= 4) {
+            std::string name = argv[2];
+            size_t count = std::stoul(argv[3]);
+            if (!run_feature_benchmark(name, count)) {
+                std::cerr << "Error: unknown benchmark: " << name << std::endl;
+                print_usage();
+                return 1;
+            }
+            
         } else if (command == "snapshot") {
             if (argc >= 3) {
                 std::string filename = argv[2];
-                manager.print_snapshot_to_file(filename);
+                if (manager.print_snapshot_to_file(filename) != OrderStatus::Ok) {
+                    std::cerr << "Error: could not write file: " << filename << std::endl;
+                    return 1;
+                }
                 std::cout << "Snapshot saved to " << filename << std::endl;
             } else {
                 manager.print_snapshot();
@@ -198,6 +953,37 @@ int main(int argc, char* argv[]) {
         } else if (command == "interactive") {
             interactive_mode(manager);
             
+        } else if (command == "pipe") {
+            bool echo = false;
+            std::string checkpoint_prefix;
+            size_t every = 1000000;
+            for (int i = 2; i < argc; ++i) {
+                const std::string option = argv[i];
+                if (option == "--echo") {
+                    echo = true;
+                } else if (option == "--checkpoint" && i + 1 < argc) {
+                    checkpoint_prefix = argv[++i];
+                } else if (option == "--every" && i + 1 < argc) {
+                    every = std::max<size_t>(std::stoul(argv[++i]), 1);
+                } else {
+                    print_usage();
+                    return 1;
+                }
+            }
+            pipe_mode(manager, echo, checkpoint_prefix, every);
+            
+        } else if (command == "seek" && argc >= 6) {
+            const std::string mode = argv[4];
+            if (mode != "--seq" && mode != "--time") {
+                print_usage();
+                return 1;
+            }
+            return seek_mode(manager, argv[2], argv[3], mode == "--time", std::stoull(argv[5]),
+                             argc >= 7 && std::string(argv[6]) == "--snapshot");
+            
+        } else if (command == "encode") {
+            return encode_mode();
+            
         } else {
             print_usage();
             return 1;
@@ -1,180 +1,209 @@
 #include "../include/order_manager.hpp"
 #include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
-#include <stdexcept>
-
-bool OrderManager::add_order(Order order) {
-    // Check if order ID already exists
-    auto [it, inserted] = orders_.try_emplace(order.id, std::move(order));
-    
-    if (inserted) {
-        total_orders_added_++;
-        snapshot_dirty_ = true;  // Mark snapshot cache as dirty
-        return true;
-    }
-    return false;
+#include <iterator>
+
+// Instantiate every shipped configuration here, so a policy that stops
+// satisfying the interface fails in this file rather than in a user's build
+template class BasicOrderManager<PooledStorage, HashIndex, UnsortedLevels, CountingStats>;
+template class BasicOrderManager<PooledStorage, DirectIndex, LadderLevels, CountingStats>;
+template class BasicOrderManager<PooledStorage, HashIndex, TreeLevels, CountingStats>;
+
+namespace {
+
+// Split the next comma-separated field off rest, trimming blanks and '\r'
+bool next_field(std::string_view& rest, std::string_view& field) noexcept {
+    if (rest.empty()) return false;
+    const size_t comma = rest.find(',');
+    field = rest.substr(0, comma);
+    rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+
+    const size_t first = field.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) return false;
+    field = field.substr(first, field.find_last_not_of(" \t\r") - first + 1);
+    return true;
 }
 
-bool OrderManager::cancel_order(uint64_t order_id) {
-    auto it = orders_.find(order_id);
-    if (it != orders_.end()) {
-        orders_.erase(it);
-        total_orders_cancelled_++;
-        snapshot_dirty_ = true;  // Mark snapshot cache as dirty
-        return true;
-    }
-    return false;
+// The whole field must be a number that fits T
+template <typename T>
+bool parse_field(std::string_view& rest, T& value) noexcept {
+    std::string_view field;
+    if (!next_field(rest, field)) return false;
+    const char* end = field.data() + field.size();
+    auto [ptr, ec] = std::from_chars(field.data(), end, value);
+    return ec == std::errc() && ptr == end;
 }
 
-const Order* OrderManager::get_order(uint64_t order_id) const {
-    auto it = orders_.find(order_id);
-    return (it != orders_.end()) ? &(it->second) : nullptr;
+}  // namespace
+
+OrderStatus parse_order_csv_line(std::string_view line, Order& out) noexcept {
+    uint64_t id;
+    double price;
+    uint32_t quantity;
+    uint32_t side;
+
+    // Fields after the side are ignored
+    if (!parse_field(line, id) || !parse_field(line, price) ||
+        !parse_field(line, quantity) || !parse_field(line, side)) {
+        return OrderStatus::ParseError;
+    }
+
+    // Validate side (0=buy, 1=sell)
+    if (side > 1) return OrderStatus::ParseError;
+
+    out = Order(id, price, quantity, side);
+    return OrderStatus::Ok;
 }
 
-void OrderManager::print_snapshot(std::ostream& os) const {
-    rebuild_snapshot_cache();
-    
-    os << "\n=== ORDER BOOK SNAPSHOT ===" << std::endl;
-    os << "Total Active Orders: " << order_ptrs_.size() << std::endl;
-    os << std::endl;
-    
-    if (order_ptrs_.empty()) {
-        os << "No active orders." << std::endl;
+void write_snapshot_header(std::ostream& os, size_t count) {
+    os << "\n=== ORDER BOOK SNAPSHOT ===\n";
+    os << "Total Active Orders: " << count << "\n\n";
+
+    if (count == 0) {
+        os << "No active orders.\n";
         return;
     }
-    
-    // Print header
-    os << std::setw(12) << "Order ID" 
-       << std::setw(12) << "Price" 
-       << std::setw(12) << "Quantity" 
-       << std::setw(8) << "Side" << std::endl;
-    os << std::string(44, '-') << std::endl;
-    
-    // Print orders sorted by price (best prices first)
-    std::vector<const Order*> sorted_orders = order_ptrs_;
-    std::sort(sorted_orders.begin(), sorted_orders.end(), 
-              [](const Order* a, const Order* b) {
-                  if (a->is_buy() != b->is_buy()) {
-                      return a->is_buy();  // Buy orders first
-                  }
-                  if (a->is_buy()) {
-                      return a->price > b->price;  // Higher buy prices first
-                  } else {
-                      return a->price < b->price;  // Lower sell prices first
-                  }
-              });
-    
-    for (const auto* order : sorted_orders) {
-        os << std::setw(12) << order->id
-           << std::setw(12) << std::fixed << std::setprecision(2) << order->price
-           << std::setw(12) << order->quantity
-           << std::setw(8) << (order->is_buy() ? "BUY" : "SELL") << std::endl;
+
+    os << std::setw(12) << "Order ID"
+       << std::setw(12) << "Price"
+       << std::setw(12) << "Quantity"
+       << std::setw(8) << "Side" << "\n";
+    os << std::string(44, '-') << "\n";
+}
+
+void write_snapshot_row(std::ostream& os, const Order& order) {
+    os << std::setw(12) << order.id
+       << std::setw(12) << std::fixed << std::setprecision(2) << order.price
+       << std::setw(12) << order.quantity
+       << std::setw(8) << (order.is_buy() ? "BUY" : "SELL") << "\n";
+}
+
+void write_snapshot_footer(std::ostream& os, size_t count) {
+    if (count != 0) os << "\n";
+    os.flush();
+}
+
+void sort_snapshot(std::vector<Order>& orders) {
+    // Sort compact (key, index) pairs, then gather the records once
+    using Item = KeyedItem<uint32_t>;
+    std::vector<Item> bids, asks, scratch;
+    bids.reserve(orders.size());
+    asks.reserve(orders.size());
+    for (size_t i = 0; i < orders.size(); ++i) {
+        const Order& order = orders[i];
+        const uint32_t index = static_cast<uint32_t>(i);
+        if (order.is_buy()) {
+            bids.push_back(Item{snapshot_key<Side::Buy>(order.price), index});
+        } else {
+            asks.push_back(Item{snapshot_key<Side::Sell>(order.price), index});
+        }
     }
-    
-    os << std::endl;
+    radix_sort(bids, scratch);
+    radix_sort(asks, scratch);
+
+    std::vector<Order> sorted;
+    sorted.reserve(orders.size());
+    for (const Item& item : bids) sorted.push_back(orders[item.value]);
+    for (const Item& item : asks) sorted.push_back(orders[item.value]);
+    orders.swap(sorted);
 }
 
-void OrderManager::print_snapshot_to_file(const std::string& filename) const {
+namespace {
+
+constexpr char kBinaryMagic[8] = {'L', 'O', 'B', 'S', 'N', 'A', 'P', '1'};
+constexpr uint32_t kBinaryVersion = 1;
+
+struct BinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+};
+static_assert(sizeof(BinaryHeader) == 24, "Binary snapshot header is 24 bytes on disk");
+
+}  // namespace
+
+OrderStatus save_snapshot(const std::string& filename, std::vector<Order>& orders,
+                          bool sorted, SnapshotFormat format) {
+    if (format == SnapshotFormat::Binary) {
+        std::FILE* file = std::fopen(filename.c_str(), "wb");
+        if (!file) return OrderStatus::IoError;
+        const OrderStatus status = write_binary_snapshot(file, orders);
+        const bool closed = std::fclose(file) == 0;
+        return status == OrderStatus::Ok && !closed ? OrderStatus::IoError : status;
+    }
+
     std::ofstream file(filename);
     if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
+        return OrderStatus::IoError;
     }
-    print_snapshot(file);
+    if (!sorted) sort_snapshot(orders);
+    write_snapshot_header(file, orders.size());
+    for (const Order& order : orders) write_snapshot_row(file, order);
+    write_snapshot_footer(file, orders.size());
+
+    file.flush();
+    return file.good() ? OrderStatus::Ok : OrderStatus::IoError;
 }
 
-size_t OrderManager::load_from_csv(const std::string& filename) {
-    std::ifstream file(filename);
+OrderStatus load_binary_snapshot(const std::string& filename, std::vector<Order>& out) {
+    std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
     if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
+        return OrderStatus::IoError;
     }
-    
-    size_t loaded_count = 0;
-    std::string line;
-    
-    // Skip header line if it exists
-    std::getline(file, line);
-    if (line.find("id") != std::string::npos || line.find("ID") != std::string::npos) {
-        // This looks like a header, skip it
-    } else {
-        // Not a header, process this line
-        auto order = parse_csv_line(line);
-        if (order && add_order(std::move(*order))) {
-            loaded_count++;
-        }
-    }
-    
-    // Process remaining lines
-    while (std::getline(file, line)) {
-        if (line.empty()) continue;
-        
-        auto order = parse_csv_line(line);
-        if (order && add_order(std::move(*order))) {
-            loaded_count++;
-        }
-    }
-    
-    return loaded_count;
-}
 
-void OrderManager::print_stats(std::ostream& os) const {
-    os << "\n=== ORDER MANAGER STATISTICS ===" << std::endl;
-    os << "Active Orders: " << size() << std::endl;
-    os << "Total Orders Added: " << total_orders_added_ << std::endl;
-    os << "Total Orders Cancelled: " << total_orders_cancelled_ << std::endl;
-    os << "Order Struct Size: " << sizeof(Order) << " bytes" << std::endl;
-    os << "Memory Usage (estimate): " << (size() * sizeof(Order)) << " bytes" << std::endl;
-    os << std::endl;
-}
+    // Read the whole file into out itself: the header is one record long,
+    // so the records parse in place and only need shifting down over it
+    const std::streamoff end = file.tellg();
+    if (end < 0) return OrderStatus::IoError;
+    const size_t size = static_cast<size_t>(end);
+    out.assign((size + sizeof(Order) - 1) / sizeof(Order), Order());
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(size))) {
+        out.clear();
+        return OrderStatus::IoError;
+    }
 
-void OrderManager::clear() {
-    orders_.clear();
-    order_ptrs_.clear();
-    snapshot_dirty_ = false;
-    total_orders_added_ = 0;
-    total_orders_cancelled_ = 0;
+    const Order* orders = nullptr;
+    size_t count = 0;
+    const OrderStatus status =
+        parse_binary_snapshot(reinterpret_cast<const char*>(out.data()), size, orders, count);
+    if (status != OrderStatus::Ok) {
+        out.clear();
+        return status;
+    }
+    static_assert(sizeof(BinaryHeader) == sizeof(Order), "the header occupies exactly one record");
+    out.erase(out.begin());
+    out.resize(count);
+    return OrderStatus::Ok;
 }
 
-void OrderManager::rebuild_snapshot_cache() const {
-    if (!snapshot_dirty_) return;
-    
-    order_ptrs_.clear();
-    order_ptrs_.reserve(orders_.size());  // Pre-allocate to avoid reallocations
-    
-    for (const auto& [id, order] : orders_) {
-        order_ptrs_.push_back(&order);
+OrderStatus write_binary_snapshot(std::FILE* out, const std::vector<Order>& orders) {
+    BinaryHeader header{};
+    std::copy(std::begin(kBinaryMagic), std::end(kBinaryMagic), header.magic);
+    header.version = kBinaryVersion;
+    header.record_size = sizeof(Order);
+    header.count = orders.size();
+    if (std::fwrite(&header, sizeof(header), 1, out) != 1 ||
+        std::fwrite(orders.data(), sizeof(Order), orders.size(), out) != orders.size()) {
+        return OrderStatus::IoError;
     }
-    
-    snapshot_dirty_ = false;
+    return OrderStatus::Ok;
 }
 
-std::unique_ptr<Order> OrderManager::parse_csv_line(const std::string& line) const {
-    std::istringstream iss(line);
-    std::string token;
-    
-    try {
-        // Parse order ID
-        if (!std::getline(iss, token, ',')) return nullptr;
-        uint64_t id = std::stoull(token);
-        
-        // Parse price
-        if (!std::getline(iss, token, ',')) return nullptr;
-        double price = std::stod(token);
-        
-        // Parse quantity
-        if (!std::getline(iss, token, ',')) return nullptr;
-        uint32_t quantity = std::stoul(token);
-        
-        // Parse side (0=buy, 1=sell)
-        if (!std::getline(iss, token, ',')) return nullptr;
-        uint32_t side = std::stoul(token);
-        
-        // Validate side
-        if (side > 1) return nullptr;
-        
-        return std::make_unique<Order>(id, price, quantity, side);
-        
-    } catch (const std::exception& e) {
-        // Invalid format, return nullptr
-        return nullptr;
+OrderStatus parse_binary_snapshot(const char* data, size_t size, const Order*& orders, size_t& count) {
+    BinaryHeader header;
+    if (size < sizeof(header)) return OrderStatus::ParseError;
+    std::memcpy(&header, data, sizeof(header));
+    if (!std::equal(std::begin(kBinaryMagic), std::end(kBinaryMagic), header.magic) ||
+        header.version != kBinaryVersion || header.record_size != sizeof(Order) ||
+        header.count > (size - sizeof(header)) / sizeof(Order)) {
+        return OrderStatus::ParseError;
     }
-} 
\ No newline at end of file
+    orders = reinterpret_cast<const Order*>(data + sizeof(header));
+    count = static_cast<size_t>(header.count);
+    return OrderStatus::Ok;
+}
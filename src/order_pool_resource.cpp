@@ -0,0 +1,66 @@
+#include "../include/order_pool_resource.hpp"
+#include <algorithm>
+#include <iterator>
+
+OrderPoolResource::OrderPoolResource(std::pmr::memory_resource* upstream, size_t slab_bytes)
+    : upstream_(upstream),
+      // A slab must hold its header plus at least one block of every class
+      slab_bytes_(std::max(slab_bytes, sizeof(Slab) + kMaxBlock)) {}
+
+OrderPoolResource::~OrderPoolResource() {
+    release();
+}
+
+void OrderPoolResource::release() {
+    while (slabs_) {
+        Slab* next = slabs_->next;
+        upstream_->deallocate(slabs_, slabs_->bytes, alignof(Slab));
+        slabs_ = next;
+    }
+    std::fill(std::begin(free_), std::end(free_), nullptr);
+    cursor_ = end_ = nullptr;
+    reserved_ = 0;
+}
+
+void* OrderPoolResource::do_allocate(size_t bytes, size_t alignment) {
+    if (!pooled(bytes, alignment)) {
+        return upstream_->allocate(bytes, alignment);
+    }
+
+    const size_t cls = size_class(bytes);
+    if (FreeBlock* block = free_[cls]) {
+        free_[cls] = block->next;
+        return block;
+    }
+    return refill(cls);
+}
+
+void OrderPoolResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    if (!pooled(bytes, alignment)) {
+        upstream_->deallocate(p, bytes, alignment);
+        return;
+    }
+
+    const size_t cls = size_class(bytes);
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->next = free_[cls];
+    free_[cls] = block;
+}
+
+void* OrderPoolResource::refill(size_t cls) {
+    const size_t block_bytes = kAlign << cls;
+    if (static_cast<size_t>(end_ - cursor_) < block_bytes) {
+        // The tail of the old slab is abandoned; it is at most kMaxBlock bytes
+        Slab* slab = static_cast<Slab*>(upstream_->allocate(slab_bytes_, alignof(Slab)));
+        slab->next = slabs_;
+        slab->bytes = slab_bytes_;
+        slabs_ = slab;
+        cursor_ = reinterpret_cast<char*>(slab + 1);
+        end_ = reinterpret_cast<char*>(slab) + slab_bytes_;
+        reserved_ += slab_bytes_;
+    }
+
+    void* block = cursor_;
+    cursor_ += block_bytes;
+    return block;
+}
@@ -0,0 +1,88 @@
+#include "../include/snapshot_writer.hpp"
+
+namespace {
+// Buffers kept for reuse; beyond this, returned buffers are simply freed
+constexpr size_t kMaxSpareBuffers = 4;
+}
+
+SnapshotWriter::SnapshotWriter() : worker_([this] { run(); }) {}
+
+SnapshotWriter::~SnapshotWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+std::vector<Order> SnapshotWriter::take_buffer() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spare_.empty()) return {};
+    std::vector<Order> buffer = std::move(spare_.back());
+    spare_.pop_back();
+    return buffer;
+}
+
+void SnapshotWriter::submit(std::vector<Order> orders, bool sorted, const std::string& filename,
+                            SnapshotFormat format) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Job& job : pending_) {
+            if (job.filename == filename) {
+                // Newer capture wins; the old buffer goes back to the pool
+                job.orders.swap(orders);
+                job.sorted = sorted;
+                job.format = format;
+                superseded_++;
+                if (spare_.size() < kMaxSpareBuffers) spare_.push_back(std::move(orders));
+                return;
+            }
+        }
+        pending_.push_back(Job{filename, std::move(orders), sorted, format});
+    }
+    wake_.notify_one();
+}
+
+void SnapshotWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return pending_.empty() && !busy_; });
+}
+
+uint64_t SnapshotWriter::written() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return written_;
+}
+
+uint64_t SnapshotWriter::superseded() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return superseded_;
+}
+
+uint64_t SnapshotWriter::failed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+void SnapshotWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+        if (pending_.empty()) {
+            return;  // Stopping, and everything queued has been written
+        }
+
+        Job job = std::move(pending_.front());
+        pending_.pop_front();
+        busy_ = true;
+        lock.unlock();
+
+        const OrderStatus status = save_snapshot(job.filename, job.orders, job.sorted, job.format);
+
+        lock.lock();
+        busy_ = false;
+        (status == OrderStatus::Ok ? written_ : failed_)++;
+        if (spare_.size() < kMaxSpareBuffers) spare_.push_back(std::move(job.orders));
+        if (pending_.empty()) idle_.notify_all();
+    }
+}
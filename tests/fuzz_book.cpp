@@ -0,0 +1,465 @@
+// Differential fuzzer: every backend against a reference model, in lockstep
+//
+// Random add/cancel/modify/execute/mass-cancel/expiry sequences drive the
+// three book configurations and a deliberately naive model side by side.
+// Every op compares statuses, sizes, side totals and the state hash (which
+// covers every resting order's ID, price, quantity and side); every
+// kFullCheckInterval ops and at the end of each episode the whole book is
+// compared order by order, in priority order on the sorted backends, along
+// with the touch and queue positions. A failing episode is shrunk to a
+// minimal op sequence and printed.
+//
+// Usage: fuzz_book [ops] [seed] [--break-model]
+// --break-model plants a priority bug in the model to show the shrinker.
+
+#include "../include/order_manager.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr double kBasePrice = 100.00;
+constexpr double kTick = 0.01;
+constexpr int32_t kPriceTicks = 64;
+constexpr uint64_t kIds = 512;           // Small, so cancels and duplicates hit
+constexpr AccountId kAccounts = 4;       // Plus kNoAccount
+constexpr size_t kEpisodeOps = 10000;    // Ops per fresh set of books
+constexpr size_t kFullCheckInterval = 4096;
+
+bool break_model = false;
+
+enum class OpKind : uint8_t { Add, Cancel, Modify, Execute, CancelAll, Advance };
+
+struct Op {
+    OpKind kind;
+    uint8_t side;
+    int32_t ticks;
+    uint32_t quantity;
+    AccountId account;
+    uint64_t id;
+    Timestamp time;  // Expiry of an Add, clock step of an Advance
+};
+
+double price_of(int32_t ticks) { return kBasePrice + ticks * kTick; }
+
+std::string describe(const Op& op) {
+    std::ostringstream os;
+    switch (op.kind) {
+        case OpKind::Add:
+            os << "add id=" << op.id << " side=" << int(op.side) << " price=" << price_of(op.ticks)
+               << " qty=" << op.quantity << " account=" << op.account << " expires=" << op.time;
+            break;
+        case OpKind::Cancel:    os << "cancel id=" << op.id; break;
+        case OpKind::Modify:
+            os << "modify id=" << op.id << " price=" << price_of(op.ticks) << " qty=" << op.quantity;
+            break;
+        case OpKind::Execute:   os << "execute id=" << op.id << " qty=" << op.quantity; break;
+        case OpKind::CancelAll: os << "cancel_all account=" << op.account; break;
+        case OpKind::Advance:   os << "advance_time +" << op.time; break;
+    }
+    return os.str();
+}
+
+class Rng {
+    uint64_t state_;
+
+public:
+    explicit Rng(uint64_t seed) : state_(mix64(seed) | 1) {}
+    uint64_t next() {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 0x2545F4914F6CDD1Dull;
+    }
+    uint64_t below(uint64_t n) { return next() % n; }
+};
+
+Op random_op(Rng& rng) {
+    Op op{};
+    op.id = 1 + rng.below(kIds);
+    op.ticks = static_cast<int32_t>(rng.below(kPriceTicks));
+    op.quantity = 1 + static_cast<uint32_t>(rng.below(100));
+    op.side = static_cast<uint8_t>(rng.below(2));
+    const uint64_t roll = rng.below(100);
+    if (roll < 40) {
+        op.kind = OpKind::Add;
+        op.account = static_cast<AccountId>(rng.below(kAccounts + 1));
+        op.time = rng.below(5) == 0 ? 1 + rng.below(200) : 0;  // Relative; 0 = no expiry
+    } else if (roll < 60) {
+        op.kind = OpKind::Cancel;
+    } else if (roll < 75) {
+        op.kind = OpKind::Modify;
+        op.quantity = static_cast<uint32_t>(rng.below(120));  // 0 cancels
+    } else if (roll < 90) {
+        op.kind = OpKind::Execute;
+        op.quantity = 1 + static_cast<uint32_t>(rng.below(120));
+    } else if (roll < 93) {
+        op.kind = OpKind::CancelAll;
+        op.account = static_cast<AccountId>(1 + rng.below(kAccounts));
+    } else {
+        op.kind = OpKind::Advance;
+        op.time = 1 + rng.below(50);
+    }
+    return op;
+}
+
+/**
+ * @brief The specification: a flat array of orders and brute-force queries
+ */
+class ReferenceBook {
+    struct Entry {
+        bool live = false;
+        Order order;
+        AccountId account = kNoAccount;
+        Timestamp expiry = kNoExpiry;
+        uint64_t arrival = 0;  // Time priority
+    };
+
+    std::vector<Entry> entries_ = std::vector<Entry>(kIds + 1);
+    Timestamp now_ = 0;
+    uint64_t arrivals_ = 0;
+    uint64_t hash_ = 0;
+    uint64_t quantity_[2] = {0, 0};
+    size_t size_ = 0;
+
+    // Every change of a live entry goes through these two
+    void forget(const Entry& entry) {
+        hash_ -= order_mix(entry.order);
+        quantity_[entry.order.side] -= entry.order.quantity;
+    }
+
+    void count(const Entry& entry) {
+        hash_ += order_mix(entry.order);
+        quantity_[entry.order.side] += entry.order.quantity;
+    }
+
+    void remove(Entry& entry) {
+        forget(entry);
+        entry.live = false;
+        size_--;
+    }
+
+public:
+    Timestamp now() const { return now_; }
+    size_t size() const { return size_; }
+    uint64_t hash() const { return hash_; }
+
+    OrderStatus add(const Order& order, const OrderOptions& options) {
+        if (options.expires_at != kNoExpiry && options.expires_at <= now_) return OrderStatus::Expired;
+        Entry& entry = entries_[order.id];
+        if (entry.live) return OrderStatus::Duplicate;
+        entry = Entry{true, order, options.account, options.expires_at, arrivals_++};
+        count(entry);
+        size_++;
+        return OrderStatus::Ok;
+    }
+
+    OrderStatus cancel(uint64_t id) {
+        if (!entries_[id].live) return OrderStatus::UnknownId;
+        remove(entries_[id]);
+        return OrderStatus::Ok;
+    }
+
+    OrderStatus execute(uint64_t id, uint32_t quantity) {
+        Entry& entry = entries_[id];
+        if (!entry.live) return OrderStatus::UnknownId;
+        if (quantity >= entry.order.quantity) {
+            remove(entry);
+        } else {
+            forget(entry);
+            entry.order.quantity -= quantity;
+            count(entry);
+        }
+        return OrderStatus::Ok;
+    }
+
+    OrderStatus modify(uint64_t id, double price, uint32_t quantity) {
+        if (quantity == 0) return cancel(id);
+        Entry& entry = entries_[id];
+        if (!entry.live) return OrderStatus::UnknownId;
+        const bool keeps_priority = price == entry.order.price &&
+                                    (quantity <= entry.order.quantity || break_model);
+        forget(entry);
+        entry.order.price = price;
+        entry.order.quantity = quantity;
+        count(entry);
+        if (!keeps_priority) entry.arrival = arrivals_++;
+        return OrderStatus::Ok;
+    }
+
+    size_t cancel_all(AccountId account) {
+        size_t cancelled = 0;
+        for (Entry& entry : entries_) {
+            if (entry.live && entry.account == account) {
+                remove(entry);
+                cancelled++;
+            }
+        }
+        return cancelled;
+    }
+
+    size_t advance(Timestamp now) {
+        size_t expired = 0;
+        for (Entry& entry : entries_) {
+            if (entry.live && entry.expiry != kNoExpiry && entry.expiry <= now) {
+                remove(entry);
+                expired++;
+            }
+        }
+        now_ = std::max(now_, now);
+        return expired;
+    }
+
+    uint64_t side_quantity(Side side) const { return quantity_[static_cast<size_t>(side)]; }
+
+    // Bids best to worst, then asks best to worst; FIFO within a price
+    std::vector<Order> priority_order() const {
+        std::vector<const Entry*> live;
+        for (const Entry& entry : entries_) {
+            if (entry.live) live.push_back(&entry);
+        }
+        std::sort(live.begin(), live.end(), [](const Entry* a, const Entry* b) {
+            if (a->order.side != b->order.side) return a->order.side < b->order.side;
+            if (a->order.price != b->order.price) {
+                return a->order.is_buy() ? a->order.price > b->order.price
+                                         : a->order.price < b->order.price;
+            }
+            return a->arrival < b->arrival;
+        });
+        std::vector<Order> out;
+        for (const Entry* entry : live) out.push_back(entry->order);
+        return out;
+    }
+
+    // Quantity ahead of id at its price
+    uint64_t queue_ahead(uint64_t id) const {
+        const Entry& target = entries_[id];
+        uint64_t ahead = 0;
+        for (const Entry& entry : entries_) {
+            if (entry.live && entry.order.side == target.order.side &&
+                entry.order.price == target.order.price && entry.arrival < target.arrival) {
+                ahead += entry.order.quantity;
+            }
+        }
+        return ahead;
+    }
+
+    bool live(uint64_t id) const { return entries_[id].live; }
+};
+
+bool same_order(const Order& a, const Order& b) {
+    return a.id == b.id && a.price == b.price && a.quantity == b.quantity && a.side == b.side;
+}
+
+// Apply op to a book; returns the status, and the count for bulk ops
+template <typename Book>
+OrderStatus apply(Book& book, const Op& op, size_t& count) {
+    count = 0;
+    switch (op.kind) {
+        case OpKind::Add: {
+            OrderOptions options{op.account};
+            options.expires_at = op.time ? book.current_time() + op.time : kNoExpiry;
+            return book.try_add_order(Order(op.id, price_of(op.ticks), op.quantity, op.side), options);
+        }
+        case OpKind::Cancel:    return book.try_cancel_order(op.id);
+        case OpKind::Modify:    return book.try_modify_order(op.id, price_of(op.ticks), op.quantity);
+        case OpKind::Execute:   return book.try_execute_order(op.id, op.quantity);
+        case OpKind::CancelAll: count = book.cancel_all(op.account); return OrderStatus::Ok;
+        case OpKind::Advance:   count = book.advance_time(book.current_time() + op.time); return OrderStatus::Ok;
+    }
+    return OrderStatus::Ok;
+}
+
+OrderStatus apply(ReferenceBook& model, const Op& op, size_t& count) {
+    count = 0;
+    switch (op.kind) {
+        case OpKind::Add: {
+            OrderOptions options{op.account};
+            options.expires_at = op.time ? model.now() + op.time : kNoExpiry;
+            return model.add(Order(op.id, price_of(op.ticks), op.quantity, op.side), options);
+        }
+        case OpKind::Cancel:    return model.cancel(op.id);
+        case OpKind::Modify:    return model.modify(op.id, price_of(op.ticks), op.quantity);
+        case OpKind::Execute:   return model.execute(op.id, op.quantity);
+        case OpKind::CancelAll: count = model.cancel_all(op.account); return OrderStatus::Ok;
+        case OpKind::Advance:   count = model.advance(model.now() + op.time); return OrderStatus::Ok;
+    }
+    return OrderStatus::Ok;
+}
+
+// Per-op checks: O(1) on the book
+template <typename Book>
+std::string quick_check(const Book& book, const ReferenceBook& model) {
+    if (book.size() != model.size()) return "size";
+    if (book.state_hash() != model.hash()) return "state hash";
+    if (book.side_quantity(Side::Buy) != model.side_quantity(Side::Buy)) return "bid quantity";
+    if (book.side_quantity(Side::Sell) != model.side_quantity(Side::Sell)) return "ask quantity";
+    return "";
+}
+
+// Whole-book checks: every order, plus the touch and queue positions on
+// the sorted policies
+template <typename Book>
+std::string full_check(Book& book, const ReferenceBook& model) {
+    const std::vector<Order> expected = model.priority_order();
+    std::vector<Order> actual;
+    book.for_each_order([&actual](const Order& order) { actual.push_back(order); });
+    if (actual.size() != expected.size()) return "order count";
+    if constexpr (!Book::kPriceQueries) {
+        // No time priority: ties come in index order
+        auto by_id = [](const Order& a, const Order& b) { return a.id < b.id; };
+        std::vector<Order> sorted_expected = expected;
+        std::sort(actual.begin(), actual.end(), by_id);
+        std::sort(sorted_expected.begin(), sorted_expected.end(), by_id);
+        for (size_t i = 0; i < actual.size(); ++i) {
+            if (!same_order(actual[i], sorted_expected[i])) return "resting orders";
+        }
+    } else {
+        for (size_t i = 0; i < actual.size(); ++i) {
+            if (!same_order(actual[i], expected[i])) return "priority order";
+        }
+        for (const Order& order : expected) {
+            uint64_t ahead = 0;
+            if (book.queue_position(order.id, ahead) != OrderStatus::Ok ||
+                ahead != model.queue_ahead(order.id)) {
+                return "queue position";
+            }
+        }
+        for (Side side : {Side::Buy, Side::Sell}) {
+            const LevelQuote quote = book.best_quote(side);
+            double best = 0.0;
+            uint64_t quantity = 0;
+            uint32_t orders = 0;
+            for (const Order& order : expected) {
+                if (order.side != static_cast<uint32_t>(side)) continue;
+                if (orders == 0) best = order.price;
+                if (order.price != best) break;
+                quantity += order.quantity;
+                orders++;
+            }
+            // Level prices are rebuilt from ticks: equal up to rounding
+            if (quote.orders != orders || quote.quantity != quantity ||
+                (orders && std::fabs(quote.price - best) > kTick * 1e-6)) {
+                return "best quote";
+            }
+        }
+    }
+    return "";
+}
+
+struct Books {
+    OrderManager unsorted;
+    TreeOrderManager tree;
+    LadderOrderManager ladder{LadderLevels(kBasePrice, kTick, kPriceTicks), DirectIndex(kIds + 1)};
+    ReferenceBook model;
+};
+
+struct Failure {
+    size_t op = 0;           // Index of the op after which the books diverged
+    std::string what;
+};
+
+template <typename Book>
+std::string step_backend(const char* name, Book& book, const Op& op, OrderStatus expected,
+                         size_t expected_count, const ReferenceBook& model, bool full) {
+    size_t count = 0;
+    const OrderStatus status = apply(book, op, count);
+    std::string what;
+    if (status != expected) {
+        what = std::string("status ") + status_name(status) + ", model " + status_name(expected);
+    } else if (count != expected_count) {
+        what = "count " + std::to_string(count) + ", model " + std::to_string(expected_count);
+    } else {
+        what = quick_check(book, model);
+        if (what.empty() && full) what = full_check(book, model);
+    }
+    return what.empty() ? what : std::string(name) + ": " + what;
+}
+
+// Run ops on fresh books; empty what if every check passed
+Failure run(const std::vector<Op>& ops, bool full_every_op) {
+    Books books;
+    for (size_t i = 0; i < ops.size(); ++i) {
+        size_t count = 0;
+        const OrderStatus expected = apply(books.model, ops[i], count);
+        const bool full = full_every_op || (i + 1) % kFullCheckInterval == 0 || i + 1 == ops.size();
+        std::string what = step_backend("unsorted", books.unsorted, ops[i], expected, count, books.model, full);
+        if (what.empty()) what = step_backend("tree", books.tree, ops[i], expected, count, books.model, full);
+        if (what.empty()) what = step_backend("ladder", books.ladder, ops[i], expected, count, books.model, full);
+        if (!what.empty()) return Failure{i, what};
+    }
+    return Failure{};
+}
+
+// Drop chunks of ops, halving the chunk size, while the failure persists
+std::vector<Op> shrink(std::vector<Op> ops) {
+    for (size_t chunk = ops.size() / 2; chunk >= 1; chunk /= 2) {
+        for (size_t begin = 0; begin < ops.size();) {
+            std::vector<Op> candidate;
+            candidate.reserve(ops.size());
+            candidate.insert(candidate.end(), ops.begin(), ops.begin() + begin);
+            candidate.insert(candidate.end(), ops.begin() + std::min(ops.size(), begin + chunk), ops.end());
+            const Failure failure = run(candidate, true);
+            if (!failure.what.empty()) {
+                // Keep the prefix up to the divergence only
+                candidate.resize(failure.op + 1);
+                ops = std::move(candidate);
+            } else {
+                begin += chunk;
+            }
+        }
+    }
+    return ops;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t total_ops = 2000000;
+    uint64_t seed = 1;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--break-model") == 0) {
+            break_model = true;
+        } else if (positional++ == 0) {
+            total_ops = std::strtoull(argv[i], nullptr, 10);
+        } else {
+            seed = std::strtoull(argv[i], nullptr, 10);
+        }
+    }
+
+    std::cout << "Fuzzing " << total_ops << " ops (seed " << seed
+              << ") against the reference model..." << std::endl;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Op> ops;
+    for (size_t done = 0, episode = 0; done < total_ops; done += ops.size(), ++episode) {
+        Rng rng(seed * 1000003 + episode);
+        ops.clear();
+        const size_t n = std::min(kEpisodeOps, total_ops - done);
+        for (size_t i = 0; i < n; ++i) ops.push_back(random_op(rng));
+
+        const Failure failure = run(ops, false);
+        if (failure.what.empty()) continue;
+
+        std::cout << "DIVERGENCE in episode " << episode << " after op " << failure.op << ": "
+                  << failure.what << std::endl;
+        ops.resize(failure.op + 1);
+        const std::vector<Op> minimal = shrink(ops);
+        std::cout << "Shrunk to " << minimal.size() << " ops (" << run(minimal, true).what << "):"
+                  << std::endl;
+        for (const Op& op : minimal) std::cout << "  " << describe(op) << std::endl;
+        return 1;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "No divergence: " << total_ops << " ops in " << seconds << " s ("
+              << static_cast<uint64_t>(total_ops / std::max(seconds, 1e-9))
+              << " ops/s, each applied to 3 backends and the model)" << std::endl;
+    return 0;
+}
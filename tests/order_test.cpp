@@ -1,6 +1,25 @@
 #include "../include/order_manager.hpp"
+#include "../include/book_history.hpp"
+#include "../include/checkpoint_index.hpp"
+#include "../include/command_pipe.hpp"
+#include "../include/external_id_book.hpp"
+#include "../include/fork_snapshot.hpp"
+#include "../include/order_pool_resource.hpp"
+#include "../include/snapshot_writer.hpp"
+#include "../include/striped_book.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <csignal>
+#include <cstddef>
+#include <cstdio>
 #include <iostream>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 // Simple test framework
 #define TEST(name) void test_##name()
@@ -94,7 +113,1475 @@ TEST(ordermanager_clear) {
     ASSERT(manager.size() == 0);
 }
 
+TEST(ordermanager_batch_add) {
+    OrderManager manager;
+    manager.add_order(Order(2, 151.25, 200, 1));
+    
+    std::vector<Order> batch;
+    for (uint64_t id = 1; id <= 200; ++id) {
+        batch.emplace_back(id, 150.00 + id * 0.01, 10, id % 2);
+    }
+    batch.emplace_back(5, 160.00, 50, 0); // Duplicate within the batch
+    
+    OrderStatus results[201];
+    size_t added = manager.add_orders(batch.data(), batch.size(), results);
+    ASSERT(added == 199);
+    ASSERT(results[0] == OrderStatus::Ok);
+    ASSERT(results[1] == OrderStatus::Duplicate);   // ID 2 was already resting
+    ASSERT(results[200] == OrderStatus::Duplicate); // Second ID 5 in the same batch
+    ASSERT(manager.size() == 200);
+    ASSERT(manager.get_order(5)->price == 150.05);
+}
+
+TEST(ordermanager_batch_cancel) {
+    OrderManager manager;
+    for (uint64_t id = 1; id <= 100; ++id) {
+        manager.add_order(Order(id, 150.00, 10, 0));
+    }
+    
+    std::vector<uint64_t> ids = {1, 2, 2, 999, 100};
+    OrderStatus results[5];
+    ASSERT(manager.cancel_orders(ids.data(), ids.size(), results) == 3);
+    ASSERT(results[0] == OrderStatus::Ok && results[1] == OrderStatus::Ok);
+    ASSERT(results[2] == OrderStatus::UnknownId && results[3] == OrderStatus::UnknownId);
+    ASSERT(results[4] == OrderStatus::Ok);
+    ASSERT(manager.size() == 97);
+}
+
+TEST(flat_hash_map_incremental_rehash) {
+    FlatHashMap<uint64_t> map;
+    ASSERT(map.rehash_policy() == RehashPolicy::Incremental);
+    
+    bool saw_rehash = false;
+    for (uint64_t key = 0; key < 5000; ++key) {
+        ASSERT(map.insert(key, key * 3).second);
+        saw_rehash |= map.rehashing();
+        // Every key must stay reachable while old slots are migrating
+        if (map.rehashing()) {
+            ASSERT(*map.find(key / 2) == (key / 2) * 3);
+        }
+    }
+    ASSERT(saw_rehash);
+    ASSERT(!map.insert(42, 0).second);
+    
+    for (uint64_t key = 0; key < 5000; key += 2) {
+        ASSERT(map.erase(key));
+    }
+    ASSERT(map.size() == 2500);
+    for (uint64_t key = 0; key < 5000; ++key) {
+        ASSERT((map.find(key) != nullptr) == (key % 2 == 1));
+    }
+}
+
+TEST(flat_hash_map_churn) {
+    // Sequential keys, most erased soon after, a third left behind: live
+    // keys spread over many table-sized blocks
+    auto kept = [](uint64_t key) { return (key * 0x9e3779b97f4a7c15ull >> 61) < 3; };
+    FlatHashMap<uint64_t> map;
+    for (uint64_t key = 1; key <= 300000; ++key) {
+        ASSERT(map.insert(key, key).second);
+        if (key > 5 && !kept(key - 5)) ASSERT(map.erase(key - 5));
+    }
+    for (uint64_t key = 1; key <= 300000; ++key) {
+        const uint64_t* value = map.find(key);
+        if (kept(key) || key > 300000 - 5) {
+            ASSERT(value && *value == key);
+        } else {
+            ASSERT(!value);
+        }
+    }
+}
+
+TEST(flat_hash_map_churn_probes) {
+    // A full book of sequential IDs, then cancel a random one and add the
+    // next: no lookup, in either table while rehashing, may walk far
+    constexpr size_t kLive = 100000;
+    constexpr size_t kLongest = 256;
+    FlatHashMap<uint64_t> map;
+    std::vector<uint64_t> ids;
+    uint64_t next = 1;
+    for (; next <= kLive; ++next) {
+        ASSERT(map.insert(next, next).second);
+        ids.push_back(next);
+    }
+    // Cancel and re-add across the freshly filled map, still rehashing
+    ASSERT(map.rehashing());
+    for (uint64_t id = 1; id <= kLive; id += kLive / 64) {
+        ASSERT(map.erase(id));
+        ASSERT(map.probe_count(id) <= kLongest);
+        ASSERT(map.insert(id, id).second);
+    }
+
+    std::mt19937_64 gen(3);
+    bool saw_rehash = false;
+    for (size_t op = 0; op < 4 * kLive; ++op) {
+        uint64_t& victim = ids[gen() % ids.size()];
+        ASSERT(map.probe_count(victim) <= kLongest);
+        ASSERT(map.erase(victim));
+        ASSERT(map.probe_count(next) <= kLongest);
+        ASSERT(map.insert(next, next).second);
+        saw_rehash |= map.rehashing();
+        victim = next++;
+    }
+    ASSERT(saw_rehash);
+    ASSERT(map.size() == kLive);
+}
+
+TEST(ordermanager_reserve_and_load_factor) {
+    OrderManager manager;
+    manager.set_max_load_factor(0.5f);
+    ASSERT(manager.max_load_factor() == 0.5f);
+    manager.reserve(1000);
+    
+    manager.set_rehash_policy(RehashPolicy::Immediate);
+    for (uint64_t id = 1; id <= 1000; ++id) {
+        ASSERT(manager.add_order(Order(id, 150.00, 10, 0)));
+    }
+    ASSERT(manager.size() == 1000);
+    ASSERT(manager.get_order(1000)->id == 1000);
+}
+
+// Test alternative backends
+template <typename Book>
+std::vector<uint64_t> snapshot_ids(const Book& book) {
+    std::vector<uint64_t> ids;
+    book.for_each_order([&ids](const Order& order) { ids.push_back(order.id); });
+    return ids;
+}
+
+TEST(tree_backend_price_time_order) {
+    TreeOrderManager book;
+    ASSERT(book.add_order(Order(1, 150.00, 100, 0)));
+    ASSERT(book.add_order(Order(2, 151.00, 100, 0)));
+    ASSERT(book.add_order(Order(3, 150.00, 100, 0)));
+    ASSERT(book.add_order(Order(4, 152.00, 100, 1)));
+    ASSERT(book.add_order(Order(5, 151.50, 100, 1)));
+    ASSERT(!book.add_order(Order(6, 151.505, 100, 1))); // Off the tick grid
+    ASSERT(!book.add_order(Order(1, 149.00, 100, 0)));  // Duplicate ID
+    
+    // Bids best first with FIFO inside a level, then asks best first
+    ASSERT((snapshot_ids(book) == std::vector<uint64_t>{2, 1, 3, 5, 4}));
+    ASSERT(book.levels().level_count() == 4);
+    
+    ASSERT(book.cancel_order(1));
+    ASSERT(book.cancel_order(5));
+    ASSERT((snapshot_ids(book) == std::vector<uint64_t>{2, 3, 4}));
+    ASSERT(book.levels().level_count() == 3);
+}
+
+TEST(ladder_backend_price_time_order) {
+    LadderOrderManager book(LadderLevels(100.00, 0.01, 10000), DirectIndex(1000));
+    ASSERT(book.add_order(Order(1, 150.00, 100, 0)));
+    ASSERT(book.add_order(Order(2, 151.00, 100, 0)));
+    ASSERT(book.add_order(Order(3, 150.00, 100, 0)));
+    ASSERT(book.add_order(Order(4, 152.00, 100, 1)));
+    ASSERT(book.add_order(Order(5, 151.50, 100, 1)));
+    ASSERT(!book.add_order(Order(6, 200.00, 100, 1)));  // Outside the ladder
+    ASSERT(!book.add_order(Order(1000, 150.00, 100, 0))); // Outside the ID range
+    
+    ASSERT((snapshot_ids(book) == std::vector<uint64_t>{2, 1, 3, 5, 4}));
+    
+    // Emptying the best levels moves best price tracking inward
+    ASSERT(book.cancel_order(2));
+    ASSERT(book.cancel_order(5));
+    ASSERT((snapshot_ids(book) == std::vector<uint64_t>{1, 3, 4}));
+    ASSERT(book.get_order(3)->price == 150.00);
+    ASSERT(book.get_order(2) == nullptr);
+    
+    book.clear();
+    ASSERT(book.empty());
+    ASSERT(snapshot_ids(book).empty());
+}
+
+TEST(side_specialized_best_tracking) {
+    static_assert(SideTraits<Side::Buy>::better(151, 150), "higher bid is better");
+    static_assert(SideTraits<Side::Sell>::better(150, 151), "lower ask is better");
+    
+    TreeOrderManager tree;
+    LadderOrderManager ladder(LadderLevels(100.00, 0.01, 10000));
+    const Order orders[] = {
+        Order(1, 150.00, 100, 0), Order(2, 150.50, 100, 0),
+        Order(3, 151.00, 100, 1), Order(4, 150.75, 100, 1),
+    };
+    tree.add_orders(orders, 4);
+    ladder.add_orders(orders, 4);
+    
+    const auto& tree_levels = tree.levels();
+    ASSERT(tree_levels.side<Side::Buy>().best_ticks() == 15050);
+    ASSERT(tree_levels.side<Side::Sell>().best_ticks() == 15075);
+    
+    const auto& ladder_levels = ladder.levels();
+    ASSERT(ladder_levels.ticks_at(ladder_levels.side<Side::Buy>().best_index()) == 15050);
+    ASSERT(ladder_levels.ticks_at(ladder_levels.side<Side::Sell>().best_index()) == 15075);
+    
+    tree.cancel_order(2);
+    tree.cancel_order(4);
+    ladder.cancel_order(2);
+    ladder.cancel_order(4);
+    ASSERT(tree_levels.side<Side::Buy>().best_ticks() == 15000);
+    ASSERT(tree_levels.side<Side::Sell>().best_ticks() == 15100);
+    ASSERT(ladder_levels.ticks_at(ladder_levels.side<Side::Buy>().best_index()) == 15000);
+    ASSERT(ladder_levels.ticks_at(ladder_levels.side<Side::Sell>().best_index()) == 15100);
+    
+    tree.cancel_order(1);
+    ladder.cancel_order(3);
+    ASSERT(!tree_levels.side<Side::Buy>().has_best());
+    ASSERT(!ladder_levels.side<Side::Sell>().has_best());
+}
+
 // Test CSV parsing
+TEST(book_on_memory_resource) {
+    // Upstream is the null resource: any allocation escaping the arena throws
+    std::vector<std::byte> buffer(std::size_t{4} << 20);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(),
+                                              std::pmr::null_memory_resource());
+    {
+        TreeOrderManager book(TreeLevels(0.01, &arena), HashIndex(&arena), &arena);
+        for (uint64_t id = 1; id <= 5000; ++id) {
+            ASSERT(book.add_order(Order(id, 100.00 + (id % 50) * 0.01, 10, id % 2)));
+        }
+        for (uint64_t id = 1; id <= 5000; id += 2) {
+            ASSERT(book.cancel_order(id));
+        }
+        ASSERT(book.size() == 2500);
+        ASSERT(book.levels().side<Side::Buy>().best_ticks() == 10048);
+    }
+    
+    OrderPoolResource pool;
+    {
+        OrderManager book(&pool);
+        LadderOrderManager ladder(LadderLevels(100.00, 0.01, 1000, &pool), DirectIndex(&pool), &pool);
+        for (uint64_t id = 1; id <= 100; ++id) {
+            ASSERT(book.add_order(Order(id, 100.00 + id * 0.01, 10, id % 2)));
+            ASSERT(ladder.add_order(Order(id, 100.00 + id * 0.01, 10, id % 2)));
+        }
+        ASSERT(book.size() == 100 && ladder.size() == 100);
+    }
+    
+    // Small blocks are recycled LIFO; large ones bypass the pool
+    void* a = pool.allocate(48);
+    pool.deallocate(a, 48);
+    ASSERT(pool.allocate(64) == a);
+    const size_t reserved = pool.slab_bytes_reserved();
+    void* big = pool.allocate(1 << 16);
+    ASSERT(pool.slab_bytes_reserved() == reserved);
+    pool.deallocate(big, 1 << 16);
+    pool.release();
+    ASSERT(pool.slab_bytes_reserved() == 0);
+}
+
+TEST(status_codes) {
+    TreeOrderManager book;
+    ASSERT(book.try_add_order(Order(1, 150.00, 100, 0)) == OrderStatus::Ok);
+    ASSERT(book.try_add_order(Order(1, 150.00, 100, 0)) == OrderStatus::Duplicate);
+    ASSERT(book.try_add_order(Order(2, 150.005, 100, 0)) == OrderStatus::InvalidPrice);
+    ASSERT(book.try_cancel_order(2) == OrderStatus::UnknownId);
+    ASSERT(book.try_cancel_order(1) == OrderStatus::Ok);
+    
+    LadderOrderManager ladder(LadderLevels(100.00, 0.01, 10000), DirectIndex(1000));
+    ASSERT(ladder.try_add_order(Order(999, 150.00, 100, 0)) == OrderStatus::Ok);
+    ASSERT(ladder.try_add_order(Order(1000, 150.00, 100, 0)) == OrderStatus::BookFull);
+    ASSERT(ladder.try_add_order(Order(5, 99.99, 100, 1)) == OrderStatus::InvalidPrice);
+    
+    OrderManager unsorted;
+    ASSERT(unsorted.try_add_order(Order(1, std::nan(""), 100, 0)) == OrderStatus::InvalidPrice);
+    
+    Order order;
+    ASSERT(parse_order_csv_line(" 7, 150.25 ,300,1\r", order) == OrderStatus::Ok);
+    ASSERT(order.id == 7 && order.price == 150.25 && order.quantity == 300 && !order.is_buy());
+    ASSERT(parse_order_csv_line("7,150.25,300,2", order) == OrderStatus::ParseError);
+    ASSERT(parse_order_csv_line("7,abc,300,0", order) == OrderStatus::ParseError);
+    ASSERT(parse_order_csv_line("7,150.25,300", order) == OrderStatus::ParseError);
+    ASSERT(parse_order_csv_line("7,150.25,99999999999,0", order) == OrderStatus::ParseError);
+    
+    OrderStatus status = OrderStatus::Ok;
+    ASSERT(unsorted.load_from_csv("does_not_exist.csv", &status) == 0);
+    ASSERT(status == OrderStatus::IoError);
+    ASSERT(unsorted.print_snapshot_to_file("no_such_dir/snapshot.txt") == OrderStatus::IoError);
+}
+
+TEST(background_snapshot_writer) {
+    OrderManager unsorted;
+    TreeOrderManager tree;
+    for (uint64_t id = 1; id <= 200; ++id) {
+        Order order(id, 100.00 + id * 0.01, 10, id % 2);
+        unsorted.add_order(order);
+        tree.add_order(order);
+    }
+    
+    std::ostringstream expected_unsorted, expected_tree;
+    unsorted.print_snapshot(expected_unsorted);
+    tree.print_snapshot(expected_tree);
+    
+    {
+        SnapshotWriter writer;
+        writer.request(unsorted, "temp_snapshot_unsorted.txt");
+        writer.request(tree, "temp_snapshot_tree.txt");
+        unsorted.clear();  // The captures are independent of the live book
+        writer.request(unsorted, "no_such_dir/snapshot.txt");
+        writer.flush();
+        ASSERT(writer.written() == 2);
+        ASSERT(writer.failed() == 1);
+    }
+    
+    auto read_file = [](const char* name) {
+        std::ifstream file(name);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    };
+    ASSERT(read_file("temp_snapshot_unsorted.txt") == expected_unsorted.str());
+    ASSERT(read_file("temp_snapshot_tree.txt") == expected_tree.str());
+    std::remove("temp_snapshot_unsorted.txt");
+    std::remove("temp_snapshot_tree.txt");
+}
+
+TEST(fork_snapshot_dump) {
+    OrderManager book;
+    for (uint64_t id = 1; id <= 500; ++id) {
+        book.add_order(Order(id, 100.00 + id * 0.01, 10, id % 2));
+    }
+    std::ostringstream expected;
+    book.print_snapshot(expected);
+    std::vector<Order> captured;
+    book.capture_snapshot(captured);
+    
+    ForkSnapshotter dumper;
+    ASSERT(dumper.start(book, "temp_fork_snapshot.txt") == OrderStatus::Ok);
+    // The parent keeps mutating; the child still writes the book as of the fork
+    for (uint64_t id = 1; id <= 500; id += 2) {
+        book.cancel_order(id);
+    }
+    dumper.wait();
+    ASSERT(dumper.stats().dumps == 1 && dumper.stats().failures == 0);
+    ASSERT(!dumper.busy());
+    
+    std::ifstream text("temp_fork_snapshot.txt");
+    std::stringstream contents;
+    contents << text.rdbuf();
+    ASSERT(contents.str() == expected.str());
+    
+    // Binary round trip, from the pre-cancel capture
+    ASSERT(save_snapshot("temp_fork_snapshot.bin", captured, false, SnapshotFormat::Binary) == OrderStatus::Ok);
+    std::vector<Order> loaded;
+    ASSERT(load_binary_snapshot("temp_fork_snapshot.bin", loaded) == OrderStatus::Ok);
+    ASSERT(loaded.size() == captured.size());
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        ASSERT(loaded[i].id == captured[i].id && loaded[i].price == captured[i].price);
+    }
+    ASSERT(load_binary_snapshot("temp_fork_snapshot.txt", loaded) == OrderStatus::ParseError);
+    
+#ifdef SIGCHLD
+    // With SIGCHLD ignored the child is reaped by the system and waitpid
+    // fails: the dump's outcome is unknown, so it counts as failed
+    void (*previous)(int) = std::signal(SIGCHLD, SIG_IGN);
+    ForkSnapshotter lost;
+    ASSERT(lost.start(book, "temp_fork_snapshot.txt") == OrderStatus::Ok);
+    lost.wait();
+    std::signal(SIGCHLD, previous);
+    ASSERT(!lost.busy());
+    ASSERT(lost.stats().dumps == 0 && lost.stats().failures == 1);
+#endif
+    
+    std::remove("temp_fork_snapshot.txt");
+    std::remove("temp_fork_snapshot.bin");
+}
+
+TEST(radix_snapshot_sort) {
+    // Key order matches price order, including negative prices
+    ASSERT(snapshot_key<Side::Sell>(-1.5) < snapshot_key<Side::Sell>(-0.5));
+    ASSERT(snapshot_key<Side::Sell>(-0.5) < snapshot_key<Side::Sell>(0.25));
+    ASSERT(snapshot_key<Side::Buy>(150.01) < snapshot_key<Side::Buy>(150.00));
+    
+    // Large enough to take the parallel path; compare with a stable sort
+    using Item = KeyedItem<uint32_t>;
+    std::vector<Item> items, scratch;
+    uint64_t state = 88172645463325252ULL;
+    for (uint32_t i = 0; i < (1u << 20) + 7; ++i) {
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        items.push_back(Item{state % 100000, i});
+    }
+    std::vector<Item> expected = items;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const Item& a, const Item& b) { return a.key < b.key; });
+    radix_sort(items, scratch);
+    for (size_t i = 0; i < items.size(); ++i) {
+        ASSERT(items[i].key == expected[i].key && items[i].value == expected[i].value);
+    }
+    
+    // Snapshot order: bids high to low, then asks low to high
+    std::vector<Order> orders = {
+        Order(1, 100.50, 1, 1), Order(2, 99.00, 1, 0), Order(3, 101.25, 1, 0),
+        Order(4, 100.25, 1, 1), Order(5, 100.00, 1, 0),
+    };
+    sort_snapshot(orders);
+    const uint64_t expected_ids[] = {3, 5, 2, 4, 1};
+    for (size_t i = 0; i < orders.size(); ++i) {
+        ASSERT(orders[i].id == expected_ids[i]);
+    }
+}
+
+// Same queries against every level policy
+template <typename Book>
+void check_top_and_range(Book& book) {
+    // Bids 100.05 x2 (ids 1, 2), 100.03, 100.00; asks 100.10, 100.12 x2 (5, 6)
+    book.add_order(Order(1, 100.05, 10, 0));
+    book.add_order(Order(2, 100.05, 20, 0));
+    book.add_order(Order(3, 100.03, 30, 0));
+    book.add_order(Order(4, 100.00, 40, 0));
+    book.add_order(Order(7, 100.10, 15, 1));
+    book.add_order(Order(5, 100.12, 25, 1));
+    book.add_order(Order(6, 100.12, 35, 1));
+    
+    Order top[8];
+    ASSERT(book.top_orders(Side::Buy, 3, top) == 3);
+    ASSERT(top[0].id == 1 && top[1].id == 2 && top[2].id == 3);
+    ASSERT(book.top_orders(Side::Sell, 8, top) == 3);
+    ASSERT(top[0].id == 7 && top[1].id == 5 && top[2].id == 6);
+    ASSERT(book.top_orders(Side::Buy, 0, top) == 0);
+    
+    // Bounds are inclusive and need not lie on the grid
+    std::vector<uint64_t> ids;
+    auto collect = [&](const Order& order) { ids.push_back(order.id); };
+    book.orders_in_range(Side::Buy, 100.00, 100.04, collect);
+    ASSERT((ids == std::vector<uint64_t>{3, 4}));
+    ids.clear();
+    book.orders_in_range(Side::Sell, 100.105, 200.0, collect);
+    ASSERT((ids == std::vector<uint64_t>{5, 6}));
+    ids.clear();
+    book.orders_in_range(Side::Buy, 99.00, 99.99, collect);
+    book.orders_in_range(Side::Sell, 100.13, 100.11, collect);
+    ASSERT(ids.empty());
+    
+    // Queries see cancellations
+    book.cancel_order(1);
+    ASSERT(book.top_orders(Side::Buy, 1, top) == 1 && top[0].id == 2);
+    book.orders_in_range(Side::Buy, 0.0, 1000.0, collect);
+    ASSERT((ids == std::vector<uint64_t>{2, 3, 4}));
+}
+
+// The unsorted policy has no price order to walk: the queries are absent
+// rather than an O(book) sort behind every call
+template <typename Book, typename = void>
+struct HasPriceQueries : std::false_type {};
+template <typename Book>
+struct HasPriceQueries<Book, std::void_t<decltype(std::declval<const Book&>().top_orders(Side::Buy, 1, nullptr)),
+                                         decltype(std::declval<const Book&>().best_quote(Side::Buy))>>
+    : std::true_type {};
+static_assert(!HasPriceQueries<OrderManager>::value && !OrderManager::kPriceQueries,
+              "no price-ordered queries on the unsorted policy");
+static_assert(HasPriceQueries<TreeOrderManager>::value && HasPriceQueries<LadderOrderManager>::value,
+              "price-ordered queries on the sorted policies");
+
+TEST(top_orders_and_price_range) {
+    TreeOrderManager tree;
+    LadderOrderManager ladder(LadderLevels(100.00, 0.01, 1000), DirectIndex(100));
+    check_top_and_range(tree);
+    check_top_and_range(ladder);
+}
+
+template <typename Book>
+void check_analytics(Book& book) {
+    ASSERT(book.best_quote(Side::Buy).empty());
+    ASSERT(std::isnan(book.microprice()));
+    ASSERT(book.imbalance(5) == 0.0);
+    
+    book.add_order(Order(1, 100.00, 300, 0));
+    book.add_order(Order(2, 100.00, 100, 0));
+    book.add_order(Order(3, 99.90, 500, 0));
+    book.add_order(Order(4, 100.10, 100, 1));
+    book.add_order(Order(5, 100.20, 200, 1));
+    
+    const LevelQuote bid = book.best_quote(Side::Buy);
+    ASSERT(bid.price == 100.00 && bid.quantity == 400 && bid.orders == 2);
+    ASSERT(std::fabs(book.mid_price() - 100.05) < 1e-9);
+    // (100.00 * 100 + 100.10 * 400) / 500: leans toward the thin ask
+    ASSERT(std::fabs(book.microprice() - 100.08) < 1e-9);
+    ASSERT(book.depth_quantity(Side::Buy, 1) == 400 && book.depth_quantity(Side::Buy, 9) == 900);
+    ASSERT(std::fabs(book.imbalance(1) - 0.6) < 1e-9);
+    ASSERT(std::fabs(book.imbalance(2) - 0.5) < 1e-9);
+    
+    // Sweep 250 of the asks: 100 @ 100.10 and 150 @ 100.20
+    uint64_t filled = 0;
+    const double vwap = book.vwap_for_quantity(Side::Sell, 250, &filled);
+    ASSERT(filled == 250 && std::fabs(vwap - (100.10 * 100 + 100.20 * 150) / 250) < 1e-9);
+    book.vwap_for_quantity(Side::Sell, 1000, &filled);
+    ASSERT(filled == 300);
+    
+    // Fills update the level and the totals; a full fill removes the order
+    ASSERT(book.execute_order(1, 250));
+    ASSERT(book.get_order(1)->quantity == 50);
+    ASSERT(book.best_quote(Side::Buy).quantity == 150);
+    ASSERT(book.side_quantity(Side::Buy) == 650 && book.side_orders(Side::Buy) == 3);
+    ASSERT(book.execute_order(4, 500));
+    ASSERT(book.get_order(4) == nullptr);
+    ASSERT(book.best_quote(Side::Sell).price == 100.20);
+    ASSERT(book.try_execute_order(4, 1) == OrderStatus::UnknownId);
+    ASSERT(book.side_quantity(Side::Sell) == 200 && book.side_orders(Side::Sell) == 1);
+    ASSERT(book.stats().executions() == 2);
+    
+    book.cancel_order(2);
+    ASSERT(book.side_quantity(Side::Buy) == 550);
+    book.clear();
+    ASSERT(book.side_quantity(Side::Buy) == 0 && book.side_orders(Side::Sell) == 0);
+}
+
+TEST(incremental_book_analytics) {
+    TreeOrderManager tree;
+    LadderOrderManager ladder(LadderLevels(99.00, 0.01, 1000), DirectIndex(100));
+    check_analytics(tree);
+    check_analytics(ladder);
+}
+
+TEST(fenwick_cumulative_depth) {
+    // Prefix sums and lower_bound against a plain array
+    FenwickTree tree(100);
+    std::vector<int64_t> values(100, 0);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (int step = 0; step < 2000; ++step) {
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        const size_t i = state % 100;
+        const int64_t delta = static_cast<int64_t>(state >> 40) % 50;
+        tree.add(i, delta);
+        values[i] += delta;
+    }
+    int64_t sum = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        sum += values[i];
+        ASSERT(tree.prefix(static_cast<ptrdiff_t>(i)) == sum);
+        if (values[i] > 0) ASSERT(tree.lower_bound(sum) == i);
+    }
+    ASSERT(tree.prefix(-1) == 0);
+    ASSERT(tree.lower_bound(sum + 1) == tree.size());
+    
+    // Ladder (Fenwick) and tree (level walk) answer the same questions
+    TreeOrderManager walked;
+    LadderOrderManager indexed(LadderLevels(90.00, 0.01, 2000), DirectIndex(5000));
+    for (uint64_t id = 1; id <= 4000; ++id) {
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        const bool buy = id % 2;
+        const double price = (buy ? 9900 - static_cast<int64_t>(state % 500)
+                                  : 10001 + static_cast<int64_t>(state % 500)) * 0.01;
+        const Order order(id, price, 1 + state % 300, buy ? 0 : 1);
+        walked.add_order(order);
+        indexed.add_order(order);
+        if (id % 7 == 0) {
+            walked.cancel_order(id / 2);
+            indexed.cancel_order(id / 2);
+        }
+        if (id % 5 == 0) {
+            walked.execute_order(id - 3, 40);
+            indexed.execute_order(id - 3, 40);
+        }
+    }
+    for (Side side : {Side::Buy, Side::Sell}) {
+        for (double price : {0.0, 95.00, 98.50, 99.00, 100.01, 102.37, 200.0}) {
+            ASSERT(walked.depth_through(side, price) == indexed.depth_through(side, price));
+        }
+        for (uint64_t quantity : {1u, 1000u, 50000u, 100000000u}) {
+            const SweepEstimate a = walked.estimate_sweep(side, quantity);
+            const SweepEstimate b = indexed.estimate_sweep(side, quantity);
+            ASSERT(a.filled == b.filled && a.worst_price == b.worst_price);
+            ASSERT(std::fabs(a.notional - b.notional) < 1e-6 * a.notional);
+        }
+        ASSERT(indexed.depth_through(side, side == Side::Buy ? 0.0 : 200.0) ==
+               indexed.side_quantity(side));
+        ASSERT(std::isnan(indexed.price_at_depth(side, indexed.side_quantity(side) + 1)));
+    }
+    ASSERT(indexed.price_at_depth(Side::Buy, 1) == indexed.best_quote(Side::Buy).price);
+}
+
+// Quantity ahead of id by walking its level's FIFO
+template <typename Book>
+uint64_t walked_queue_position(const Book& book, uint64_t id) {
+    const Order* target = book.get_order(id);
+    uint64_t ahead = 0;
+    bool found = false;
+    book.orders_in_range(target->is_buy() ? Side::Buy : Side::Sell, target->price, target->price,
+                         [&](const Order& order) {
+                             if (order.id == id) found = true;
+                             if (!found) ahead += order.quantity;
+                         });
+    return ahead;
+}
+
+template <typename Book>
+void check_queue_positions(Book& book) {
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    uint64_t ahead = 0;
+    for (uint64_t id = 1; id <= 3000; ++id) {
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        // Few prices, so levels are deep and get renumbered as they grow
+        const double price = 100.00 + static_cast<int64_t>(state % 4) * 0.01;
+        book.add_order(Order(id, price, 1 + state % 100, 0));
+        if (id % 3 == 0) book.cancel_order(id - 2);
+        if (id % 4 == 0) book.execute_order(id - 1, 10);
+        if (id % 50 == 0) {
+            // Poll a few live orders, which starts tracking their levels
+            for (uint64_t back = 0; back < 50; back += 7) {
+                const uint64_t probe = id - back;
+                if (!book.get_order(probe)) continue;
+                ASSERT(book.queue_position(probe, ahead) == OrderStatus::Ok);
+                ASSERT(ahead == walked_queue_position(book, probe));
+            }
+        }
+    }
+    for (uint64_t id = 1; id <= 3000; ++id) {
+        if (!book.get_order(id)) continue;
+        ASSERT(book.queue_position(id, ahead) == OrderStatus::Ok);
+        ASSERT(ahead == walked_queue_position(book, id));
+    }
+    ASSERT(book.queue_position(999999, ahead) == OrderStatus::UnknownId);
+    
+    // Emptied levels hand their trackers back
+    for (uint64_t id = 1; id <= 3000; ++id) book.cancel_order(id);
+    ASSERT(book.levels().template side<Side::Buy>().tracked_levels() == 0);
+}
+
+TEST(queue_position_tracking) {
+    TreeOrderManager tree;
+    LadderOrderManager ladder(LadderLevels(99.00, 0.01, 1000), DirectIndex(4000));
+    check_queue_positions(tree);
+    check_queue_positions(ladder);
+    
+    OrderManager unsorted;
+    uint64_t ahead = 0;
+    unsorted.add_order(Order(1, 100.00, 10, 0));
+    ASSERT(unsorted.queue_position(1, ahead) == OrderStatus::Unsupported);
+}
+
+template <typename Book>
+void check_account_cancels(Book& book) {
+    // Accounts 7 and 9 interleaved over a few levels; id 100 has no account
+    for (uint64_t id = 1; id <= 40; ++id) {
+        const double price = 100.00 + static_cast<double>(id % 4) * 0.01;
+        book.add_order(Order(id, price, 10, id % 3 == 0 ? 1 : 0), OrderOptions{id % 2 ? 7u : 9u});
+    }
+    book.add_order(Order(100, 100.00, 10, 0));
+    ASSERT(book.account_of(3) == 7 && book.account_of(4) == 9);
+    ASSERT(book.account_of(100) == kNoAccount && book.account_of(12345) == kNoAccount);
+    ASSERT(book.account_orders(7) == 20 && book.account_orders(9) == 20);
+    
+    // By side and price range: account 7 buys at 100.01..100.02
+    size_t expected = 0;
+    for (uint64_t id = 1; id <= 40; id += 2) {
+        if (id % 3 != 0 && (id % 4 == 1 || id % 4 == 2)) expected++;
+    }
+    ASSERT(book.cancel_all(7, Side::Buy, 100.01, 100.02) == expected);
+    ASSERT(book.get_order(1) == nullptr && book.get_order(3) != nullptr);
+    
+    // By side, then everything left
+    const size_t sells = book.cancel_all(9, Side::Sell);
+    ASSERT(sells > 0 && book.get_order(6) == nullptr && book.get_order(4) != nullptr);
+    const size_t rest = book.cancel_all(9);
+    ASSERT(sells + rest == 20 && book.account_orders(9) == 0);
+    ASSERT(book.cancel_all(9) == 0);
+    
+    // Level aggregates and totals agree with what is left
+    uint64_t resting = 0;
+    book.for_each_order([&](const Order& order) { resting += order.quantity; });
+    ASSERT(resting == book.side_quantity(Side::Buy) + book.side_quantity(Side::Sell));
+    if constexpr (Book::kPriceQueries) {
+        ASSERT(book.depth_through(Side::Buy, 0.0) == book.side_quantity(Side::Buy));
+    }
+    ASSERT(book.size() == 1 + 20 - expected);
+    
+    // A handle freed by a mass cancel comes back without its old account
+    book.add_order(Order(200, 100.00, 10, 0));
+    ASSERT(book.account_of(200) == kNoAccount);
+    ASSERT(book.cancel_all(7) == 20 - expected);
+    ASSERT(book.size() == 2 && book.get_order(100) != nullptr);
+}
+
+TEST(account_mass_cancel) {
+    OrderManager unsorted;
+    TreeOrderManager tree;
+    LadderOrderManager ladder(LadderLevels(99.00, 0.01, 1000), DirectIndex(1000));
+    check_account_cancels(unsorted);
+    check_account_cancels(tree);
+    check_account_cancels(ladder);
+}
+
+template <typename Book>
+void check_expiry(Book& book) {
+    // Ids 1..6 expire at 10, 70, 4096, 1 << 40 and the session close (5000);
+    // id 7 never does
+    const Timestamp close = 5000;
+    const Timestamp deadlines[] = {10, 70, 4096, Timestamp{1} << 40, close, close};
+    for (uint64_t id = 1; id <= 6; ++id) {
+        OrderOptions options;
+        options.expires_at = deadlines[id - 1];
+        ASSERT(book.add_order(Order(id, 100.00 + static_cast<double>(id) * 0.01, 10, id % 2), options));
+    }
+    book.add_order(Order(7, 100.00, 10, 0));
+    ASSERT(book.pending_expiries() == 6 && book.expiry_of(3) == 4096);
+    ASSERT(book.expiry_of(7) == kNoExpiry && book.expiry_of(999) == kNoExpiry);
+    
+    // Nothing is due before 10; exactly one order at each deadline after
+    ASSERT(book.advance_time(9) == 0 && book.current_time() == 9);
+    ASSERT(book.advance_time(10) == 1 && book.get_order(1) == nullptr);
+    ASSERT(book.advance_time(4095) == 1 && book.get_order(2) == nullptr);
+    ASSERT(book.get_order(3) != nullptr);
+    
+    // A cancelled order's timer goes with it
+    ASSERT(book.cancel_order(3));
+    ASSERT(book.advance_time(4999) == 0 && book.pending_expiries() == 3);
+    
+    // Session close, then a jump far past the last timer
+    ASSERT(book.advance_time(close) == 2 && book.size() == 2);
+    ASSERT(book.advance_time(Timestamp{1} << 50) == 1);
+    ASSERT(book.size() == 1 && book.get_order(7) != nullptr);
+    ASSERT(book.stats().orders_expired() == 5);
+    ASSERT(book.side_quantity(Side::Buy) == 10 && book.side_quantity(Side::Sell) == 0);
+    
+    // The clock does not move back, and a past expiry is rejected
+    ASSERT(book.advance_time(100) == 0 && book.current_time() == Timestamp{1} << 50);
+    OrderOptions stale;
+    stale.expires_at = book.current_time();
+    ASSERT(book.try_add_order(Order(8, 100.00, 10, 0), stale) == OrderStatus::Expired);
+    ASSERT(book.get_order(8) == nullptr);
+    
+    // A handle freed by an expiry comes back without a timer
+    book.add_order(Order(9, 100.00, 10, 0));
+    ASSERT(book.expiry_of(9) == kNoExpiry);
+    ASSERT(book.advance_time(Timestamp{1} << 60) == 0 && book.size() == 2);
+}
+
+TEST(good_till_date_expiry) {
+    OrderManager unsorted;
+    TreeOrderManager tree;
+    LadderOrderManager ladder(LadderLevels(99.00, 0.01, 1000), DirectIndex(1000));
+    check_expiry(unsorted);
+    check_expiry(tree);
+    check_expiry(ladder);
+    
+    // Timers spread over every wheel level, advanced in uneven jumps: each
+    // step expires exactly the orders a scan of the deadlines finds due
+    LadderOrderManager book(LadderLevels(99.00, 0.01, 1000), DirectIndex(2000));
+    std::vector<Timestamp> due(2000, kNoExpiry);
+    uint64_t state = 88172645463325252ull;
+    auto next = [&state] {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    for (uint64_t id = 1; id < due.size(); ++id) {
+        OrderOptions options;
+        options.expires_at = 1 + (next() >> (next() % 64));
+        due[id] = options.expires_at;
+        ASSERT(book.add_order(Order(id, 100.00, 1, 0), options));
+    }
+    for (Timestamp now = 0; book.pending_expiries() > 0;) {
+        now += (next() >> (next() % 64)) + 1;
+        if (now < book.current_time()) now = ~Timestamp{0};
+        size_t expected = 0;
+        for (uint64_t id = 1; id < due.size(); ++id) {
+            if (due[id] != kNoExpiry && due[id] <= now) {
+                expected++;
+                due[id] = kNoExpiry;
+            }
+        }
+        ASSERT(book.advance_time(now) == expected);
+        ASSERT(book.size() == book.pending_expiries());
+    }
+    ASSERT(book.empty());
+}
+
+template <typename Book>
+void check_risk(Book& book) {
+    RiskLimits defaults;
+    defaults.max_order_quantity = 1000;
+    defaults.price_band = 0.05;
+    book.set_default_risk_limits(defaults);
+    book.set_reference_price(100.00);
+    
+    // Order-level checks apply with or without an account
+    ASSERT(book.try_add_order(Order(1, 100.00, 2000, 0)) == OrderStatus::OrderTooLarge);
+    ASSERT(book.try_add_order(Order(1, 106.00, 10, 1)) == OrderStatus::PriceOutOfBand);
+    ASSERT(book.try_add_order(Order(1, 94.00, 10, 0)) == OrderStatus::PriceOutOfBand);
+    ASSERT(book.try_add_order(Order(1, 104.00, 10, 1)) == OrderStatus::Ok);
+    ASSERT(book.account_risk(kNoAccount) == nullptr);
+    
+    // Position: open buys count as if filled
+    RiskLimits limits = defaults;
+    limits.max_position = 300;
+    ASSERT(book.set_risk_limits(5, limits));
+    ASSERT(book.try_add_order(Order(2, 100.00, 200, 0), OrderOptions{5}) == OrderStatus::Ok);
+    ASSERT(book.try_add_order(Order(3, 100.00, 150, 0), OrderOptions{5}) == OrderStatus::PositionLimit);
+    ASSERT(book.try_add_order(Order(3, 101.00, 300, 1), OrderOptions{5}) == OrderStatus::Ok);
+    ASSERT(book.get_order(3) != nullptr);
+    
+    // A fill turns open quantity into position and moves the reference
+    ASSERT(book.execute_order(2, 200));
+    const AccountRisk* risk = book.account_risk(5);
+    ASSERT(risk && risk->position == 200 && risk->open_buy == 0 && risk->open_sell == 300);
+    ASSERT(book.reference_price() == 100.00);
+    ASSERT(book.try_add_order(Order(4, 100.00, 150, 0), OrderOptions{5}) == OrderStatus::PositionLimit);
+    ASSERT(book.try_add_order(Order(4, 100.00, 100, 0), OrderOptions{5}) == OrderStatus::Ok);
+    ASSERT(book.try_add_order(Order(5, 101.00, 200, 1), OrderOptions{5}) == OrderStatus::Ok);
+    ASSERT(book.try_add_order(Order(6, 101.00, 1, 1), OrderOptions{5}) == OrderStatus::PositionLimit);
+    
+    // Open notional, released again by a cancel
+    limits = defaults;
+    limits.max_open_notional = 25000.0;
+    book.set_risk_limits(6, limits);
+    ASSERT(book.try_add_order(Order(7, 100.00, 200, 0), OrderOptions{6}) == OrderStatus::Ok);
+    ASSERT(book.try_add_order(Order(8, 100.00, 60, 0), OrderOptions{6}) == OrderStatus::NotionalLimit);
+    ASSERT(book.execute_order(7, 50));
+    ASSERT(book.account_risk(6)->open_notional == 15000.0);
+    ASSERT(book.cancel_order(7));
+    ASSERT(book.account_risk(6)->open_notional == 0.0);
+    ASSERT(book.try_add_order(Order(8, 100.00, 60, 0), OrderOptions{6}) == OrderStatus::Ok);
+    
+    // Accounts first seen take the defaults; a rejected order leaves no record
+    ASSERT(book.try_add_order(Order(9, 100.00, 1001, 0), OrderOptions{7}) == OrderStatus::OrderTooLarge);
+    ASSERT(book.account_risk(7) == nullptr);
+    
+    // A resting ID is a duplicate whatever limits its new terms break
+    ASSERT(book.try_add_order(Order(8, 100.00, 5000, 0), OrderOptions{6}) == OrderStatus::Duplicate);
+    ASSERT(book.try_add_order(Order(8, 100.00, 10, 0), OrderOptions{8}) == OrderStatus::Duplicate);
+    ASSERT(book.account_risk(8) == nullptr);
+    
+    // The band follows the last trade
+    ASSERT(book.execute_order(1, 5) && book.reference_price() == 104.00);
+    ASSERT(book.try_add_order(Order(10, 108.50, 10, 1)) == OrderStatus::Ok);
+    
+    // Mass cancels and expiries release exposure too
+    OrderOptions gtd{7};
+    gtd.expires_at = book.current_time() + 10;
+    ASSERT(book.add_order(Order(11, 104.00, 100, 0), gtd));
+    ASSERT(book.account_risk(7)->open_buy == 100);
+    ASSERT(book.advance_time(gtd.expires_at) == 1 && book.account_risk(7)->open_buy == 0);
+    book.cancel_all(5);
+    risk = book.account_risk(5);
+    ASSERT(risk->open_buy == 0 && risk->open_sell == 0 && risk->open_notional == 0.0);
+    ASSERT(risk->position == 200);
+}
+
+TEST(pre_trade_risk) {
+    OrderManager unsorted;
+    TreeOrderManager tree;
+    LadderOrderManager ladder(LadderLevels(90.00, 0.01, 2000), DirectIndex(1000));
+    check_risk(unsorted);
+    check_risk(tree);
+    check_risk(ladder);
+    
+    // Without a reference price the sorted books centre on the mid; the
+    // unsorted book keeps no touch to centre on and skips the band
+    RiskLimits band;
+    band.price_band = 0.01;
+    TreeOrderManager fresh_tree;
+    OrderManager fresh_unsorted;
+    fresh_tree.set_default_risk_limits(band);
+    fresh_unsorted.set_default_risk_limits(band);
+    ASSERT(fresh_unsorted.add_order(Order(1, 100.00, 10, 0)) && fresh_unsorted.add_order(Order(2, 101.00, 10, 1)));
+    ASSERT(fresh_unsorted.try_add_order(Order(3, 110.00, 10, 1)) == OrderStatus::Ok);
+    ASSERT(fresh_tree.add_order(Order(1, 100.00, 10, 0)) && fresh_tree.add_order(Order(2, 101.00, 10, 1)));
+    ASSERT(fresh_tree.try_add_order(Order(3, 110.00, 10, 1)) == OrderStatus::PriceOutOfBand);
+    ASSERT(fresh_tree.try_add_order(Order(3, 101.40, 10, 1)) == OrderStatus::Ok);
+    ASSERT(sizeof(AccountRisk) == 64 && alignof(AccountRisk) == 64);
+}
+
+// The same event stream on any backend; returns the sequence reached
+template <typename Book>
+uint64_t replay_events(Book& book) {
+    for (uint64_t id = 1; id <= 300; ++id) {
+        OrderOptions options{static_cast<AccountId>(id % 3 + 1)};
+        options.expires_at = id % 5 == 0 ? 50 : kNoExpiry;
+        book.add_order(Order(id, 100.00 + static_cast<double>(id % 17) * 0.01, 10 + id % 7, id % 2),
+                       options);
+        if (id % 4 == 0) book.cancel_order(id - 2);
+        if (id % 6 == 0) book.execute_order(id - 1, 3);
+    }
+    book.advance_time(50);
+    book.cancel_all(2, Side::Sell);
+    return book.sequence();
+}
+
+template <typename Book>
+uint64_t recomputed_hash(const Book& book) {
+    uint64_t sum = 0;
+    book.for_each_order([&sum](const Order& order) { sum += order_mix(order); });
+    return sum;
+}
+
+TEST(book_state_hash) {
+    OrderManager unsorted;
+    TreeOrderManager tree;
+    LadderOrderManager ladder(LadderLevels(99.00, 0.01, 1000), DirectIndex(1000));
+    ASSERT(unsorted.state_hash() == 0 && unsorted.sequence() == 0);
+    ladder.set_hash_trail(64);
+    
+    // Every backend reaches the same hash at the same sequence, and the
+    // incremental hash matches one recomputed from the resting orders
+    const uint64_t sequence = replay_events(unsorted);
+    ASSERT(replay_events(tree) == sequence && replay_events(ladder) == sequence);
+    ASSERT(unsorted.state_hash() == tree.state_hash() && tree.state_hash() == ladder.state_hash());
+    ASSERT(unsorted.state_hash() == recomputed_hash(unsorted));
+    
+    // Divergence shows at once: a fill of one lot changes the hash
+    const uint64_t before = tree.state_hash();
+    Order best;
+    ASSERT(tree.top_orders(Side::Buy, 1, &best) == 1);
+    tree.execute_order(best.id, 1);
+    ASSERT(tree.state_hash() != before && tree.state_hash() == recomputed_hash(tree));
+    ASSERT(tree.sequence() == sequence + 1);
+    
+    // Insertion order does not matter; add then cancel restores the hash
+    OrderManager forward;
+    OrderManager backward;
+    for (uint64_t i = 1; i <= 10; ++i) forward.add_order(Order(i, 100.00 + i, 5, i % 2));
+    for (uint64_t i = 10; i >= 1; --i) backward.add_order(Order(i, 100.00 + i, 5, i % 2));
+    ASSERT(forward.state_hash() == backward.state_hash());
+    const uint64_t settled = forward.state_hash();
+    forward.add_order(Order(99, 50.00, 5, 0));
+    forward.cancel_order(99);
+    ASSERT(forward.state_hash() == settled && forward.sequence() == 12);
+    
+    // The trail answers for the last 64 sequences, and only those
+    uint64_t hash = 0;
+    ASSERT(ladder.state_hash_at(sequence, hash) && hash == ladder.state_hash());
+    ASSERT(ladder.state_hash_at(sequence - 63, hash));
+    ASSERT(!ladder.state_hash_at(sequence - 64, hash));
+    ASSERT(!ladder.state_hash_at(sequence + 1, hash));
+    ladder.add_order(Order(999, 100.00, 1, 0));
+    ASSERT(ladder.state_hash_at(sequence, hash) && hash == unsorted.state_hash());
+    ASSERT(ladder.state_hash_at(sequence + 1, hash) && hash == ladder.state_hash());
+    
+    // Clearing empties the hash and counts as one step
+    ladder.clear();
+    ASSERT(ladder.state_hash() == 0 && ladder.sequence() == sequence + 2);
+}
+
+// Serves allocations from the heap until its allowance runs out, then
+// throws, as an exhausted arena does
+class LimitedResource : public std::pmr::memory_resource {
+public:
+    size_t allowance = SIZE_MAX;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (allowance == 0) throw std::bad_alloc();
+        allowance--;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+// Adds with accounts, expiries and risk until an allocation fails: the add
+// that hit it reports BookFull and leaves no trace, and the book carries on
+template <typename Book>
+void check_allocation_failure(Book& book, LimitedResource& resource, size_t allowance) {
+    book.set_default_risk_limits(RiskLimits());
+    resource.allowance = allowance;
+    OrderStatus status = OrderStatus::Ok;
+    uint64_t id = 0;
+    size_t added = 0;
+    while (status == OrderStatus::Ok && id < 20000) {
+        ++id;
+        OrderOptions options{static_cast<AccountId>(id % 3 + 1)};
+        options.expires_at = id % 2 ? 1000000 : kNoExpiry;
+        status = book.try_add_order(Order(id, 100.00 + static_cast<double>(id) * 0.01, 10, id % 2),
+                                    options);
+        added += status == OrderStatus::Ok;
+    }
+    ASSERT(status == OrderStatus::BookFull);
+    resource.allowance = SIZE_MAX;  // Reads below may allocate (the unsorted sort cache)
+    ASSERT(book.size() == added && book.get_order(id) == nullptr);
+    ASSERT(book.state_hash() == recomputed_hash(book));
+    size_t visited = 0;
+    book.for_each_order([&visited](const Order&) { visited++; });
+    ASSERT(visited == added);
+    
+    ASSERT(book.try_add_order(Order(id, 100.00, 10, 0), OrderOptions{1}) == OrderStatus::Ok);
+    ASSERT(book.cancel_all(1) + book.cancel_all(2) + book.cancel_all(3) == added + 1);
+    ASSERT(book.empty() && book.pending_expiries() == 0);
+}
+
+TEST(allocation_failure) {
+    // Every allowance fails a different allocation of the add path
+    for (size_t allowance = 0; allowance < 24; ++allowance) {
+        LimitedResource resource;
+        OrderManager unsorted(&resource);
+        TreeOrderManager tree(TreeLevels(0.01, &resource), HashIndex(&resource), &resource);
+        LadderOrderManager ladder(LadderLevels(100.00, 0.01, 30000, &resource),
+                                  DirectIndex(30000, &resource), &resource);
+        check_allocation_failure(unsorted, resource, allowance);
+        check_allocation_failure(tree, resource, allowance);
+        check_allocation_failure(ladder, resource, allowance);
+    }
+    
+    // A replace to a new price that cannot get a level leaves the order put
+    LimitedResource resource;
+    TreeOrderManager tree(TreeLevels(0.01, &resource), HashIndex(&resource), &resource);
+    ASSERT(tree.add_order(Order(1, 100.00, 10, 0)) && tree.add_order(Order(2, 100.00, 10, 0)));
+    resource.allowance = 0;
+    ASSERT(tree.try_modify_order(1, 101.00, 10) == OrderStatus::BookFull);
+    Order first;
+    ASSERT(tree.get_order(1)->price == 100.00 && tree.best_quote(Side::Buy).quantity == 20);
+    ASSERT(tree.top_orders(Side::Buy, 1, &first) == 1 && first.id == 1);  // Priority kept
+    ASSERT(tree.try_add_order(Order(3, 99.00, 10, 0)) == OrderStatus::BookFull);
+    // The node of a level that empties is kept for the next new level
+    resource.allowance = SIZE_MAX;
+    ASSERT(tree.add_order(Order(3, 99.00, 10, 0)) && tree.cancel_order(3));
+    resource.allowance = 0;
+    ASSERT(tree.try_add_order(Order(3, 98.00, 10, 0)) == OrderStatus::Ok);
+    ASSERT(tree.depth_quantity(Side::Buy, 2) == 30);
+}
+
+template <typename Book>
+void check_modify(Book& book) {
+    OrderOptions options{4};
+    options.expires_at = 100;
+    book.add_order(Order(1, 100.00, 10, 0), options);
+    book.add_order(Order(2, 100.00, 10, 0));
+    book.add_order(Order(3, 100.05, 10, 1));
+    
+    // Shrinking keeps priority; growing or repricing goes to the back
+    ASSERT(book.modify_order(1, 100.00, 4));
+    ASSERT(book.get_order(1)->quantity == 4 && book.side_quantity(Side::Buy) == 14);
+    if constexpr (Book::kPriceQueries) {
+        Order first;
+        ASSERT(book.top_orders(Side::Buy, 1, &first) == 1 && first.id == 1);
+        ASSERT(book.modify_order(1, 100.00, 12));
+        ASSERT(book.top_orders(Side::Buy, 1, &first) == 1 && first.id == 2);
+        ASSERT(book.modify_order(1, 100.02, 12));
+        ASSERT(book.top_orders(Side::Buy, 1, &first) == 1 && first.id == 1 && first.price == 100.02);
+        ASSERT(book.best_quote(Side::Buy).quantity == 12);
+    } else {
+        ASSERT(book.modify_order(1, 100.00, 12));
+        ASSERT(book.modify_order(1, 100.02, 12));
+    }
+    ASSERT(book.side_quantity(Side::Buy) == 22);
+    
+    // The order keeps its account and expiry through a replace
+    ASSERT(book.account_of(1) == 4 && book.expiry_of(1) == 100);
+    ASSERT(book.try_modify_order(9, 100.00, 1) == OrderStatus::UnknownId);
+    ASSERT(book.try_modify_order(1, std::nan(""), 1) == OrderStatus::InvalidPrice);
+    ASSERT(book.get_order(1)->price == 100.02);
+    ASSERT(book.state_hash() == order_mix(*book.get_order(1)) + order_mix(*book.get_order(2)) +
+                                order_mix(*book.get_order(3)));
+    
+    // A rejected replace leaves the order and its exposure as they were
+    RiskLimits limits;
+    limits.max_order_quantity = 50;
+    book.set_risk_limits(4, limits);
+    ASSERT(book.try_modify_order(1, 100.02, 60) == OrderStatus::OrderTooLarge);
+    ASSERT(book.get_order(1)->quantity == 12);
+    
+    // Quantity 0 cancels
+    ASSERT(book.modify_order(1, 100.02, 0) && book.get_order(1) == nullptr);
+    ASSERT(book.account_orders(4) == 0 && book.pending_expiries() == 0);
+    ASSERT(book.stats().orders_modified() == 3 && book.stats().orders_cancelled() == 1);
+}
+
+TEST(modify_orders) {
+    OrderManager unsorted;
+    TreeOrderManager tree;
+    LadderOrderManager ladder(LadderLevels(99.00, 0.01, 1000), DirectIndex(1000));
+    check_modify(unsorted);
+    check_modify(tree);
+    check_modify(ladder);
+}
+
+TEST(command_pipe) {
+    Command command;
+    ASSERT(parse_command_line("add 7 150.25 100 1", command) == OrderStatus::Ok);
+    ASSERT(command.kind == CommandKind::Add && command.id == 7 && command.price == 150.25 &&
+           command.quantity == 100 && command.side == 1);
+    ASSERT(parse_command_line("  modify 7\t151 50\r", command) == OrderStatus::Ok);
+    ASSERT(command.kind == CommandKind::Modify && command.price == 151.0 && command.quantity == 50);
+    ASSERT(parse_command_line("stats", command) == OrderStatus::Ok && command.kind == CommandKind::Stats);
+    ASSERT(parse_command_line("add 7 150.25 100 2", command) == OrderStatus::ParseError);
+    ASSERT(parse_command_line("cancel 7 8", command) == OrderStatus::ParseError);
+    ASSERT(parse_command_line("cancel x", command) == OrderStatus::ParseError);
+    ASSERT(parse_command_line("buy 7", command) == OrderStatus::ParseError);
+
+    // Text: comments and blank lines skipped, bad lines counted, last line unterminated
+    std::FILE* text = std::tmpfile();
+    ASSERT(text);
+    std::fputs("# script\nadd 1 150 100 0\n\nadd 2 151 100 1\nbogus\nexecute 1 40\ncancel 2", text);
+    std::rewind(text);
+    CommandReader text_reader(text);
+    Command commands[8];
+    ASSERT(text_reader.read(commands, 8) == 4);
+    ASSERT(!text_reader.binary() && text_reader.malformed() == 1);
+    ASSERT(commands[3].kind == CommandKind::Cancel && commands[3].id == 2);
+    ASSERT(text_reader.read(commands, 8) == 0);
+    std::fclose(text);
+
+    // Binary round trip, read back in small batches
+    std::FILE* binary = std::tmpfile();
+    ASSERT(binary);
+    ASSERT(write_command_header(binary) == OrderStatus::Ok);
+    ASSERT(write_commands(binary, commands, 4) == OrderStatus::Ok);
+    std::rewind(binary);
+    CommandReader binary_reader(binary);
+    Command decoded[4];
+    ASSERT(binary_reader.read(decoded, 3) == 3);
+    ASSERT(binary_reader.read(decoded + 3, 3) == 1);
+    ASSERT(binary_reader.binary() && binary_reader.malformed() == 0);
+    ASSERT(decoded[2].kind == CommandKind::Execute && decoded[2].quantity == 40);
+    std::fclose(binary);
+
+    // Batched and one-by-one application agree
+    Command script[6] = {commands[0], commands[1], commands[0], commands[2], commands[3], commands[3]};
+    OrderManager batched;
+    OrderManager single;
+    OrderStatus statuses[6];
+    std::ostringstream out;
+    ASSERT(apply_commands(batched, script, 6, out) == 2);
+    ASSERT(apply_commands(single, script, 6, out, statuses) == 2);
+    ASSERT(statuses[2] == OrderStatus::Duplicate && statuses[5] == OrderStatus::UnknownId);
+    ASSERT(batched.size() == 1 && single.size() == 1);
+    ASSERT(batched.get_order(1)->quantity == 60 && batched.state_hash() == single.state_hash());
+}
+
+TEST(external_order_ids) {
+    IdInterner ids;
+    InternalId a = kNoInternalId;
+    InternalId b = kNoInternalId;
+    ASSERT(ids.intern("ORD-20240101-000001", a) == OrderStatus::Ok && a == 0);
+    ASSERT(ids.intern("ORD-20240101-000002", b) == OrderStatus::Ok && b == 1);
+    InternalId again = kNoInternalId;
+    ASSERT(ids.intern("ORD-20240101-000001", again) == OrderStatus::Duplicate && again == a);
+    ASSERT(ids.intern("", again) == OrderStatus::ParseError);
+    ASSERT(ids.intern("123456789012345678901234", again) == OrderStatus::ParseError);
+    ASSERT(ids.intern("12345678901234567890123", again) == OrderStatus::Ok);
+    ASSERT(ids.find("ORD-20240101-000002") == b && ids.find("ORD-20240101-000003") == kNoInternalId);
+    ASSERT(ids.external_id(b) == "ORD-20240101-000002");
+
+    // Released IDs come back newest first; the old string no longer maps
+    ASSERT(ids.release(a) && !ids.release(a));
+    ASSERT(ids.find("ORD-20240101-000001") == kNoInternalId);
+    InternalId reused = kNoInternalId;
+    ASSERT(ids.intern("ORD-20240101-000009", reused) == OrderStatus::Ok && reused == a);
+    ASSERT(ids.size() == 3 && ids.id_range() == 3);
+
+    // Growth and tombstone churn keep every live key reachable
+    char text[24];
+    for (int i = 0; i < 5000; ++i) {
+        std::snprintf(text, sizeof(text), "C%08d", i);
+        InternalId id;
+        ASSERT(ids.intern(text, id) == OrderStatus::Ok);
+        if (i % 3 != 0) ASSERT(ids.release(id));
+    }
+    for (int i = 0; i < 5000; ++i) {
+        std::snprintf(text, sizeof(text), "C%08d", i);
+        const InternalId id = ids.find(text);
+        ASSERT((id != kNoInternalId) == (i % 3 == 0));
+        ASSERT(id == kNoInternalId || ids.external_id(id) == text);
+    }
+    ASSERT(ids.id_range() < 2000);  // Churned IDs were recycled
+
+    // An interner that cannot grow reports BookFull and keeps what it has
+    LimitedResource resource;
+    for (size_t allowance = 0; allowance < 8; ++allowance) {
+        IdInterner limited(&resource);
+        resource.allowance = allowance;
+        OrderStatus status = OrderStatus::Ok;
+        int added = 0;
+        for (; added < 100 && status == OrderStatus::Ok; ++added) {
+            std::snprintf(text, sizeof(text), "L%d", added);
+            InternalId id;
+            status = limited.intern(text, id);
+        }
+        resource.allowance = SIZE_MAX;
+        ASSERT(status == OrderStatus::BookFull && limited.size() == static_cast<size_t>(added - 1));
+        ASSERT(limited.find(text) == kNoInternalId);
+        for (int i = 0; i + 1 < added; ++i) {
+            std::snprintf(text, sizeof(text), "L%d", i);
+            const InternalId id = limited.find(text);
+            ASSERT(id != kNoInternalId && limited.release(id));
+        }
+        InternalId id;
+        ASSERT(limited.intern("AFTER", id) == OrderStatus::Ok);
+    }
+
+    // The book sees dense IDs; orders leaving it free their external ID
+    ExternalIdBook<LadderOrderManager> book(LadderOrderManager(LadderLevels(100.00, 0.01, 1000)));
+    ASSERT(book.try_add_order("BUY-1", 100.10, 100, 0) == OrderStatus::Ok);
+    ASSERT(book.try_add_order("SELL-1", 100.20, 50, 1) == OrderStatus::Ok);
+    ASSERT(book.try_add_order("BUY-1", 100.10, 100, 0) == OrderStatus::Duplicate);
+    ASSERT(book.try_add_order("BAD", 99.0, 10, 0) == OrderStatus::InvalidPrice);
+    ASSERT(book.internal_id("BAD") == kNoInternalId && book.size() == 2);
+    // No clock here, so nothing could expire an order or free its ID
+    OrderOptions options;
+    options.expires_at = 5000;
+    ASSERT(book.try_add_order("GTD-1", 100.10, 10, 0, options) == OrderStatus::Unsupported);
+    ASSERT(book.internal_id("GTD-1") == kNoInternalId && book.size() == 2);
+    options = OrderOptions();
+    options.account = 7;
+    ASSERT(book.try_add_order("ACCT-1", 100.10, 10, 0, options) == OrderStatus::Ok);
+    ASSERT(book.try_cancel_order("ACCT-1") == OrderStatus::Ok);
+    const Order* buy = book.get_order("BUY-1");
+    ASSERT(buy && buy->quantity == 100 && book.external_id(buy->id) == "BUY-1");
+    ASSERT(book.try_execute_order("BUY-1", 40) == OrderStatus::Ok);
+    ASSERT(book.get_order("BUY-1")->quantity == 60);
+    ASSERT(book.try_execute_order("BUY-1", 60) == OrderStatus::Ok);
+    ASSERT(book.internal_id("BUY-1") == kNoInternalId);
+    ASSERT(book.try_modify_order("SELL-1", 100.30, 0) == OrderStatus::Ok);
+    ASSERT(book.try_cancel_order("SELL-1") == OrderStatus::UnknownId);
+    ASSERT(book.size() == 0 && book.ids().size() == 0);
+    ASSERT(book.try_add_order("BUY-1", 100.10, 100, 0) == OrderStatus::Ok);
+    ASSERT(book.try_cancel_order("BUY-1") == OrderStatus::Ok);
+}
+
+TEST(striped_book) {
+    StripedBook<TreeLevels> book(8);
+    ASSERT(book.stripe_count() == 8);
+    ASSERT(book.try_add_order(Order(1, 100.10, 100, 0)) == OrderStatus::Ok);
+    ASSERT(book.try_add_order(Order(2, 100.20, 50, 1)) == OrderStatus::Ok);
+    ASSERT(book.try_add_order(Order(1, 100.30, 10, 1)) == OrderStatus::Duplicate);
+    ASSERT(book.try_add_order(Order(3, 100.005, 10, 0)) == OrderStatus::InvalidPrice);
+    ASSERT(book.try_cancel_order(3) == OrderStatus::UnknownId);
+    ASSERT(book.size() == 2);
+
+    // The stripe's copy follows fills and modifies, and goes with the order
+    Order copy;
+    ASSERT(book.try_execute_order(1, 40) == OrderStatus::Ok);
+    ASSERT(book.get_order(1, copy) && copy.quantity == 60);
+    ASSERT(book.try_modify_order(2, 100.30, 70) == OrderStatus::Ok);
+    ASSERT(book.get_order(2, copy) && copy.price == 100.30 && copy.quantity == 70);
+    ASSERT(book.best_quote(Side::Sell).price == 100.30);
+    ASSERT(book.try_modify_order(2, 100.305, 70) == OrderStatus::InvalidPrice);
+    ASSERT(book.try_modify_order(2, 100.30, 30) == OrderStatus::Ok && book.side_quantity(Side::Sell) == 30);
+    ASSERT(book.try_execute_order(1, 60) == OrderStatus::Ok);
+    ASSERT(!book.get_order(1, copy));
+    ASSERT(book.try_cancel_order(2) == OrderStatus::Ok && book.size() == 0);
+
+    // Writers on disjoint IDs, both sides: every order they kept is there
+    constexpr int kThreads = 4;
+    constexpr uint64_t kPerThread = 2000;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < kThreads; ++t) {
+        writers.emplace_back([&book, t] {
+            for (uint64_t i = 0; i < kPerThread; ++i) {
+                const uint64_t id = 1000 + t * kPerThread + i;
+                book.try_add_order(Order(id, 100.00 + (i % 50) * 0.01, 10, (i + t) % 2));
+                if (i % 4 == 1) book.try_cancel_order(id - 1);
+                if (i % 4 == 3) book.try_execute_order(id, 10);
+            }
+        });
+    }
+    for (std::thread& writer : writers) writer.join();
+    ASSERT(book.size() == kThreads * kPerThread / 2);
+    ASSERT(book.side_orders(Side::Buy) == kThreads * kPerThread / 4);
+    ASSERT(book.side_quantity(Side::Buy) == 10 * kThreads * kPerThread / 4);
+    ASSERT(book.get_order(1000 + 2, copy) && !book.get_order(1000 + 3, copy));
+
+    // The levels agree with the stripes they were built from
+    uint64_t resting = 0;
+    uint64_t orders = 0;
+    book.visit_levels(Side::Sell, [&](const LevelQuote& level) {
+        resting += level.quantity;
+        orders += level.orders;
+        return true;
+    });
+    ASSERT(resting == book.side_quantity(Side::Sell) && orders == book.side_orders(Side::Sell));
+
+    // Capacity is fixed up front: a full stripe refuses, others still take orders
+    StripedBook<LadderLevels> small(LadderLevels(100.00, 0.01, 100), 2, 8);
+    size_t added = 0;
+    for (uint64_t id = 1; id <= 64; ++id) {
+        added += small.try_add_order(Order(id, 100.10, 1, id % 2)) == OrderStatus::Ok;
+    }
+    ASSERT(added >= 8 && added < 16 && small.size() == added);
+    ASSERT(small.try_add_order(Order(100, 99.00, 1, 0)) == OrderStatus::InvalidPrice);
+    small.clear();
+    ASSERT(small.size() == 0 && small.try_add_order(Order(1, 100.10, 1, 0)) == OrderStatus::Ok);
+}
+
+// The history at n must match a TreeOrderManager fed the first n commands
+static void check_version(const BookVersion& version, const std::vector<Command>& commands) {
+    TreeOrderManager tree;
+    std::ostringstream ignored;
+    apply_commands(tree, commands.data(), version.sequence(), ignored);
+    ASSERT(version.size() == tree.size());
+    std::vector<Order> resting;
+    tree.capture_snapshot(resting);
+    for (const Order& order : resting) {
+        const Order* found = version.get_order(order.id);
+        ASSERT(found && found->price == order.price && found->quantity == order.quantity &&
+               found->side == order.side);
+    }
+    for (Side side : {Side::Buy, Side::Sell}) {
+        const LevelQuote expected = tree.best_quote(side);
+        const LevelQuote actual = version.best_quote(side);
+        ASSERT(actual.orders == expected.orders && actual.quantity == expected.quantity);
+        ASSERT(actual.empty() || actual.price == expected.price);
+        uint64_t depth = 0;
+        size_t levels = 0;
+        version.visit_levels(side, [&](const LevelQuote& level) {
+            depth += level.quantity;
+            return ++levels < 5;
+        });
+        ASSERT(depth == tree.depth_quantity(side, 5));
+    }
+}
+
+TEST(book_history) {
+    // Adds, cancels, fills and modifies over 400 IDs, some off the grid
+    std::vector<Command> commands;
+    uint64_t state = 12345;
+    auto next = [&state](uint64_t bound) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return (state >> 33) % bound;
+    };
+    for (int i = 0; i < 3000; ++i) {
+        Command command;
+        const uint64_t roll = next(100);
+        command.kind = roll < 45 ? CommandKind::Add : roll < 65 ? CommandKind::Cancel
+                     : roll < 85 ? CommandKind::Execute : CommandKind::Modify;
+        if (i == 1700) command.kind = CommandKind::Clear;
+        command.id = 1 + next(400);
+        command.side = static_cast<uint8_t>(next(2));
+        command.price = next(50) == 0 ? 100.005 : 100.00 + 0.01 * static_cast<double>(next(50));
+        command.quantity = static_cast<uint32_t>(next(200));
+        commands.push_back(command);
+    }
+
+    BookHistory history(0.01, 256);
+    TreeOrderManager tree;
+    std::ostringstream ignored;
+    BookVersion early = history.at(0);
+    for (size_t i = 0; i < commands.size(); ++i) {
+        OrderStatus expected;
+        apply_commands(tree, &commands[i], 1, ignored, &expected);
+        ASSERT(history.apply(commands[i]) == expected);
+        if (i == 300) early = history.at(256);
+    }
+    ASSERT(history.sequence() == 3000 && history.version_count() == 1 + 3000 / 256);
+    ASSERT(history.at(3000).size() == tree.size());
+
+    // Stored versions, replayed gaps, and a version taken long ago that
+    // later commands must not have disturbed
+    for (uint64_t n : {0, 1, 255, 256, 700, 1699, 1701, 2048, 2999, 3000}) {
+        check_version(history.at(n), commands);
+    }
+    check_version(early, commands);
+    ASSERT(history.at(5000).sequence() == 3000);
+}
+
+TEST(checkpoint_index) {
+    // A binary stream of adds, cancels and fills with a clock tick every 100
+    std::vector<Command> commands;
+    uint64_t state = 777;
+    auto next = [&state](uint64_t bound) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return (state >> 33) % bound;
+    };
+    for (int i = 0; i < 2000; ++i) {
+        Command command;
+        if (i % 100 == 0) {
+            command.kind = CommandKind::Time;
+            command.id = 1000 * static_cast<uint64_t>(i);
+        } else {
+            const uint64_t roll = next(100);
+            command.kind = roll < 55 ? CommandKind::Add : roll < 80 ? CommandKind::Cancel : CommandKind::Execute;
+            command.id = 1 + next(300);
+            command.side = static_cast<uint8_t>(next(2));
+            command.price = 100.00 + 0.01 * static_cast<double>(next(40));
+            command.quantity = static_cast<uint32_t>(1 + next(200));
+        }
+        commands.push_back(command);
+    }
+    std::FILE* input = std::tmpfile();
+    ASSERT(input);
+    ASSERT(write_command_header(input) == OrderStatus::Ok);
+    ASSERT(write_commands(input, commands.data(), commands.size()) == OrderStatus::Ok);
+    std::rewind(input);
+
+    // Replay in batches of 64, checkpointing after every 300 or so commands
+    TreeOrderManager book;
+    CheckpointWriter writer;
+    CommandReader reader(input);
+    Command batch[64];
+    std::ostringstream ignored;
+    uint64_t total = 0;
+    for (size_t n; (n = reader.read(batch, 64)) > 0;) {
+        apply_commands(book, batch, n, ignored);
+        total += n;
+        if (total / 300 == (total - n) / 300) continue;
+        if (!writer.is_open()) ASSERT(writer.open("temp_checkpoints", reader.binary()) == OrderStatus::Ok);
+        ASSERT(writer.write(book, total, reader.position()) == OrderStatus::Ok);
+    }
+    ASSERT(writer.count() == 6 && writer.close() == OrderStatus::Ok);
+
+    CheckpointIndex index;
+    CheckpointFile file;
+    ASSERT(index.load("temp_checkpoints") == OrderStatus::Ok && index.size() == 6);
+    ASSERT(index.binary_input() && file.open("temp_checkpoints") == OrderStatus::Ok);
+    ASSERT(index.at_sequence(299) == nullptr && index.at_sequence(320)->sequence == 320);
+    ASSERT(index.at_sequence(5000) == &index.entries().back());
+    ASSERT(index.at_time(650000)->timestamp == 600000 && index.at_time(0) == nullptr);
+
+    // Seeks land on the same book as a replay from the open
+    for (uint64_t target : {320, 321, 700, 1000, 1999, 2000}) {
+        const CheckpointEntry* entry = index.at_sequence(target);
+        TreeOrderManager seeked;
+        ASSERT(restore_checkpoint(file, *entry, seeked) == OrderStatus::Ok);
+        ASSERT(seeked.current_time() == entry->timestamp);
+        ASSERT(std::fseek(input, static_cast<long>(entry->input_offset), SEEK_SET) == 0);
+        CommandReader resumed(input, index.binary_input());
+        std::vector<Command> gap(target - entry->sequence + 1);
+        ASSERT(resumed.read(gap.data(), target - entry->sequence) == target - entry->sequence);
+        apply_commands(seeked, gap.data(), target - entry->sequence, ignored);
+
+        TreeOrderManager replayed;
+        apply_commands(replayed, commands.data(), target, ignored);
+        ASSERT(seeked.size() == replayed.size() && seeked.state_hash() == replayed.state_hash());
+        ASSERT(seeked.current_time() == replayed.current_time());
+        ASSERT(seeked.best_quote(Side::Buy).quantity == replayed.best_quote(Side::Buy).quantity);
+        ASSERT(seeked.best_quote(Side::Sell).price == replayed.best_quote(Side::Sell).price);
+    }
+    std::fclose(input);
+
+    // An entry past the data is refused, not read
+    CheckpointEntry bad = index.entries().back();
+    bad.offset = file.size() - 8;
+    TreeOrderManager unused;
+    ASSERT(restore_checkpoint(file, bad, unused) == OrderStatus::ParseError);
+
+    // A record the book rejects part-way leaves it empty, not half restored
+    const CheckpointEntry& last = index.entries().back();
+    LadderOrderManager narrow(LadderLevels(100.00, 0.01, 20));
+    ASSERT(narrow.try_add_order(Order(9999, 100.05, 10, 0)) == OrderStatus::Ok);
+    ASSERT(restore_checkpoint(file, last, narrow) == OrderStatus::InvalidPrice);
+    ASSERT(narrow.size() == 0 && !narrow.get_order(9999));
+
+    // Nothing beyond the records is kept, so books that need more are refused
+    TreeOrderManager risky;
+    risky.set_default_risk_limits(RiskLimits());
+    ASSERT(risky.try_add_order(Order(9999, 100.05, 10, 0)) == OrderStatus::Ok);
+    ASSERT(restore_checkpoint(file, last, risky) == OrderStatus::Unsupported && risky.size() == 1);
+    ASSERT(writer.open("temp_checkpoints_refused", true) == OrderStatus::Ok);
+    ASSERT(writer.write(risky, 1, 0) == OrderStatus::Unsupported);
+    TreeOrderManager owned;
+    OrderOptions options;
+    options.account = 7;
+    ASSERT(owned.try_add_order(Order(1, 100.05, 10, 0), options) == OrderStatus::Ok);
+    ASSERT(writer.write(owned, 1, 0) == OrderStatus::Unsupported);
+    options.account = kNoAccount;
+    options.expires_at = 5000;
+    ASSERT(owned.try_cancel_order(1) == OrderStatus::Ok);
+    ASSERT(owned.try_add_order(Order(1, 100.05, 10, 0), options) == OrderStatus::Ok);
+    ASSERT(writer.write(owned, 1, 0) == OrderStatus::Unsupported && writer.count() == 0);
+    ASSERT(writer.close() == OrderStatus::Ok);
+    std::remove("temp_checkpoints_refused.ckpt");
+    std::remove("temp_checkpoints_refused.ckix");
+    file.close();
+    std::remove("temp_checkpoints.ckpt");
+    std::remove("temp_checkpoints.ckix");
+    ASSERT(index.load("temp_checkpoints") == OrderStatus::IoError);
+}
+
 TEST(csv_parsing) {
     OrderManager manager;
     
@@ -125,6 +1612,35 @@ int main() {
     RUN_TEST(ordermanager_cancel_orders);
     RUN_TEST(ordermanager_get_order);
     RUN_TEST(ordermanager_clear);
+    RUN_TEST(ordermanager_batch_add);
+    RUN_TEST(ordermanager_batch_cancel);
+    RUN_TEST(flat_hash_map_incremental_rehash);
+    RUN_TEST(flat_hash_map_churn);
+    RUN_TEST(flat_hash_map_churn_probes);
+    RUN_TEST(ordermanager_reserve_and_load_factor);
+    RUN_TEST(tree_backend_price_time_order);
+    RUN_TEST(ladder_backend_price_time_order);
+    RUN_TEST(side_specialized_best_tracking);
+    RUN_TEST(book_on_memory_resource);
+    RUN_TEST(status_codes);
+    RUN_TEST(background_snapshot_writer);
+    RUN_TEST(fork_snapshot_dump);
+    RUN_TEST(radix_snapshot_sort);
+    RUN_TEST(top_orders_and_price_range);
+    RUN_TEST(incremental_book_analytics);
+    RUN_TEST(fenwick_cumulative_depth);
+    RUN_TEST(queue_position_tracking);
+    RUN_TEST(account_mass_cancel);
+    RUN_TEST(good_till_date_expiry);
+    RUN_TEST(pre_trade_risk);
+    RUN_TEST(book_state_hash);
+    RUN_TEST(allocation_failure);
+    RUN_TEST(modify_orders);
+    RUN_TEST(command_pipe);
+    RUN_TEST(external_order_ids);
+    RUN_TEST(striped_book);
+    RUN_TEST(book_history);
+    RUN_TEST(checkpoint_index);
     RUN_TEST(csv_parsing);
     
     std::cout << std::endl;